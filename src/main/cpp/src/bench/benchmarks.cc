@@ -0,0 +1,396 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Benchmarks for the analyzer's stages on synthetic headers of configurable
+// shape and on the fixture headers next to this file:
+//
+//   Parse      clang parsing and semantic analysis alone, into an ASTUnit
+//   Extract    TypeAnalyzer::ExtractTypes over an already parsed unit
+//   Analyze    AnalyzeSourceFile end to end, caches disabled
+//   Json       WriteAnalysisJson of the analyzed registry
+//   Archive    WriteTypeArchive of the analyzed registry
+//   Lookup     TypeArchive::FindByName of every named declaration
+//
+// Every benchmark reports heap allocations and bytes per iteration, and the
+// process's peak RSS so far. Extra synthetic shapes can be given as
+// --synthetic=structs,fields,nesting,pointers,functions,params,namespaces.
+
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <clang/Frontend/ASTUnit.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+
+#include "../tsanalyze/memory_usage.h"
+#include "../tsanalyze/serialization.h"
+#include "../tsanalyze/tsanalyze.h"
+#include "../tsanalyze/type_archive.h"
+#include "allocation_counter.h"
+#include "synthetic_header.h"
+
+namespace typesynth::bench {
+namespace {
+
+struct Input {
+  std::string name;
+  std::string path;
+  std::string code;
+};
+
+// Reports allocations made between construction and Report, averaged over the
+// benchmark's iterations.
+class AllocationScope {
+ public:
+  AllocationScope() : start_(CurrentAllocations()) {}
+
+  void Report(benchmark::State& state) const {
+    const AllocationStats end = CurrentAllocations();
+    state.counters["allocs"] = benchmark::Counter(
+        end.allocations - start_.allocations,
+        benchmark::Counter::kAvgIterations);
+    state.counters["alloc_bytes"] =
+        benchmark::Counter(end.bytes - start_.bytes,
+                           benchmark::Counter::kAvgIterations,
+                           benchmark::Counter::OneK::kIs1024);
+    state.counters["peak_rss"] =
+        benchmark::Counter(PeakResidentBytes(), benchmark::Counter::kDefaults,
+                           benchmark::Counter::OneK::kIs1024);
+  }
+
+ private:
+  AllocationStats start_;
+};
+
+std::unique_ptr<clang::ASTUnit> Parse(const Input& input) {
+  return clang::tooling::buildASTFromCodeWithArgs(input.code, {"-w"},
+                                                  input.path);
+}
+
+// An analyzer that always does the work: nothing is served from or written
+// to the caches in the user's cache directory.
+TypeAnalyzer NewAnalyzer() {
+  TypeAnalyzer analyzer({});
+  analyzer.SetPchCacheDirectory("");
+  analyzer.SetAnalysisCacheDirectory("");
+  return analyzer;
+}
+
+void BM_Parse(benchmark::State& state, const Input& input) {
+  AllocationScope allocations;
+  for (auto _ : state) {
+    std::unique_ptr<clang::ASTUnit> ast = Parse(input);
+    if (!ast) {
+      state.SkipWithError("Parsing failed");
+      break;
+    }
+    state.PauseTiming();
+    ast.reset();
+    state.ResumeTiming();
+  }
+  state.SetBytesProcessed(state.iterations() * input.code.size());
+  allocations.Report(state);
+}
+
+void BM_Extract(benchmark::State& state, const Input& input) {
+  std::unique_ptr<clang::ASTUnit> ast = Parse(input);
+  if (!ast) {
+    state.SkipWithError("Parsing failed");
+    return;
+  }
+
+  std::optional<TypeAnalyzer> analyzer;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    state.PauseTiming();
+    analyzer.emplace(NewAnalyzer());
+    state.ResumeTiming();
+    analyzer->ExtractTypes(ast->getASTContext());
+  }
+  allocations.Report(state);
+  state.counters["types"] = analyzer->type_registry().size();
+}
+
+void BM_Analyze(benchmark::State& state, const Input& input) {
+  std::optional<TypeAnalyzer> analyzer;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    state.PauseTiming();
+    analyzer.emplace(NewAnalyzer());
+    state.ResumeTiming();
+    absl::Status status = analyzer->AnalyzeSourceFile(input.path);
+    if (!status.ok()) {
+      state.SkipWithError(status.ToString());
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * input.code.size());
+  allocations.Report(state);
+  state.counters["types"] = analyzer->type_registry().size();
+}
+
+// Runs `write` on the registry analyzed from `input`, into a buffer reused
+// between iterations.
+template <typename WriteFn>
+void BenchmarkOutput(benchmark::State& state, const Input& input,
+                     WriteFn write) {
+  TypeAnalyzer analyzer = NewAnalyzer();
+  if (absl::Status status = analyzer.AnalyzeSourceFile(input.path);
+      !status.ok()) {
+    state.SkipWithError(status.ToString());
+    return;
+  }
+
+  std::string output;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    output.clear();
+    llvm::raw_string_ostream os(output);
+    write(analyzer.type_registry(), os);
+    os.flush();
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetBytesProcessed(state.iterations() * output.size());
+  allocations.Report(state);
+  state.counters["types"] = analyzer.type_registry().size();
+  state.counters["output_bytes"] =
+      benchmark::Counter(output.size(), benchmark::Counter::kDefaults,
+                         benchmark::Counter::OneK::kIs1024);
+}
+
+void BM_Json(benchmark::State& state, const Input& input) {
+  const AnalysisInputs inputs = {.main_file = input.path,
+                                 .files = {input.path}};
+  BenchmarkOutput(state, input,
+                  [&](const TypeRegistry& registry, llvm::raw_ostream& os) {
+                    WriteAnalysisJson(inputs, registry, os);
+                  });
+}
+
+void BM_Archive(benchmark::State& state, const Input& input) {
+  BenchmarkOutput(state, input,
+                  [](const TypeRegistry& registry, llvm::raw_ostream& os) {
+                    WriteTypeArchive(registry, os);
+                  });
+}
+
+void BM_Lookup(benchmark::State& state, const Input& input) {
+  TypeAnalyzer analyzer = NewAnalyzer();
+  if (absl::Status status = analyzer.AnalyzeSourceFile(input.path);
+      !status.ok()) {
+    state.SkipWithError(status.ToString());
+    return;
+  }
+  llvm::SmallVector<char, 0> buffer;
+  {
+    llvm::raw_svector_ostream os(buffer);
+    WriteTypeArchive(analyzer.type_registry(), os);
+  }
+  absl::StatusOr<TypeArchive> index = TypeArchive::FromBuffer(
+      llvm::MemoryBuffer::getMemBuffer(
+          llvm::StringRef(buffer.data(), buffer.size()), "",
+          /*RequiresNullTerminator=*/false));
+  if (!index.ok()) {
+    state.SkipWithError(index.status().ToString());
+    return;
+  }
+
+  std::vector<std::string_view> names;
+  for (const auto& entry : index->FindByPrefix(""))
+    names.push_back(index->String(entry.qualified_name));
+
+  AllocationScope allocations;
+  for (auto _ : state) {
+    for (std::string_view name : names)
+      benchmark::DoNotOptimize(index->FindByName(name).data());
+  }
+  state.SetItemsProcessed(state.iterations() * names.size());
+  allocations.Report(state);
+  state.counters["names"] = names.size();
+}
+
+void RegisterStages(const Input& input) {
+  using Stage = void (*)(benchmark::State&, const Input&);
+  constexpr std::pair<std::string_view, Stage> kStages[] = {
+      {"Parse", BM_Parse},     {"Extract", BM_Extract},
+      {"Analyze", BM_Analyze}, {"Json", BM_Json},
+      {"Archive", BM_Archive}, {"Lookup", BM_Lookup},
+  };
+  for (const auto& [stage, run] : kStages) {
+    benchmark::RegisterBenchmark(absl::StrCat(stage, "/", input.name), run,
+                                 input)
+        ->Unit(benchmark::kMillisecond);
+  }
+}
+
+std::optional<SyntheticHeaderShape> ParseShape(std::string_view spec) {
+  std::vector<std::string_view> parts = absl::StrSplit(spec, ',');
+  int values[7];
+  if (parts.size() != std::size(values))
+    return std::nullopt;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    if (!absl::SimpleAtoi(parts[i], &values[i]) || values[i] < 0)
+      return std::nullopt;
+  }
+  return SyntheticHeaderShape{.structs = values[0],
+                              .fields_per_struct = values[1],
+                              .nesting_depth = values[2],
+                              .pointer_depth = values[3],
+                              .functions = values[4],
+                              .params_per_function = values[5],
+                              .namespace_depth = values[6]};
+}
+
+// Writes a synthetic header into `directory`; analyzing one needs a file.
+std::optional<Input> SyntheticInput(std::string name,
+                                    const SyntheticHeaderShape& shape,
+                                    llvm::StringRef directory) {
+  Input input = {.name = std::move(name),
+                 .code = GenerateSyntheticHeader(shape)};
+  llvm::SmallString<256> path(directory);
+  llvm::sys::path::append(path, SyntheticHeaderName(shape));
+  input.path = std::string(path);
+
+  std::error_code error;
+  llvm::raw_fd_ostream os(input.path, error);
+  if (error)
+    return std::nullopt;
+  os << input.code;
+  os.close();
+  if (os.has_error()) {
+    os.clear_error();
+    return std::nullopt;
+  }
+  return input;
+}
+
+std::vector<Input> FixtureInputs() {
+  std::vector<Input> inputs;
+  std::error_code error;
+  for (llvm::sys::fs::directory_iterator it(TYPESYNTH_BENCH_FIXTURES, error),
+       end;
+       it != end && !error; it.increment(error)) {
+    auto buffer = llvm::MemoryBuffer::getFile(it->path());
+    if (!buffer)
+      continue;
+    inputs.push_back(
+        {.name = llvm::sys::path::stem(it->path()).str(),
+         .path = it->path(),
+         .code = (*buffer)->getBuffer().str()});
+  }
+  return inputs;
+}
+
+}  // namespace
+}  // namespace typesynth::bench
+
+int main(int argc, char** argv) {
+  using namespace typesynth::bench;
+
+  std::vector<std::pair<std::string, SyntheticHeaderShape>> shapes = {
+      {"small_c", {.structs = 100, .functions = 100}},
+      {"large_c",
+       {.structs = 2000,
+        .fields_per_struct = 12,
+        .pointer_depth = 2,
+        .functions = 2000,
+        .params_per_function = 4}},
+      {"nested", {.structs = 500, .nesting_depth = 3, .functions = 200}},
+      {"pointer_chains",
+       {.structs = 500,
+        .fields_per_struct = 16,
+        .pointer_depth = 4,
+        .functions = 200}},
+      {"namespaced_cxx",
+       {.structs = 1000,
+        .nesting_depth = 1,
+        .pointer_depth = 2,
+        .functions = 1000,
+        .namespace_depth = 6}},
+  };
+
+  // Pull out our own flags before the benchmark library sees them.
+  int kept = 1;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    constexpr std::string_view kShapeFlag = "--synthetic=";
+    if (arg.starts_with(kShapeFlag)) {
+      std::string_view spec = arg.substr(kShapeFlag.size());
+      std::optional<SyntheticHeaderShape> shape = ParseShape(spec);
+      if (!shape) {
+        std::cerr << "Invalid shape '" << spec
+                  << "'; expected structs,fields,nesting,pointers,functions,"
+                     "params,namespaces\n";
+        return 1;
+      }
+      shapes.emplace_back(absl::StrCat("synthetic_", spec), *shape);
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+
+  llvm::SmallString<256> work_dir;
+  if (llvm::sys::fs::createUniqueDirectory("typesynth-bench", work_dir)) {
+    std::cerr << "Failed to create a directory for synthetic headers\n";
+    return 1;
+  }
+
+  for (const auto& [name, shape] : shapes) {
+    std::optional<Input> input = SyntheticInput(name, shape, work_dir);
+    if (!input) {
+      std::cerr << "Failed to write synthetic header " << name << "\n";
+      return 1;
+    }
+    RegisterStages(*input);
+  }
+  for (const Input& input : FixtureInputs())
+    RegisterStages(input);
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  llvm::sys::fs::remove_directories(work_dir);
+  return 0;
+}
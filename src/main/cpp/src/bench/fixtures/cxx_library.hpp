@@ -0,0 +1,172 @@
+// A self-contained excerpt in the style of a C++ library's internals: nested
+// namespaces, records nested in records, an anonymous namespace, references,
+// scoped enums, class templates and their instantiations. No includes, so it
+// parses without a standard library.
+
+namespace acme {
+namespace detail {
+
+using size_type = unsigned long;
+using difference_type = long;
+
+template <typename T>
+struct allocator {
+  using value_type = T;
+  T* allocate(size_type n);
+  void deallocate(T* p, size_type n);
+};
+
+template <typename T, typename Alloc = allocator<T>>
+class vector {
+ public:
+  using value_type = T;
+  using pointer = T*;
+  using reference = T&;
+  using const_reference = const T&;
+
+  reference operator[](size_type i);
+  const_reference operator[](size_type i) const;
+  size_type size() const;
+
+ private:
+  pointer begin_;
+  pointer end_;
+  pointer capacity_;
+  Alloc allocator_;
+};
+
+template <typename CharT>
+class basic_string {
+ public:
+  const CharT* c_str() const;
+
+ private:
+  struct long_rep {
+    CharT* data;
+    size_type size;
+    size_type capacity;
+  };
+  struct short_rep {
+    CharT data[23];
+    unsigned char size;
+  };
+  union {
+    long_rep l;
+    short_rep s;
+  } rep_;
+};
+
+}  // namespace detail
+
+using string = detail::basic_string<char>;
+
+namespace {
+struct InternalCounter {
+  int hits;
+  int misses;
+};
+}  // namespace
+
+namespace net {
+namespace http {
+
+enum class Method : unsigned char { kGet, kHead, kPost, kPut, kDelete };
+enum class Status : int { kOk = 200, kNotFound = 404, kServerError = 500 };
+
+struct Header {
+  string name;
+  string value;
+};
+
+class Request {
+ public:
+  struct Url {
+    string scheme;
+    string host;
+    unsigned short port;
+    string path;
+  };
+
+  Method method() const;
+  const Url& url() const;
+  const detail::vector<Header>& headers() const;
+
+ private:
+  Method method_;
+  Url url_;
+  detail::vector<Header> headers_;
+  detail::vector<unsigned char> body_;
+};
+
+class Response {
+ public:
+  Status status() const;
+
+ private:
+  Status status_;
+  detail::vector<Header> headers_;
+  detail::vector<unsigned char> body_;
+  InternalCounter counter_;
+};
+
+using Handler = Response (*)(const Request&, void* context);
+
+struct Route {
+  Method method;
+  string pattern;
+  Handler handler;
+  void* context;
+};
+
+class Router {
+ public:
+  void add(Route route);
+  Response dispatch(const Request& request) const;
+
+ private:
+  struct Node {
+    string segment;
+    detail::vector<Node*> children;
+    Route* route;
+  };
+  Node* root_;
+  detail::vector<Route> routes_;
+};
+
+}  // namespace http
+}  // namespace net
+
+namespace io {
+
+struct Buffer {
+  unsigned char* data;
+  detail::size_type size;
+  detail::size_type capacity;
+};
+
+class Stream {
+ public:
+  virtual ~Stream();
+  virtual detail::difference_type read(Buffer& buffer) = 0;
+  virtual detail::difference_type write(const Buffer& buffer) = 0;
+};
+
+class FileStream : public Stream {
+ public:
+  detail::difference_type read(Buffer& buffer) override;
+  detail::difference_type write(const Buffer& buffer) override;
+
+ private:
+  int fd_;
+  string path_;
+};
+
+}  // namespace io
+
+net::http::Response serve(const net::http::Request& request,
+                          const net::http::Router& router);
+io::Buffer& append(io::Buffer& buffer, const unsigned char* data,
+                   detail::size_type size);
+string join(const detail::vector<string>& parts, const string& separator);
+
+}  // namespace acme
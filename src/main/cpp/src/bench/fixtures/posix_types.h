@@ -0,0 +1,206 @@
+/* A self-contained excerpt in the style of POSIX system headers: fixed-width
+ * typedef chains, socket address unions, bit-fields and callback-heavy
+ * structures. No includes, so it parses without a sysroot. */
+
+typedef signed char __int8_t;
+typedef unsigned char __uint8_t;
+typedef short __int16_t;
+typedef unsigned short __uint16_t;
+typedef int __int32_t;
+typedef unsigned int __uint32_t;
+typedef long long __int64_t;
+typedef unsigned long long __uint64_t;
+typedef long __darwin_ssize_t;
+typedef unsigned long __darwin_size_t;
+
+typedef __int8_t int8_t;
+typedef __uint8_t uint8_t;
+typedef __int16_t int16_t;
+typedef __uint16_t uint16_t;
+typedef __int32_t int32_t;
+typedef __uint32_t uint32_t;
+typedef __int64_t int64_t;
+typedef __uint64_t uint64_t;
+typedef __darwin_size_t size_t;
+typedef __darwin_ssize_t ssize_t;
+
+typedef __uint32_t uid_t;
+typedef __uint32_t gid_t;
+typedef __uint16_t mode_t;
+typedef __int64_t off_t;
+typedef __int32_t pid_t;
+typedef __int32_t dev_t;
+typedef __uint64_t ino_t;
+typedef __uint16_t nlink_t;
+typedef long time_t;
+typedef int suseconds_t;
+typedef __uint32_t socklen_t;
+typedef __uint8_t sa_family_t;
+typedef __uint16_t in_port_t;
+typedef __uint32_t in_addr_t;
+
+struct timespec {
+  time_t tv_sec;
+  long tv_nsec;
+};
+
+struct timeval {
+  time_t tv_sec;
+  suseconds_t tv_usec;
+};
+
+struct stat {
+  dev_t st_dev;
+  mode_t st_mode;
+  nlink_t st_nlink;
+  ino_t st_ino;
+  uid_t st_uid;
+  gid_t st_gid;
+  dev_t st_rdev;
+  struct timespec st_atimespec;
+  struct timespec st_mtimespec;
+  struct timespec st_ctimespec;
+  struct timespec st_birthtimespec;
+  off_t st_size;
+  int64_t st_blocks;
+  int32_t st_blksize;
+  uint32_t st_flags;
+  uint32_t st_gen;
+  int32_t st_lspare;
+  int64_t st_qspare[2];
+};
+
+struct in_addr {
+  in_addr_t s_addr;
+};
+
+struct in6_addr {
+  union {
+    uint8_t __u6_addr8[16];
+    uint16_t __u6_addr16[8];
+    uint32_t __u6_addr32[4];
+  } __u6_addr;
+};
+
+struct sockaddr {
+  uint8_t sa_len;
+  sa_family_t sa_family;
+  char sa_data[14];
+};
+
+struct sockaddr_in {
+  uint8_t sin_len;
+  sa_family_t sin_family;
+  in_port_t sin_port;
+  struct in_addr sin_addr;
+  char sin_zero[8];
+};
+
+struct sockaddr_in6 {
+  uint8_t sin6_len;
+  sa_family_t sin6_family;
+  in_port_t sin6_port;
+  uint32_t sin6_flowinfo;
+  struct in6_addr sin6_addr;
+  uint32_t sin6_scope_id;
+};
+
+struct iovec {
+  void *iov_base;
+  size_t iov_len;
+};
+
+struct msghdr {
+  void *msg_name;
+  socklen_t msg_namelen;
+  struct iovec *msg_iov;
+  int msg_iovlen;
+  void *msg_control;
+  socklen_t msg_controllen;
+  int msg_flags;
+};
+
+struct ip {
+  unsigned int ip_hl : 4;
+  unsigned int ip_v : 4;
+  uint8_t ip_tos;
+  uint16_t ip_len;
+  uint16_t ip_id;
+  uint16_t ip_off;
+  uint8_t ip_ttl;
+  uint8_t ip_p;
+  uint16_t ip_sum;
+  struct in_addr ip_src, ip_dst;
+};
+
+union sigval {
+  int sival_int;
+  void *sival_ptr;
+};
+
+typedef struct __siginfo {
+  int si_signo;
+  int si_errno;
+  int si_code;
+  pid_t si_pid;
+  uid_t si_uid;
+  int si_status;
+  void *si_addr;
+  union sigval si_value;
+  long si_band;
+  unsigned long __pad[7];
+} siginfo_t;
+
+struct sigaction {
+  union {
+    void (*__sa_handler)(int);
+    void (*__sa_sigaction)(int, siginfo_t *, void *);
+  } __sigaction_u;
+  uint32_t sa_mask;
+  int sa_flags;
+};
+
+enum {
+  AF_UNSPEC = 0,
+  AF_UNIX = 1,
+  AF_INET = 2,
+  AF_INET6 = 30,
+};
+
+typedef enum {
+  P_ALL,
+  P_PID,
+  P_PGID,
+} idtype_t;
+
+typedef struct _opaque_pthread_t *pthread_t;
+typedef struct _opaque_pthread_attr_t pthread_attr_t;
+typedef void *(*pthread_start_routine)(void *);
+
+struct dirent {
+  ino_t d_ino;
+  uint64_t d_seekoff;
+  uint16_t d_reclen;
+  uint16_t d_namlen;
+  uint8_t d_type;
+  char d_name[1024];
+};
+
+typedef struct __dirstream DIR;
+
+int stat(const char *path, struct stat *buf);
+int fstat(int fd, struct stat *buf);
+ssize_t read(int fd, void *buf, size_t count);
+ssize_t write(int fd, const void *buf, size_t count);
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
+ssize_t recvmsg(int socket, struct msghdr *message, int flags);
+int bind(int socket, const struct sockaddr *address, socklen_t address_len);
+int accept(int socket, struct sockaddr *address, socklen_t *address_len);
+int sigaction(int sig, const struct sigaction *act, struct sigaction *oact);
+int gettimeofday(struct timeval *tp, void *tzp);
+int nanosleep(const struct timespec *req, struct timespec *rem);
+int pthread_create(pthread_t *thread, const pthread_attr_t *attr,
+                   pthread_start_routine start_routine, void *arg);
+DIR *opendir(const char *name);
+struct dirent *readdir(DIR *dirp);
+int printf(const char *format, ...);
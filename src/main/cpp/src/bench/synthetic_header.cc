@@ -0,0 +1,127 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "synthetic_header.h"
+
+#include <cstddef>
+#include <iterator>
+
+#include "absl/strings/str_cat.h"
+
+namespace typesynth::bench {
+namespace {
+
+constexpr const char* kPrimitives[] = {
+    "int",   "unsigned long", "char",  "double",
+    "short", "long long",     "float", "unsigned char"};
+constexpr size_t kPrimitiveCount = std::size(kPrimitives);
+
+void AppendNested(const SyntheticHeaderShape& shape, int depth,
+                  std::string& out) {
+  const std::string indent(2 * (depth + 1), ' ');
+  absl::StrAppend(&out, indent, "struct {\n");
+  for (int j = 0; j < shape.fields_per_struct; ++j) {
+    absl::StrAppend(&out, indent, "  ", kPrimitives[j % kPrimitiveCount],
+                    " n", depth, "_", j, ";\n");
+  }
+  if (depth + 1 < shape.nesting_depth)
+    AppendNested(shape, depth + 1, out);
+  absl::StrAppend(&out, indent, "} nested", depth, ";\n");
+}
+
+void AppendStruct(const SyntheticHeaderShape& shape, int i, std::string& out) {
+  absl::StrAppend(&out, "struct S", i, " {\n");
+  for (int j = 0; j < shape.fields_per_struct; ++j) {
+    // Earlier structs are referenced through pointers, and the previous one
+    // once by value, which keeps record sizes growing linearly.
+    if (i > 0 && j % 4 == 0 && shape.pointer_depth > 0) {
+      const int depth = 1 + (j / 4) % shape.pointer_depth;
+      absl::StrAppend(&out, "  struct S", (i * 7 + j) % i, " ",
+                      std::string(depth, '*'), "p", j, ";\n");
+    } else if (i > 0 && j == 1) {
+      absl::StrAppend(&out, "  struct S", i - 1, " v", j, ";\n");
+    } else {
+      absl::StrAppend(&out, "  ", kPrimitives[(i + j) % kPrimitiveCount],
+                      " f", j, ";\n");
+    }
+  }
+  if (shape.nesting_depth > 0)
+    AppendNested(shape, 0, out);
+  absl::StrAppend(&out, "};\n");
+  absl::StrAppend(&out, "typedef struct S", i, " S", i, "_t;\n");
+
+  if (i % 10 == 0) {
+    absl::StrAppend(&out, "enum E", i, " {");
+    for (int k = 0; k < 8; ++k)
+      absl::StrAppend(&out, k ? ", " : " ", "E", i, "_", k, " = ", k * (i + 1));
+    absl::StrAppend(&out, " };\n");
+  }
+}
+
+void AppendFunction(const SyntheticHeaderShape& shape, int i,
+                    std::string& out) {
+  // Cycle through primitives, struct typedefs and pointers to them so that
+  // prototypes are mostly, but not entirely, distinct.
+  auto param_type = [&](int k) -> std::string {
+    if (shape.structs == 0 || k % 3 == 0)
+      return std::string(kPrimitives[(i + k) % kPrimitiveCount]);
+    const int target = (i + k) % shape.structs;
+    return k % 3 == 1 ? absl::StrCat("S", target, "_t *")
+                      : absl::StrCat("const S", target, "_t *");
+  };
+
+  absl::StrAppend(&out, param_type(i), " fn", i, "(");
+  for (int k = 0; k < shape.params_per_function; ++k)
+    absl::StrAppend(&out, k ? ", " : "", param_type(k + 1), " a", k);
+  if (shape.params_per_function == 0 && shape.namespace_depth == 0)
+    out += "void";
+  absl::StrAppend(&out, ");\n");
+}
+
+}  // namespace
+
+std::string GenerateSyntheticHeader(const SyntheticHeaderShape& shape) {
+  std::string out;
+  for (int d = 0; d < shape.namespace_depth; ++d)
+    absl::StrAppend(&out, "namespace ns", d, " {\n");
+
+  for (int i = 0; i < shape.structs; ++i)
+    AppendStruct(shape, i, out);
+  for (int i = 0; i < shape.functions; ++i)
+    AppendFunction(shape, i, out);
+
+  for (int d = shape.namespace_depth - 1; d >= 0; --d)
+    absl::StrAppend(&out, "}  // namespace ns", d, "\n");
+  return out;
+}
+
+std::string SyntheticHeaderName(const SyntheticHeaderShape& shape) {
+  return absl::StrCat("synthetic_", shape.structs, "_", shape.fields_per_struct,
+                      "_", shape.nesting_depth, "_", shape.pointer_depth, "_",
+                      shape.functions, "_", shape.params_per_function, "_",
+                      shape.namespace_depth,
+                      shape.namespace_depth > 0 ? ".hpp" : ".h");
+}
+
+}  // namespace typesynth::bench
@@ -0,0 +1,57 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SYNTHETIC_HEADER_H
+#define SYNTHETIC_HEADER_H
+
+#include <string>
+
+namespace typesynth::bench {
+
+// Shape of a generated header. Every count is per header unless noted.
+struct SyntheticHeaderShape {
+  int structs = 100;
+  int fields_per_struct = 8;
+  // Levels of anonymous records nested inside each struct.
+  int nesting_depth = 0;
+  // Longest chain of `*` on a pointer field; pointer fields cycle through
+  // every length up to it.
+  int pointer_depth = 1;
+  int functions = 100;
+  int params_per_function = 3;
+  // Namespaces wrapped around everything. Any nesting makes the header C++.
+  int namespace_depth = 0;
+};
+
+// Generates a self-contained header of the given shape, with no includes.
+// Structs refer to earlier structs by value and through pointers, each gets
+// a typedef, and every tenth gets an enum. Output is deterministic.
+std::string GenerateSyntheticHeader(const SyntheticHeaderShape& shape);
+
+// File name for a header of `shape`, whose extension selects the language.
+std::string SyntheticHeaderName(const SyntheticHeaderShape& shape);
+
+}  // namespace typesynth::bench
+
+#endif  //SYNTHETIC_HEADER_H
@@ -0,0 +1,103 @@
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "../tsanalyze/analysis_daemon.h"
+
+namespace {
+
+void PrintUsage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "       " << program << " --stop [--socket <path>]\n"
+            << "Serves analyses to typesynth clients over a Unix socket, "
+               "keeping compiler\n"
+            << "state warm between them.\n"
+            << "Options:\n"
+            << "  --socket <path>    Where to listen. Defaults to "
+            << typesynth::DefaultDaemonSocketPath() << ".\n"
+            << "  --pch-cache <dir>  Where to keep precompiled headers.\n"
+            << "  --no-pch           Don't use precompiled headers.\n"
+            << "  --cache <dir>      Where to cache per-file analysis "
+               "results.\n"
+            << "  --no-cache         Always analyze every file from scratch.\n"
+            << "  --memory-budget <MiB>\n"
+            << "                     Start no more files in parallel than "
+               "fit in this much\n"
+            << "                     memory; 0 for no limit. Defaults to "
+               "3/4 of RAM.\n"
+            << "  --sessions <n>     How many sets of clang flags to keep warm "
+               "at once.\n"
+            << "  --stop             Ask the server on the socket to shut "
+               "down.\n";
+}
+
+typesynth::AnalysisServer* running_server = nullptr;
+
+void StopServer(int) {
+  if (running_server)
+    running_server->Stop();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string socket_path = typesynth::DefaultDaemonSocketPath();
+  typesynth::AnalysisServer::Options options;
+  bool stop = false;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--socket" && i + 1 < argc) {
+      socket_path = argv[++i];
+    } else if (arg == "--pch-cache" && i + 1 < argc) {
+      options.pch_cache_directory = argv[++i];
+    } else if (arg == "--no-pch") {
+      options.pch_cache_directory = "";
+    } else if (arg == "--cache" && i + 1 < argc) {
+      options.analysis_cache_directory = argv[++i];
+    } else if (arg == "--no-cache") {
+      options.analysis_cache_directory = "";
+    } else if (arg == "--memory-budget" && i + 1 < argc) {
+      options.memory_budget = std::stoull(argv[++i]) << 20;
+    } else if (arg == "--sessions" && i + 1 < argc) {
+      options.max_sessions = std::stoul(argv[++i]);
+    } else if (arg == "--stop") {
+      stop = true;
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (stop) {
+    absl::Status status = typesynth::RequestShutdown(socket_path);
+    if (!status.ok()) {
+      std::cerr << status << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  // Clients hanging up mid-response must not take the server down.
+  std::signal(SIGPIPE, SIG_IGN);
+
+  typesynth::AnalysisServer server(options);
+  if (absl::Status status = server.Listen(socket_path); !status.ok()) {
+    std::cerr << status << std::endl;
+    return 1;
+  }
+  running_server = &server;
+  std::signal(SIGINT, StopServer);
+  std::signal(SIGTERM, StopServer);
+  std::cerr << "Listening on " << socket_path << std::endl;
+
+  absl::Status status = server.Serve();
+  running_server = nullptr;
+  if (!status.ok()) {
+    std::cerr << status << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -1,95 +1,327 @@
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
 
-#include <clang/AST/ASTContext.h>
-#include <clang/Basic/TargetInfo.h>
-#include <clang/Frontend/CompilerInstance.h>
-#include <clang/Basic/FileManager.h>
-#include <llvm/TargetParser/Host.h>
-
-// #include <map>
-
-static const std::string path = "./jsxer/src/jsxer/jsxer.cpp";
-
-// void ParseSourceFile(const char* source_file) {
-//   CXIndex index = clang_createIndex(0, 0);
-//
-//   const char* args[] = {"-I.", "-std=c++20"};
-//
-//   CXTranslationUnit unit = clang_parseTranslationUnit(
-//       index, source_file, args, 2, nullptr, 0, CXTranslationUnit_None);
-//
-//   if (unit == nullptr) {
-//     std::cerr << "Couldn't parse source file" << std::endl;
-//     return;
-//   }
-//
-//   CXCursor cursor = clang_getTranslationUnitCursor(unit);
-//
-//   std::map<std::string, CXCursor> symbol_table;
-//   auto visitor = [](CXCursor c, CXCursor parent, CXClientData client_data) {
-//     const auto table = static_cast<std::map<std::string, CXCursor>*>(client_data);
-//
-//     if (clang_getCursorKind(c) == CXCursor_FunctionDecl) {
-//       const CXString name = clang_getCursorSpelling(c);
-//       table->insert_or_assign(std::string(clang_getCString(name)), c);
-//       clang_disposeString(name);
-//     }
-//
-//     return CXChildVisit_Recurse;
-//   };
-//   clang_visitChildren(cursor, visitor, &symbol_table);
-//
-//   for (const auto& [key, cursor] : symbol_table) {
-//
-//     auto location = clang_getCursorLocation(cursor);
-//
-//     CXFile file;
-//     unsigned line, column, offset;
-//     clang_getSpellingLocation(location, &file, &line, &column, &offset);
-//
-//     auto file_name = std::string(clang_getCString(clang_getFileName(file)));
-//
-//     std::cout << " * Function: " << key << ", Origin: " << file_name << std::endl;
-//   }
-// }
-
-void ParseSourceFile(const std::string& fpath) {
-  const char* args[] = {"-x", "c++", "-std=c++20"};
-
-  clang::CompilerInstance compiler;
-  compiler.createDiagnostics(compiler.getVirtualFileSystem());
-
-  // Create compiler invocation info
-  auto invocation = std::make_shared<clang::CompilerInvocation>();
-  clang::CompilerInvocation::CreateFromArgs(*invocation, args,
-                                            compiler.getDiagnostics());
-
-  compiler.setInvocation(invocation);
-
-  // Configure target...
-  std::shared_ptr<clang::TargetOptions> target_opts(new clang::TargetOptions);
-  target_opts->Triple = llvm::sys::getDefaultTargetTriple();
-
-  compiler.setTarget(clang::TargetInfo::CreateTargetInfo(
-      compiler.getDiagnostics(), target_opts));
-
-  compiler.createFileManager();
-  compiler.createSourceManager(compiler.getFileManager());
-  compiler.createPreprocessor(clang::TU_Complete);
-  compiler.createASTContext();
-
-
-  const clang::FileEntry* file = compiler.getFileManager().getFile(fpath).get();
-  if (!file) {
-    // error
-    return;
-  }
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "../tsanalyze/analysis_daemon.h"
+#include "../tsanalyze/serialization.h"
+#include "../tsanalyze/tsanalyze.h"
+#include "../tsanalyze/type_archive.h"
+
+namespace {
+
+void PrintUsage(const char* program) {
+  std::cerr << "Usage: " << program << " <source file> [-- <clang flags>]\n"
+            << "       " << program
+            << " -p <compile_commands.json | build dir> [-j <workers>]"
+               " [-- <extra clang flags>]\n"
+            << "Options:\n"
+            << "  --pch-cache <dir>  Where to keep precompiled headers.\n"
+            << "  --no-pch           Don't use precompiled headers.\n"
+            << "  --cache <dir>      Where to cache per-file analysis results.\n"
+            << "  --no-cache         Always analyze every file from scratch.\n"
+            << "  --no-header-sharing\n"
+            << "                     Extract the types of each header anew "
+               "for every file\n"
+            << "                     that includes it.\n"
+            << "  --memory-budget <MiB>\n"
+            << "                     Start no more files in parallel than "
+               "fit in this much\n"
+            << "                     memory; 0 for no limit. Defaults to "
+               "3/4 of RAM.\n"
+            << "  --target <triple>  Analyze for this target; repeat to "
+               "analyze for several\n"
+            << "                     and keep their layouts side by side.\n"
+            << "  --root <name>      Only extract this function or type, by "
+               "qualified name,\n"
+            << "                     and what it refers to; repeat for "
+               "several.\n"
+            << "  --allow-file <glob>\n"
+            << "                     Only extract the declarations of files "
+               "matching this\n"
+            << "                     glob, and what they refer to, besides "
+               "any --root;\n"
+            << "                     repeat for several.\n"
+            << "  --daemon <socket>  Have the tsanalyzed server on this socket "
+               "run the analysis;\n"
+            << "                     --archive, --metrics, --time-trace "
+               "and the PCH, cache,\n"
+            << "                     header sharing and memory options are "
+               "unavailable.\n"
+            << "  --archive <file>   Write the extracted types as a type "
+               "archive.\n"
+            << "  --json <file>      Write the extracted types as JSON, to "
+               "stdout for '-'.\n"
+            << "  --delta-from <archive>\n"
+            << "                     Only write the types added, changed or "
+               "removed since the\n"
+            << "                     analysis saved to this archive to the "
+               "JSON output;\n"
+            << "                     requires --json.\n"
+            << "  --metrics <file>   Write per-phase timings and counters as "
+               "JSON, to stdout\n"
+            << "                     for '-'.\n"
+            << "  --time-trace <file>\n"
+            << "                     Write a Chrome trace of the analysis, "
+               "including clang's\n"
+            << "                     own -ftime-trace events, to stdout "
+               "for '-'.\n"
+            << "Only one of --json, --metrics and --time-trace may write to "
+               "stdout.\n";
+}
 
+// Writes to `path`, or stdout for "-", and reports failures on stderr.
+bool WriteOutput(const std::string& path,
+                 const std::function<void(llvm::raw_ostream&)>& write) {
+  std::error_code error;
+  llvm::raw_fd_ostream out(path, error, llvm::sys::fs::OF_None);
+  if (!error) {
+    write(out);
+    out.flush();
+    error = out.error();
+    // raw_fd_ostream aborts on destruction if an error is left set.
+    out.clear_error();
+  }
+  if (error) {
+    std::cerr << "Failed to write " << path << ": " << error.message()
+              << std::endl;
+    return false;
+  }
+  return true;
 }
 
-int main() {
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string source_file;
+  std::string compilation_database;
+  unsigned num_workers = 0;
+  std::vector<std::string> flags;
+  std::optional<std::string> pch_cache;
+  std::optional<std::string> analysis_cache;
+  bool share_headers = true;
+  std::optional<uint64_t> memory_budget_mib;
+  std::vector<std::string> targets;
+  typesynth::ExtractionFilter filter;
+  std::string archive_path;
+  std::string json_path;
+  std::string delta_path;
+  std::string daemon_socket;
+  std::string metrics_path;
+  std::string time_trace_path;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--") {
+      flags.assign(argv + i + 1, argv + argc);
+      break;
+    } else if (arg == "-p" && i + 1 < argc) {
+      compilation_database = argv[++i];
+    } else if (arg == "--pch-cache" && i + 1 < argc) {
+      pch_cache = argv[++i];
+    } else if (arg == "--no-pch") {
+      pch_cache = "";
+    } else if (arg == "--cache" && i + 1 < argc) {
+      analysis_cache = argv[++i];
+    } else if (arg == "--no-cache") {
+      analysis_cache = "";
+    } else if (arg == "--no-header-sharing") {
+      share_headers = false;
+    } else if (arg == "--memory-budget" && i + 1 < argc) {
+      uint64_t mib = 0;
+      // The budget is taken in bytes, which must not overflow.
+      if (!llvm::to_integer(argv[++i], mib, 10) ||
+          mib > std::numeric_limits<uint64_t>::max() >> 20) {
+        PrintUsage(argv[0]);
+        return 1;
+      }
+      memory_budget_mib = mib;
+    } else if (arg == "--target" && i + 1 < argc) {
+      targets.emplace_back(argv[++i]);
+    } else if (arg == "--root" && i + 1 < argc) {
+      filter.roots.emplace_back(argv[++i]);
+    } else if (arg == "--allow-file" && i + 1 < argc) {
+      filter.file_globs.emplace_back(argv[++i]);
+    } else if (arg == "--daemon" && i + 1 < argc) {
+      daemon_socket = argv[++i];
+    } else if (arg == "--archive" && i + 1 < argc) {
+      archive_path = argv[++i];
+    } else if (arg == "--json" && i + 1 < argc) {
+      json_path = argv[++i];
+    } else if (arg == "--delta-from" && i + 1 < argc) {
+      delta_path = argv[++i];
+    } else if (arg == "--metrics" && i + 1 < argc) {
+      metrics_path = argv[++i];
+    } else if (arg == "--time-trace" && i + 1 < argc) {
+      time_trace_path = argv[++i];
+    } else if (arg == "-j" && i + 1 < argc) {
+      if (!llvm::to_integer(argv[++i], num_workers, 10)) {
+        PrintUsage(argv[0]);
+        return 1;
+      }
+    } else if (!arg.starts_with("-") && source_file.empty()) {
+      source_file = arg;
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  // A delta only goes into the JSON output, and outputs sharing stdout
+  // would interleave.
+  const int stdout_outputs = (json_path == "-") + (metrics_path == "-") +
+                             (time_trace_path == "-");
+  if (source_file.empty() == compilation_database.empty() ||
+      (!delta_path.empty() && json_path.empty()) || stdout_outputs > 1) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  if (!daemon_socket.empty()) {
+    // Caches and the memory budget belong to the server, which was
+    // configured when it started.
+    if (!archive_path.empty() || !metrics_path.empty() ||
+        !time_trace_path.empty() || pch_cache || analysis_cache ||
+        !share_headers || memory_budget_mib) {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+
+    typesynth::AnalysisRequest request;
+    if (compilation_database.empty()) {
+      request.files = {source_file};
+    } else {
+      request.compilation_database = compilation_database;
+    }
+    request.flags = flags;
+    request.num_workers = num_workers;
+    request.targets = targets;
+    request.filter = filter;
+    request.delta_from = delta_path;
+
+    absl::Status status;
+    auto request_analysis = [&](llvm::raw_ostream& os) {
+      status = typesynth::RequestAnalysis(daemon_socket, request, nullptr, os);
+    };
+    if (json_path.empty()) {
+      request_analysis(llvm::nulls());
+    } else if (!WriteOutput(json_path, request_analysis)) {
+      return 1;
+    }
+    if (!status.ok()) {
+      std::cerr << status << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  typesynth::TypeAnalyzer analyzer(flags);
+  if (pch_cache) {
+    analyzer.SetPchCacheDirectory(*pch_cache);
+  }
+  if (analysis_cache) {
+    analyzer.SetAnalysisCacheDirectory(*analysis_cache);
+  }
+  analyzer.SetHeaderSharing(share_headers);
+  if (memory_budget_mib) {
+    analyzer.SetMemoryBudget(*memory_budget_mib << 20);
+  }
+  if (!time_trace_path.empty()) {
+    analyzer.EnableTimeTrace();
+  }
+  if (absl::Status set = analyzer.SetTargets(targets); !set.ok()) {
+    std::cerr << set << std::endl;
+    return 1;
+  }
+  if (absl::Status set = analyzer.SetExtractionFilter(filter); !set.ok()) {
+    std::cerr << set << std::endl;
+    return 1;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  absl::Status status = compilation_database.empty()
+                            ? analyzer.AnalyzeSourceFile(source_file)
+                            : analyzer.AnalyzeProject(compilation_database,
+                                                      num_workers);
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  if (!status.ok()) {
+    std::cerr << status << std::endl;
+  }
+
+  for (const auto& conflict : analyzer.type_conflicts()) {
+    std::cerr << "warning: " << conflict.definitions.size()
+              << " conflicting definitions of " << conflict.qualified_name
+              << std::endl;
+  }
+
+  if (!archive_path.empty()) {
+    if (absl::Status written = typesynth::WriteTypeArchive(
+            analyzer.type_registry(), archive_path);
+        !written.ok()) {
+      std::cerr << written << std::endl;
+      return 1;
+    }
+  }
+
+  if (!json_path.empty()) {
+    std::optional<typesynth::TypeDelta> delta;
+    if (!delta_path.empty()) {
+      absl::StatusOr<typesynth::TypeArchive> previous =
+          typesynth::TypeArchive::Open(delta_path);
+      if (!previous.ok()) {
+        std::cerr << previous.status() << std::endl;
+        return 1;
+      }
+      delta = typesynth::DiffTypes(previous->ToRegistry(),
+                                   analyzer.type_registry());
+    }
+
+    typesynth::AnalysisInputs inputs;
+    inputs.main_file =
+        compilation_database.empty() ? source_file : compilation_database;
+    inputs.files = {inputs.main_file};
+    inputs.clang_flags = flags;
+    if (!WriteOutput(json_path, [&](llvm::raw_ostream& os) {
+          typesynth::WriteAnalysisJson(inputs, analyzer.type_registry(), os,
+                                       &analyzer.metrics(),
+                                       delta ? &*delta : nullptr);
+        })) {
+      return 1;
+    }
+  }
+
+  if (!metrics_path.empty() &&
+      !WriteOutput(metrics_path, [&](llvm::raw_ostream& os) {
+        typesynth::WriteMetricsJson(analyzer.metrics(), os);
+      })) {
+    return 1;
+  }
+
+  if (!time_trace_path.empty() &&
+      !WriteOutput(time_trace_path, [&](llvm::raw_ostream& os) {
+        os << analyzer.time_trace();
+      })) {
+    return 1;
+  }
 
-  ParseSourceFile(path);
+  // Keep stdout clean when an output goes there.
+  std::ostream& report = stdout_outputs > 0 ? std::cerr : std::cout;
+  report << "Extracted " << analyzer.type_registry().size() << " types in "
+         << elapsed.count() << "s, peak memory "
+         << (analyzer.metrics().peak_resident_bytes >> 20) << " MiB"
+         << std::endl;
 
-  return 0;
+  return status.ok() ? 0 : 1;
 }
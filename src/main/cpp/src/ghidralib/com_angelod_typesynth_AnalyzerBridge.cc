@@ -23,12 +23,488 @@
  */
 
 #include "com_angelod_typesynth_AnalyzerBridge.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/SmallVectorMemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "../tsanalyze/analysis_metrics.h"
+#include "../tsanalyze/serialization.h"
 #include "../tsanalyze/tsanalyze.h"
+#include "../tsanalyze/type_archive.h"
+#include "jni_util.h"
+
+namespace {
+
+// Native state behind an AnalyzerBridge. The analyzer, and with it the file
+// manager, caches and type registry, lives until the session is destroyed.
+struct AnalyzerSession {
+  explicit AnalyzerSession(std::vector<std::string> clang_flags)
+      : analyzer(clang_flags) {
+    inputs.clang_flags = std::move(clang_flags);
+  }
+
+  ~AnalyzerSession() {
+    // Stop any asynchronous analysis and wait for its thread. Never called on
+    // that thread, see jniDestroySession.
+    analyzer.Cancel();
+    if (worker.joinable())
+      worker.join();
+  }
+
+  void AddInput(std::string file) {
+    if (inputs.main_file.empty()) {
+      inputs.main_file = file;
+    }
+    inputs.files.push_back(std::move(file));
+  }
+
+  typesynth::TypeAnalyzer analyzer;
+  typesynth::AnalysisInputs inputs;
+  // Set while an analysis is running; the analyzer is not touched from
+  // anywhere else in the meantime.
+  std::atomic<bool> busy = false;
+  std::jthread worker;
+};
+
+AnalyzerSession* SessionFromHandle(JNIEnv* env, jlong handle) {
+  auto* session = reinterpret_cast<AnalyzerSession*>(handle);
+  if (session == nullptr) {
+    typesynth::jni::Throw(env, "java/lang/IllegalStateException",
+                          "Analyzer session is closed");
+  }
+  return session;
+}
+
+// Claims the session for one operation, failing if an analysis is running.
+AnalyzerSession* AcquireSession(JNIEnv* env, jlong handle) {
+  AnalyzerSession* session = SessionFromHandle(env, handle);
+  if (session != nullptr && session->busy.exchange(true)) {
+    typesynth::jni::Throw(env, "java/lang/IllegalStateException",
+                          "An analysis is already running in this session");
+    return nullptr;
+  }
+  return session;
+}
+
+// Carries progress from the analysis threads to the one thread attached to
+// the JVM. Only the latest snapshot is kept, so a slow listener sees fewer
+// updates rather than stalling the analysis.
+class ProgressRelay {
+ public:
+  void Post(const typesynth::AnalysisProgress& progress) {
+    std::lock_guard lock(mutex_);
+    latest_ = progress;
+    changed_.notify_one();
+  }
+
+  void Finish(absl::Status status) {
+    std::lock_guard lock(mutex_);
+    status_ = std::move(status);
+    changed_.notify_one();
+  }
+
+  // Waits for the next snapshot. Returns nothing once the analysis finished
+  // and every snapshot was taken.
+  std::optional<typesynth::AnalysisProgress> Next() {
+    std::unique_lock lock(mutex_);
+    changed_.wait(lock, [this] { return latest_ || status_; });
+    return std::exchange(latest_, std::nullopt);
+  }
+
+  // Valid once Next() returned nothing.
+  absl::Status status() const {
+    std::lock_guard lock(mutex_);
+    return *status_;
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::optional<typesynth::AnalysisProgress> latest_;
+  std::optional<absl::Status> status_;
+};
+
+// Reports the end of an asynchronous analysis to `listener`.
+void NotifyFinished(JNIEnv* env, jobject listener, const absl::Status& status) {
+  jclass listener_class = env->GetObjectClass(listener);
+  jmethodID on_finished = env->GetMethodID(listener_class, "onFinished",
+                                           "(Ljava/lang/String;Z)V");
+  env->DeleteLocalRef(listener_class);
+  if (on_finished != nullptr) {
+    jstring error =
+        status.ok() ? nullptr : env->NewStringUTF(status.ToString().c_str());
+    env->CallVoidMethod(listener, on_finished, error,
+                        static_cast<jboolean>(absl::IsCancelled(status)));
+  }
+  env->ExceptionClear();
+}
+
+// Body of the thread behind jniAnalyzeAsync. Runs the analysis on a thread of
+// its own and relays its progress to `listener` from this one, which is
+// attached to the JVM for the duration. `attached` is set once it is known
+// whether attaching succeeded; if not, the session is left untouched.
+void RunAsyncAnalysis(JavaVM* vm, AnalyzerSession* session,
+                      std::vector<std::string> files, jobject listener,
+                      std::promise<bool> attached) {
+  JNIEnv* env = nullptr;
+  if (vm->AttachCurrentThreadAsDaemon(reinterpret_cast<void**>(&env),
+                                      nullptr) != JNI_OK) {
+    attached.set_value(false);
+    return;
+  }
+  attached.set_value(true);
+
+  jclass listener_class = env->GetObjectClass(listener);
+  jmethodID on_progress = env->GetMethodID(listener_class, "onProgress",
+                                           "(IIJLjava/lang/String;)V");
+  env->DeleteLocalRef(listener_class);
+
+  ProgressRelay relay;
+  session->analyzer.SetProgressCallback(
+      [&relay](const typesynth::AnalysisProgress& progress) {
+        relay.Post(progress);
+      });
+  std::jthread analysis([&] {
+    relay.Finish(session->analyzer.AnalyzeSourceFiles(files));
+  });
+
+  while (std::optional<typesynth::AnalysisProgress> progress = relay.Next()) {
+    if (on_progress == nullptr)
+      continue;
+    jstring current_file = env->NewStringUTF(progress->current_file.c_str());
+    env->CallVoidMethod(listener, on_progress,
+                        static_cast<jint>(progress->units_done),
+                        static_cast<jint>(progress->units_total),
+                        static_cast<jlong>(progress->types_extracted),
+                        current_file);
+    env->DeleteLocalRef(current_file);
+    // A throwing listener must not stop the analysis.
+    env->ExceptionClear();
+  }
+  analysis.join();
+
+  session->analyzer.SetProgressCallback(nullptr);
+  for (std::string& file : files) {
+    session->AddInput(std::move(file));
+  }
+  const absl::Status status = relay.status();
+  // The session is not touched past this point.
+  session->busy = false;
+
+  // The listener hands the result off to another thread, so this returns
+  // promptly and whoever joins this thread next does not wait on user code.
+  env->ExceptionClear();
+  NotifyFinished(env, listener, status);
+  env->DeleteGlobalRef(listener);
+  vm->DetachCurrentThread();
+}
+
+}  // namespace
+
+jlong Java_com_angelod_typesynth_AnalyzerBridge_jniCreateSession(
+    JNIEnv* env, jclass cls, jobject clangFlags) {
+  std::vector<std::string> flags =
+      typesynth::jni::ToStringVector(env, clangFlags);
+  if (env->ExceptionCheck())
+    return 0;
+  return reinterpret_cast<jlong>(new AnalyzerSession(std::move(flags)));
+}
+
+void Java_com_angelod_typesynth_AnalyzerBridge_jniDestroySession(
+    JNIEnv* env, jclass cls, jlong handle) {
+  auto* session = reinterpret_cast<AnalyzerSession*>(handle);
+  // The analysis thread would have to join itself.
+  if (session != nullptr &&
+      session->worker.get_id() == std::this_thread::get_id()) {
+    typesynth::jni::Throw(env, "java/lang/IllegalStateException",
+                          "Cannot close a session from its progress listener");
+    return;
+  }
+  delete session;
+}
+
+void Java_com_angelod_typesynth_AnalyzerBridge_jniAnalyzeSourceFile(
+    JNIEnv* env, jclass cls, jlong handle, jstring mainFile) {
+  AnalyzerSession* session = AcquireSession(env, handle);
+  if (session == nullptr)
+    return;
+
+  std::string main_file = typesynth::jni::ToStdString(env, mainFile);
+  session->analyzer.ResetCancellation();
+  const absl::Status status = session->analyzer.AnalyzeSourceFile(main_file);
+  session->AddInput(std::move(main_file));
+  session->busy = false;
+
+  if (!status.ok()) {
+    typesynth::jni::Throw(env, "java/lang/IllegalStateException",
+                          status.ToString());
+  }
+}
+
+void Java_com_angelod_typesynth_AnalyzerBridge_jniAnalyzeAsync(
+    JNIEnv* env, jclass cls, jlong handle, jobject files, jobject listener) {
+  std::vector<std::string> filepaths =
+      typesynth::jni::ToStringVector(env, files);
+  if (env->ExceptionCheck())
+    return;
+
+  JavaVM* vm = nullptr;
+  if (env->GetJavaVM(&vm) != JNI_OK)
+    return;
+
+  AnalyzerSession* session = AcquireSession(env, handle);
+  if (session == nullptr)
+    return;
+
+  // The previous analysis' thread is done with the session, but may still be
+  // on its way out. Joined here, since assigning over it would join it on
+  // whichever thread this is, which may be that very thread.
+  if (session->worker.joinable()) {
+    if (session->worker.get_id() == std::this_thread::get_id()) {
+      session->worker.detach();
+    } else {
+      session->worker.join();
+    }
+  }
+
+  // Cleared here rather than on the new thread, so that a cancellation
+  // requested as soon as this returns cannot be lost.
+  session->analyzer.ResetCancellation();
+  jobject global_listener = env->NewGlobalRef(listener);
+  std::promise<bool> attached;
+  std::future<bool> is_attached = attached.get_future();
+  session->worker =
+      std::jthread(RunAsyncAnalysis, vm, session, std::move(filepaths),
+                   global_listener, std::move(attached));
+  if (!is_attached.get()) {
+    session->worker.join();
+    session->busy = false;
+    env->DeleteGlobalRef(global_listener);
+    NotifyFinished(env, listener,
+                   absl::InternalError(
+                       "Failed to attach the analysis thread to the JVM"));
+  }
+}
+
+void Java_com_angelod_typesynth_AnalyzerBridge_jniSetSourceBuffers(
+    JNIEnv* env, jclass cls, jlong handle, jobject paths, jobject contents) {
+  std::vector<std::string> buffer_paths =
+      typesynth::jni::ToStringVector(env, paths);
+  if (env->ExceptionCheck())
+    return;
+  std::vector<std::string> buffer_contents =
+      typesynth::jni::ToByteStringVector(env, contents);
+  if (env->ExceptionCheck())
+    return;
+  if (buffer_paths.size() != buffer_contents.size()) {
+    typesynth::jni::Throw(env, "java/lang/IllegalArgumentException",
+                          "Every source buffer needs a path and contents");
+    return;
+  }
+
+  AnalyzerSession* session = AcquireSession(env, handle);
+  if (session == nullptr)
+    return;
+
+  std::vector<typesynth::SourceBuffer> buffers(buffer_paths.size());
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    buffers[i].path = std::move(buffer_paths[i]);
+    buffers[i].contents = std::move(buffer_contents[i]);
+  }
+  session->analyzer.SetSourceBuffers(buffers);
+  session->busy = false;
+}
+
+void Java_com_angelod_typesynth_AnalyzerBridge_jniSetMemoryBudget(
+    JNIEnv* env, jclass cls, jlong handle, jlong bytes) {
+  AnalyzerSession* session = AcquireSession(env, handle);
+  if (session == nullptr)
+    return;
+
+  session->analyzer.SetMemoryBudget(static_cast<uint64_t>(bytes));
+  session->busy = false;
+}
+
+void Java_com_angelod_typesynth_AnalyzerBridge_jniSetTargets(
+    JNIEnv* env, jclass cls, jlong handle, jobject targets) {
+  std::vector<std::string> triples =
+      typesynth::jni::ToStringVector(env, targets);
+  if (env->ExceptionCheck())
+    return;
+
+  AnalyzerSession* session = AcquireSession(env, handle);
+  if (session == nullptr)
+    return;
+
+  absl::Status status = session->analyzer.SetTargets(std::move(triples));
+  session->busy = false;
+  if (!status.ok()) {
+    typesynth::jni::Throw(env, "java/lang/IllegalStateException",
+                          status.message());
+  }
+}
+
+void Java_com_angelod_typesynth_AnalyzerBridge_jniSetExtractionFilter(
+    JNIEnv* env, jclass cls, jlong handle, jobject roots, jobject fileGlobs) {
+  typesynth::ExtractionFilter filter;
+  filter.roots = typesynth::jni::ToStringVector(env, roots);
+  if (env->ExceptionCheck())
+    return;
+  filter.file_globs = typesynth::jni::ToStringVector(env, fileGlobs);
+  if (env->ExceptionCheck())
+    return;
+
+  AnalyzerSession* session = AcquireSession(env, handle);
+  if (session == nullptr)
+    return;
+
+  absl::Status status = session->analyzer.SetExtractionFilter(filter);
+  session->busy = false;
+  if (!status.ok()) {
+    typesynth::jni::Throw(env, "java/lang/IllegalArgumentException",
+                          status.message());
+  }
+}
+
+void Java_com_angelod_typesynth_AnalyzerBridge_jniCancel(JNIEnv* env,
+                                                         jclass cls,
+                                                         jlong handle) {
+  if (AnalyzerSession* session = SessionFromHandle(env, handle)) {
+    session->analyzer.Cancel();
+  }
+}
+
+void Java_com_angelod_typesynth_AnalyzerBridge_jniWriteResult(
+    JNIEnv* env, jclass cls, jlong handle, jobject output) {
+  AnalyzerSession* session = AcquireSession(env, handle);
+  if (session == nullptr)
+    return;
+
+  // Any Java exception raised while writing is left pending for the caller.
+  {
+    typesynth::jni::OutputStreamWriter writer(env, output);
+    typesynth::WriteAnalysisJson(session->inputs,
+                                 session->analyzer.type_registry(), writer,
+                                 &session->analyzer.metrics());
+  }
+  session->busy = false;
+}
+
+void Java_com_angelod_typesynth_AnalyzerBridge_jniWriteDelta(
+    JNIEnv* env, jclass cls, jlong handle, jstring previousArchive,
+    jobject output) {
+  absl::StatusOr<typesynth::TypeArchive> previous =
+      typesynth::TypeArchive::Open(
+          typesynth::jni::ToStdString(env, previousArchive));
+  if (!previous.ok()) {
+    typesynth::jni::Throw(env, "java/io/IOException",
+                          previous.status().ToString());
+    return;
+  }
+  const typesynth::TypeRegistry previous_types = previous->ToRegistry();
+
+  AnalyzerSession* session = AcquireSession(env, handle);
+  if (session == nullptr)
+    return;
+
+  {
+    const typesynth::TypeDelta delta = typesynth::DiffTypes(
+        previous_types, session->analyzer.type_registry());
+    typesynth::jni::OutputStreamWriter writer(env, output);
+    typesynth::WriteAnalysisJson(session->inputs,
+                                 session->analyzer.type_registry(), writer,
+                                 &session->analyzer.metrics(), &delta);
+  }
+  session->busy = false;
+}
+
+void Java_com_angelod_typesynth_AnalyzerBridge_jniWriteArchive(
+    JNIEnv* env, jclass cls, jlong handle, jstring path) {
+  std::string archive_path = typesynth::jni::ToStdString(env, path);
+  AnalyzerSession* session = AcquireSession(env, handle);
+  if (session == nullptr)
+    return;
+
+  absl::Status status = typesynth::WriteTypeArchive(
+      session->analyzer.type_registry(), archive_path);
+  session->busy = false;
+  if (!status.ok())
+    typesynth::jni::Throw(env, "java/io/IOException", status.ToString());
+}
+
+jlong Java_com_angelod_typesynth_AnalyzerBridge_jniBuildIndex(JNIEnv* env,
+                                                              jclass cls,
+                                                              jlong handle) {
+  AnalyzerSession* session = AcquireSession(env, handle);
+  if (session == nullptr)
+    return 0;
+
+  // The index is an archive kept in memory, owned by the TypeIndex that
+  // receives the handle.
+  llvm::SmallVector<char, 0> buffer;
+  {
+    llvm::raw_svector_ostream os(buffer);
+    typesynth::WriteTypeArchive(session->analyzer.type_registry(), os);
+  }
+  session->busy = false;
+
+  absl::StatusOr<typesynth::TypeArchive> index =
+      typesynth::TypeArchive::FromBuffer(
+          std::make_unique<llvm::SmallVectorMemoryBuffer>(
+              std::move(buffer), /*RequiresNullTerminator=*/false));
+  if (!index.ok()) {
+    typesynth::jni::Throw(env, "java/lang/IllegalStateException",
+                          index.status().ToString());
+    return 0;
+  }
+  return reinterpret_cast<jlong>(
+      new typesynth::TypeArchive(*std::move(index)));
+}
+
+void Java_com_angelod_typesynth_AnalyzerBridge_jniEnableTimeTrace(
+    JNIEnv* env, jclass cls, jlong handle, jint granularityMicros) {
+  AnalyzerSession* session = AcquireSession(env, handle);
+  if (session == nullptr)
+    return;
+
+  session->analyzer.EnableTimeTrace(granularityMicros);
+  session->busy = false;
+}
+
+jstring Java_com_angelod_typesynth_AnalyzerBridge_jniGetMetrics(
+    JNIEnv* env, jclass cls, jlong handle) {
+  AnalyzerSession* session = AcquireSession(env, handle);
+  if (session == nullptr)
+    return nullptr;
 
-jstring Java_com_angelod_typesynth_AnalyzerBridge_jniAnalyzeSourceFile(
-    JNIEnv* env, jobject obj, jstring mainFile, jobject clangFlags) {
+  std::string json;
+  llvm::raw_string_ostream os(json);
+  typesynth::WriteMetricsJson(session->analyzer.metrics(), os);
+  os.flush();
+  session->busy = false;
+  return typesynth::jni::ToJavaString(env, json);
+}
 
-  auto analyzer = typesynth::TypeAnalyzer({ "" });
+jstring Java_com_angelod_typesynth_AnalyzerBridge_jniGetTimeTrace(
+    JNIEnv* env, jclass cls, jlong handle) {
+  AnalyzerSession* session = AcquireSession(env, handle);
+  if (session == nullptr)
+    return nullptr;
 
-  return jstring{};
-}
\ No newline at end of file
+  jstring trace =
+      typesynth::jni::ToJavaString(env, session->analyzer.time_trace());
+  session->busy = false;
+  return trace;
+}
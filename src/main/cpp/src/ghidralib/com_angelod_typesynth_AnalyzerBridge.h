@@ -30,14 +30,159 @@
 
 extern "C" {
 
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniCreateSession
+ * Signature: (Ljava/util/List;)J
+ */
+JNIEXPORT jlong JNICALL Java_com_angelod_typesynth_AnalyzerBridge_jniCreateSession(
+    JNIEnv* env, jclass cls, jobject clangFlags);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniDestroySession
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_com_angelod_typesynth_AnalyzerBridge_jniDestroySession(JNIEnv* env,
+                                                            jclass cls,
+                                                            jlong handle);
+
 /*
  * Class:     com_angelod_typesynth_AnalyzerBridge
  * Method:    jniAnalyzeSourceFile
- * Signature: (Ljava/lang/String;Ljava/util/List;)Ljava/lang/String;
+ * Signature: (JLjava/lang/String;)V
  */
-JNIEXPORT jstring JNICALL
+JNIEXPORT void JNICALL
 Java_com_angelod_typesynth_AnalyzerBridge_jniAnalyzeSourceFile(
-    JNIEnv* env, jobject obj, jstring mainFile, jobject clangFlags);
+    JNIEnv* env, jclass cls, jlong handle, jstring mainFile);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniAnalyzeAsync
+ * Signature: (JLjava/util/List;Lcom/angelod/typesynth/AnalyzerBridge$AsyncAnalysis;)V
+ */
+JNIEXPORT void JNICALL
+Java_com_angelod_typesynth_AnalyzerBridge_jniAnalyzeAsync(JNIEnv* env,
+                                                          jclass cls,
+                                                          jlong handle,
+                                                          jobject files,
+                                                          jobject listener);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniSetSourceBuffers
+ * Signature: (JLjava/util/List;Ljava/util/List;)V
+ */
+JNIEXPORT void JNICALL
+Java_com_angelod_typesynth_AnalyzerBridge_jniSetSourceBuffers(
+    JNIEnv* env, jclass cls, jlong handle, jobject paths, jobject contents);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniSetMemoryBudget
+ * Signature: (JJ)V
+ */
+JNIEXPORT void JNICALL
+Java_com_angelod_typesynth_AnalyzerBridge_jniSetMemoryBudget(JNIEnv* env,
+                                                             jclass cls,
+                                                             jlong handle,
+                                                             jlong bytes);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniSetTargets
+ * Signature: (JLjava/util/List;)V
+ */
+JNIEXPORT void JNICALL
+Java_com_angelod_typesynth_AnalyzerBridge_jniSetTargets(JNIEnv* env,
+                                                        jclass cls,
+                                                        jlong handle,
+                                                        jobject targets);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniSetExtractionFilter
+ * Signature: (JLjava/util/List;Ljava/util/List;)V
+ */
+JNIEXPORT void JNICALL
+Java_com_angelod_typesynth_AnalyzerBridge_jniSetExtractionFilter(
+    JNIEnv* env, jclass cls, jlong handle, jobject roots, jobject fileGlobs);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniCancel
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_angelod_typesynth_AnalyzerBridge_jniCancel(
+    JNIEnv* env, jclass cls, jlong handle);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniWriteResult
+ * Signature: (JLjava/io/OutputStream;)V
+ */
+JNIEXPORT void JNICALL Java_com_angelod_typesynth_AnalyzerBridge_jniWriteResult(
+    JNIEnv* env, jclass cls, jlong handle, jobject output);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniWriteDelta
+ * Signature: (JLjava/lang/String;Ljava/io/OutputStream;)V
+ */
+JNIEXPORT void JNICALL Java_com_angelod_typesynth_AnalyzerBridge_jniWriteDelta(
+    JNIEnv* env, jclass cls, jlong handle, jstring previousArchive,
+    jobject output);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniWriteArchive
+ * Signature: (JLjava/lang/String;)V
+ */
+JNIEXPORT void JNICALL
+Java_com_angelod_typesynth_AnalyzerBridge_jniWriteArchive(JNIEnv* env,
+                                                          jclass cls,
+                                                          jlong handle,
+                                                          jstring path);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniBuildIndex
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL
+Java_com_angelod_typesynth_AnalyzerBridge_jniBuildIndex(JNIEnv* env,
+                                                        jclass cls,
+                                                        jlong handle);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniEnableTimeTrace
+ * Signature: (JI)V
+ */
+JNIEXPORT void JNICALL
+Java_com_angelod_typesynth_AnalyzerBridge_jniEnableTimeTrace(
+    JNIEnv* env, jclass cls, jlong handle, jint granularityMicros);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniGetMetrics
+ * Signature: (J)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL
+Java_com_angelod_typesynth_AnalyzerBridge_jniGetMetrics(JNIEnv* env,
+                                                        jclass cls,
+                                                        jlong handle);
+
+/*
+ * Class:     com_angelod_typesynth_AnalyzerBridge
+ * Method:    jniGetTimeTrace
+ * Signature: (J)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL
+Java_com_angelod_typesynth_AnalyzerBridge_jniGetTimeTrace(JNIEnv* env,
+                                                          jclass cls,
+                                                          jlong handle);
 }
 
 #endif  // COM_ANGELOD_TYPESYNTH_ANALYZERBRIDGE_H
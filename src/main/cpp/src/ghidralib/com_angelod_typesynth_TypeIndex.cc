@@ -0,0 +1,261 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "com_angelod_typesynth_TypeIndex.h"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+
+#include "../tsanalyze/models.h"
+#include "../tsanalyze/serialization.h"
+#include "../tsanalyze/stable_ids.h"
+#include "../tsanalyze/type_archive.h"
+#include "jni_util.h"
+
+namespace {
+
+using typesynth::TypeArchive;
+
+TypeArchive* IndexFromHandle(JNIEnv* env, jlong handle) {
+  auto* index = reinterpret_cast<TypeArchive*>(handle);
+  if (index == nullptr) {
+    typesynth::jni::Throw(env, "java/lang/IllegalStateException",
+                          "Type index is closed");
+  }
+  return index;
+}
+
+// The kind names of the plugin's TSType classes, plus one for function
+// declarations, which are not types but do use them.
+const char* KindName(uint8_t kind) {
+  switch (static_cast<typesynth::models::NodeKind>(kind)) {
+    case typesynth::models::NodeKind::kStructDeclaration:
+      return "StructType";
+    case typesynth::models::NodeKind::kUnionDeclaration:
+      return "UnionType";
+    case typesynth::models::NodeKind::kEnumDeclaration:
+      return "EnumType";
+    case typesynth::models::NodeKind::kTypedefDeclaration:
+      return "TypedefType";
+    case typesynth::models::NodeKind::kFunctionDeclaration:
+      return "FunctionDeclaration";
+    case typesynth::models::NodeKind::kPointer:
+      return "PointerType";
+    case typesynth::models::NodeKind::kReference:
+      return "ReferenceType";
+    case typesynth::models::NodeKind::kPrimitive:
+      return "PrimitiveType";
+    case typesynth::models::NodeKind::kFunction:
+      return "FunctionPrototype";
+    case typesynth::models::NodeKind::kSymbolicReference:
+      break;
+  }
+  return "";
+}
+
+// Writes the records at `indices` as [{"key": ..., "name": ..., "kind": ...}],
+// keyed as in the analysis results, stopping after `limit` of them.
+template <typename Range, typename IndexOf>
+jstring MatchesToJson(JNIEnv* env, const TypeArchive& index,
+                      const Range& matches, IndexOf index_of, jint limit) {
+  std::string json;
+  llvm::raw_string_ostream os(json);
+  llvm::json::OStream out(os);
+  out.array([&] {
+    jint count = 0;
+    for (const auto& match : matches) {
+      if (count++ == limit)
+        break;
+      const uint32_t record_index = index_of(match);
+      const typesynth::archive::NodeRecord& record =
+          index.nodes()[record_index];
+      out.object([&] {
+        out.attribute("key",
+                      absl::StrCat(absl::Hex(
+                          index.StableIdAt(record_index).value_or(0),
+                          absl::kZeroPad16)));
+        out.attribute("name", llvm::StringRef(index.String(
+                                  record.qualified_name != 0
+                                      ? record.qualified_name
+                                      : record.name)));
+        out.attribute("kind", KindName(record.kind));
+      });
+    }
+  });
+  os.flush();
+  return typesynth::jni::ToJavaString(env, json);
+}
+
+uint32_t EntryNode(const typesynth::archive::NameEntry& entry) {
+  return entry.node;
+}
+
+// Record index of the type keyed `key` in the analysis results.
+std::optional<uint32_t> IndexOfKey(const TypeArchive& index,
+                                   const std::string& key) {
+  uint64_t stable_id = 0;
+  if (!absl::SimpleHexAtoi(key, &stable_id))
+    return std::nullopt;
+  return index.IndexOfStableId(stable_id);
+}
+
+}  // namespace
+
+jlong Java_com_angelod_typesynth_TypeIndex_jniOpen(JNIEnv* env, jclass cls,
+                                                   jstring path) {
+  absl::StatusOr<TypeArchive> index =
+      TypeArchive::Open(typesynth::jni::ToStdString(env, path));
+  if (!index.ok()) {
+    typesynth::jni::Throw(env, "java/io/IOException",
+                          index.status().ToString());
+    return 0;
+  }
+  if (!index->has_index()) {
+    typesynth::jni::Throw(env, "java/io/IOException",
+                          "Type archive was written without an index");
+    return 0;
+  }
+  return reinterpret_cast<jlong>(new TypeArchive(*std::move(index)));
+}
+
+void Java_com_angelod_typesynth_TypeIndex_jniClose(JNIEnv* env, jclass cls,
+                                                   jlong handle) {
+  delete reinterpret_cast<TypeArchive*>(handle);
+}
+
+jstring Java_com_angelod_typesynth_TypeIndex_jniFind(JNIEnv* env, jclass cls,
+                                                     jlong handle,
+                                                     jstring qualifiedName) {
+  const TypeArchive* index = IndexFromHandle(env, handle);
+  if (index == nullptr)
+    return nullptr;
+  const std::string name = typesynth::jni::ToStdString(env, qualifiedName);
+  return MatchesToJson(env, *index, index->FindByName(name), EntryNode,
+                       /*limit=*/-1);
+}
+
+jstring Java_com_angelod_typesynth_TypeIndex_jniFindByPrefix(
+    JNIEnv* env, jclass cls, jlong handle, jstring prefix, jint limit) {
+  const TypeArchive* index = IndexFromHandle(env, handle);
+  if (index == nullptr)
+    return nullptr;
+  const std::string name_prefix = typesynth::jni::ToStdString(env, prefix);
+  return MatchesToJson(env, *index, index->FindByPrefix(name_prefix),
+                       EntryNode, limit);
+}
+
+jstring Java_com_angelod_typesynth_TypeIndex_jniUsersOf(JNIEnv* env,
+                                                        jclass cls,
+                                                        jlong handle,
+                                                        jstring key,
+                                                        jint limit) {
+  const TypeArchive* index = IndexFromHandle(env, handle);
+  if (index == nullptr)
+    return nullptr;
+
+  const std::optional<uint32_t> record_index =
+      IndexOfKey(*index, typesynth::jni::ToStdString(env, key));
+  std::span<const uint32_t> users;
+  if (record_index)
+    users = index->UsersOf(*record_index);
+  return MatchesToJson(env, *index, users,
+                       [](uint32_t user) { return user; }, limit);
+}
+
+void Java_com_angelod_typesynth_TypeIndex_jniWriteClosure(
+    JNIEnv* env, jclass cls, jlong handle, jobject rootNames, jobject rootKeys,
+    jobject output) {
+  const TypeArchive* index = IndexFromHandle(env, handle);
+  if (index == nullptr)
+    return;
+
+  // Each root as record indices first, then as the type ids of the registry
+  // the closure is copied into.
+  std::vector<typesynth::ClosureRoot> roots;
+  std::vector<std::vector<uint32_t>> root_records;
+  for (std::string& name : typesynth::jni::ToStringVector(env, rootNames)) {
+    std::vector<uint32_t>& records = root_records.emplace_back();
+    for (const auto& entry : index->FindByName(name))
+      records.push_back(entry.node);
+    roots.push_back({.query = std::move(name)});
+  }
+  for (std::string& key : typesynth::jni::ToStringVector(env, rootKeys)) {
+    std::vector<uint32_t>& records = root_records.emplace_back();
+    if (std::optional<uint32_t> record = IndexOfKey(*index, key))
+      records.push_back(*record);
+    roots.push_back({.query = std::move(key)});
+  }
+
+  std::vector<uint32_t> all_roots;
+  for (size_t i = 0; i < roots.size(); ++i) {
+    for (uint32_t record : root_records[i]) {
+      all_roots.push_back(record);
+      roots[i].types.push_back(TypeArchive::RegistryId(record));
+    }
+  }
+  const std::vector<uint32_t> closure = index->Closure(all_roots);
+
+  std::vector<std::pair<typesynth::TypeId, uint64_t>> stable_ids;
+  stable_ids.reserve(closure.size());
+  for (uint32_t record : closure) {
+    stable_ids.emplace_back(TypeArchive::RegistryId(record),
+                            index->StableIdAt(record).value_or(0));
+  }
+
+  // Any Java exception raised while writing is left pending for the caller.
+  typesynth::jni::OutputStreamWriter writer(env, output);
+  typesynth::WriteTypeClosureJson({}, index->ToRegistry(closure),
+                                  typesynth::StableTypeIds(stable_ids), roots,
+                                  writer);
+}
+
+jobject Java_com_angelod_typesynth_TypeIndex_jniBuffer(JNIEnv* env,
+                                                       jclass cls,
+                                                       jlong handle) {
+  const TypeArchive* index = IndexFromHandle(env, handle);
+  if (index == nullptr)
+    return nullptr;
+
+  // The buffer wraps the archive's memory without copying it; the Java side
+  // only reads it, and stops once the index is closed.
+  const std::string_view bytes = index->bytes();
+  if (bytes.size() > INT32_MAX) {
+    // Java buffers are indexed by int.
+    typesynth::jni::Throw(env, "java/lang/IllegalStateException",
+                          "Type index is too large for a ByteBuffer");
+    return nullptr;
+  }
+  return env->NewDirectByteBuffer(const_cast<char*>(bytes.data()),
+                                  static_cast<jlong>(bytes.size()));
+}
@@ -0,0 +1,91 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef COM_ANGELOD_TYPESYNTH_TYPEINDEX_H
+#define COM_ANGELOD_TYPESYNTH_TYPEINDEX_H
+
+#include <jni.h>
+
+
+extern "C" {
+
+/*
+ * Class:     com_angelod_typesynth_TypeIndex
+ * Method:    jniOpen
+ * Signature: (Ljava/lang/String;)J
+ */
+JNIEXPORT jlong JNICALL Java_com_angelod_typesynth_TypeIndex_jniOpen(
+    JNIEnv* env, jclass cls, jstring path);
+
+/*
+ * Class:     com_angelod_typesynth_TypeIndex
+ * Method:    jniClose
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_angelod_typesynth_TypeIndex_jniClose(
+    JNIEnv* env, jclass cls, jlong handle);
+
+/*
+ * Class:     com_angelod_typesynth_TypeIndex
+ * Method:    jniFind
+ * Signature: (JLjava/lang/String;)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_com_angelod_typesynth_TypeIndex_jniFind(
+    JNIEnv* env, jclass cls, jlong handle, jstring qualifiedName);
+
+/*
+ * Class:     com_angelod_typesynth_TypeIndex
+ * Method:    jniFindByPrefix
+ * Signature: (JLjava/lang/String;I)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_com_angelod_typesynth_TypeIndex_jniFindByPrefix(
+    JNIEnv* env, jclass cls, jlong handle, jstring prefix, jint limit);
+
+/*
+ * Class:     com_angelod_typesynth_TypeIndex
+ * Method:    jniUsersOf
+ * Signature: (JLjava/lang/String;I)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_com_angelod_typesynth_TypeIndex_jniUsersOf(
+    JNIEnv* env, jclass cls, jlong handle, jstring key, jint limit);
+
+/*
+ * Class:     com_angelod_typesynth_TypeIndex
+ * Method:    jniWriteClosure
+ * Signature: (JLjava/util/List;Ljava/util/List;Ljava/io/OutputStream;)V
+ */
+JNIEXPORT void JNICALL Java_com_angelod_typesynth_TypeIndex_jniWriteClosure(
+    JNIEnv* env, jclass cls, jlong handle, jobject rootNames, jobject rootKeys,
+    jobject output);
+
+/*
+ * Class:     com_angelod_typesynth_TypeIndex
+ * Method:    jniBuffer
+ * Signature: (J)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_com_angelod_typesynth_TypeIndex_jniBuffer(
+    JNIEnv* env, jclass cls, jlong handle);
+}
+
+#endif  // COM_ANGELOD_TYPESYNTH_TYPEINDEX_H
@@ -0,0 +1,137 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "jni_util.h"
+
+#include <algorithm>
+
+namespace typesynth::jni {
+namespace {
+
+constexpr size_t kChunkSize = 64 * 1024;
+
+// Calls `visit` with each element of a java.util.List, as a local reference
+// that is deleted afterwards. Stops early if a Java exception is raised.
+template <typename Visit>
+void ForEachListElement(JNIEnv* env, jobject list, Visit visit) {
+  if (list == nullptr)
+    return;
+
+  jclass list_class = env->FindClass("java/util/List");
+  jmethodID size_method = env->GetMethodID(list_class, "size", "()I");
+  jmethodID get_method =
+      env->GetMethodID(list_class, "get", "(I)Ljava/lang/Object;");
+  env->DeleteLocalRef(list_class);
+
+  const jint size = env->CallIntMethod(list, size_method);
+  for (jint i = 0; i < size && !env->ExceptionCheck(); ++i) {
+    jobject element = env->CallObjectMethod(list, get_method, i);
+    visit(element);
+    env->DeleteLocalRef(element);
+  }
+}
+
+}  // namespace
+
+std::string ToStdString(JNIEnv* env, jstring string) {
+  if (string == nullptr)
+    return {};
+  const char* chars = env->GetStringUTFChars(string, nullptr);
+  if (chars == nullptr)
+    return {};
+  std::string result(chars);
+  env->ReleaseStringUTFChars(string, chars);
+  return result;
+}
+
+jstring ToJavaString(JNIEnv* env, std::string_view string) {
+  return env->NewStringUTF(std::string(string).c_str());
+}
+
+std::vector<std::string> ToStringVector(JNIEnv* env, jobject list) {
+  std::vector<std::string> result;
+  ForEachListElement(env, list, [&](jobject element) {
+    result.push_back(ToStdString(env, static_cast<jstring>(element)));
+  });
+  return result;
+}
+
+std::vector<std::string> ToByteStringVector(JNIEnv* env, jobject list) {
+  std::vector<std::string> result;
+  ForEachListElement(env, list, [&](jobject element) {
+    auto array = static_cast<jbyteArray>(element);
+    std::string& bytes = result.emplace_back();
+    if (array == nullptr)
+      return;
+    bytes.resize(env->GetArrayLength(array));
+    env->GetByteArrayRegion(array, 0, static_cast<jsize>(bytes.size()),
+                            reinterpret_cast<jbyte*>(bytes.data()));
+  });
+  return result;
+}
+
+void Throw(JNIEnv* env, const char* class_name, std::string_view message) {
+  if (env->ExceptionCheck())
+    return;
+  jclass exception_class = env->FindClass(class_name);
+  if (exception_class == nullptr)
+    return;
+  env->ThrowNew(exception_class, std::string(message).c_str());
+  env->DeleteLocalRef(exception_class);
+}
+
+OutputStreamWriter::OutputStreamWriter(JNIEnv* env, jobject output_stream)
+    : env_(env), output_stream_(output_stream) {
+  jclass stream_class = env_->GetObjectClass(output_stream_);
+  write_method_ = env_->GetMethodID(stream_class, "write", "([BII)V");
+  env_->DeleteLocalRef(stream_class);
+  if (write_method_ != nullptr) {
+    chunk_ = env_->NewByteArray(kChunkSize);
+  }
+  failed_ = chunk_ == nullptr;
+  SetBufferSize(kChunkSize);
+}
+
+OutputStreamWriter::~OutputStreamWriter() {
+  flush();
+  if (chunk_ != nullptr) {
+    env_->DeleteLocalRef(chunk_);
+  }
+}
+
+void OutputStreamWriter::write_impl(const char* ptr, size_t size) {
+  position_ += size;
+  while (size > 0 && !failed_) {
+    const size_t length = std::min(size, kChunkSize);
+    env_->SetByteArrayRegion(chunk_, 0, length,
+                             reinterpret_cast<const jbyte*>(ptr));
+    env_->CallVoidMethod(output_stream_, write_method_, chunk_, jint{0},
+                         static_cast<jint>(length));
+    failed_ = env_->ExceptionCheck();
+    ptr += length;
+    size -= length;
+  }
+}
+
+}  // namespace typesynth::jni
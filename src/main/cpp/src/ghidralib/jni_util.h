@@ -0,0 +1,80 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JNI_UTIL_H
+#define JNI_UTIL_H
+
+#include <jni.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <llvm/Support/raw_ostream.h>
+
+namespace typesynth::jni {
+
+// Converts a Java string to UTF-8. Returns an empty string for null.
+std::string ToStdString(JNIEnv* env, jstring string);
+
+// Converts a UTF-8 string to a new local Java string reference.
+jstring ToJavaString(JNIEnv* env, std::string_view string);
+
+// Converts a java.util.List<String> to a vector of UTF-8 strings.
+std::vector<std::string> ToStringVector(JNIEnv* env, jobject list);
+
+// Converts a java.util.List<byte[]> to a vector of byte strings, copying the
+// bytes as they are.
+std::vector<std::string> ToByteStringVector(JNIEnv* env, jobject list);
+
+// Throws a new exception of class `class_name` unless one is already pending.
+void Throw(JNIEnv* env, const char* class_name, std::string_view message);
+
+// Stream that forwards everything written to it to a java.io.OutputStream in
+// fixed-size chunks, reusing one Java byte array for all of them. Once the
+// Java side throws, the exception is left pending and further output is
+// dropped; failed() reports it.
+class OutputStreamWriter : public llvm::raw_ostream {
+ public:
+  OutputStreamWriter(JNIEnv* env, jobject output_stream);
+  ~OutputStreamWriter() override;
+
+  [[nodiscard]] bool failed() const { return failed_; }
+
+ private:
+  void write_impl(const char* ptr, size_t size) override;
+  uint64_t current_pos() const override { return position_; }
+
+  JNIEnv* env_;
+  jobject output_stream_;
+  jmethodID write_method_ = nullptr;
+  jbyteArray chunk_ = nullptr;
+  uint64_t position_ = 0;
+  bool failed_ = false;
+};
+
+}  // namespace typesynth::jni
+
+#endif  //JNI_UTIL_H
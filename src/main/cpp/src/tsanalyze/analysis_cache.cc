@@ -0,0 +1,95 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "analysis_cache.h"
+
+#include <clang/Basic/FileManager.h>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <llvm/Support/FileSystem.h>
+
+#include "absl/strings/str_cat.h"
+#include "dependency_manifest.h"
+#include "hashing.h"
+#include "type_archive.h"
+
+namespace typesynth {
+
+AnalysisCache::AnalysisCache(std::string cache_directory)
+    : cache_directory_(std::move(cache_directory)) {}
+
+absl::StatusOr<uint64_t> AnalysisCache::KeyFor(
+    const clang::CompilerInvocation& invocation,
+    clang::FileManager& file_manager, const std::string& main_file) const {
+  auto buffer = file_manager.getBufferForFile(main_file);
+  if (!buffer) {
+    return absl::NotFoundError(absl::StrCat("File not found: ", main_file));
+  }
+
+  HashBuilder hash;
+  hash.Add((*buffer)->getBuffer());
+  for (const std::string& arg : invocation.getCC1CommandLine()) {
+    hash.Add(arg);
+  }
+  return hash.value();
+}
+
+std::optional<TypeRegistry> AnalysisCache::Lookup(
+    uint64_t key, llvm::vfs::FileSystem& file_system) const {
+  const std::string entry_path = EntryPath(key);
+  if (!IsDependencyManifestCurrent(entry_path + ".deps", file_system))
+    return std::nullopt;
+
+  absl::StatusOr<TypeArchive> types =
+      TypeArchive::Open(entry_path + ".types");
+  if (!types.ok())
+    return std::nullopt;
+  return types->ToRegistry();
+}
+
+absl::Status AnalysisCache::Store(uint64_t key, const TypeRegistry& registry,
+                                  llvm::ArrayRef<std::string> dependencies,
+                                  llvm::vfs::FileSystem& file_system) const {
+  if (std::error_code error =
+          llvm::sys::fs::create_directories(cache_directory_)) {
+    return absl::InternalError(error.message());
+  }
+
+  const std::string entry_path = EntryPath(key);
+  // Entries are only ever read back whole, so they go without an index.
+  if (absl::Status status = WriteTypeArchive(registry, entry_path + ".types",
+                                             /*with_index=*/false);
+      !status.ok()) {
+    return status;
+  }
+
+  // Written last: a current manifest vouches for the types next to it.
+  return WriteDependencyManifest(entry_path + ".deps", dependencies,
+                                 file_system);
+}
+
+std::string AnalysisCache::EntryPath(uint64_t key) const {
+  return absl::StrCat(cache_directory_, "/", absl::Hex(key, absl::kZeroPad16));
+}
+
+}  // namespace typesynth
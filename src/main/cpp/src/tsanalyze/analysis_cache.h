@@ -0,0 +1,83 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ANALYSIS_CACHE_H
+#define ANALYSIS_CACHE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include <llvm/ADT/ArrayRef.h>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+#include "type_registry.h"
+
+namespace clang {
+class CompilerInvocation;
+class FileManager;
+}  // namespace clang
+
+namespace llvm::vfs {
+class FileSystem;
+}  // namespace llvm::vfs
+
+namespace typesynth {
+
+// On-disk cache of the types extracted from each translation unit. Entries
+// are addressed by the main file's contents and the full compiler command
+// line, and are only served while every file the translation unit read still
+// has the contents it had when the entry was stored. Types are stored as type
+// archives without a name index; entries written in an older archive version
+// fail to open and are treated as misses. Stateless apart from the directory,
+// so it is safe to share between threads and processes.
+class AnalysisCache {
+ public:
+  explicit AnalysisCache(std::string cache_directory);
+
+  // Returns the key for analyzing `main_file` under `invocation`.
+  absl::StatusOr<uint64_t> KeyFor(const clang::CompilerInvocation& invocation,
+                                  clang::FileManager& file_manager,
+                                  const std::string& main_file) const;
+
+  // Returns the types stored under `key`, or nothing when there are none or
+  // any of their dependencies changed.
+  [[nodiscard]] std::optional<TypeRegistry> Lookup(
+      uint64_t key, llvm::vfs::FileSystem& file_system) const;
+
+  absl::Status Store(uint64_t key, const TypeRegistry& registry,
+                     llvm::ArrayRef<std::string> dependencies,
+                     llvm::vfs::FileSystem& file_system) const;
+
+ private:
+  [[nodiscard]] std::string EntryPath(uint64_t key) const;
+
+  std::string cache_directory_;
+};
+
+}  // namespace typesynth
+
+#endif  //ANALYSIS_CACHE_H
@@ -0,0 +1,633 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "analysis_daemon.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <utility>
+
+#include <llvm/ADT/STLFunctionalExtras.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "serialization.h"
+#include "stable_ids.h"
+#include "type_archive.h"
+
+namespace typesynth {
+
+namespace {
+
+// Closes a file descriptor when it goes out of scope.
+class ScopedFd {
+ public:
+  explicit ScopedFd(int fd) : fd_(fd) {}
+  ~ScopedFd() {
+    if (fd_ >= 0)
+      ::close(fd_);
+  }
+  ScopedFd(const ScopedFd&) = delete;
+  ScopedFd& operator=(const ScopedFd&) = delete;
+
+  [[nodiscard]] int get() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+absl::StatusOr<sockaddr_un> SocketAddress(const std::string& socket_path) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unusable socket path: ", socket_path));
+  }
+  std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+  return address;
+}
+
+absl::StatusOr<int> Connect(const std::string& socket_path) {
+  absl::StatusOr<sockaddr_un> address = SocketAddress(socket_path);
+  if (!address.ok())
+    return address.status();
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return absl::ErrnoToStatus(errno, "Cannot create a socket");
+  if (::connect(fd, reinterpret_cast<const sockaddr*>(&*address),
+                sizeof(*address)) != 0) {
+    const int error = errno;
+    ::close(fd);
+    return absl::UnavailableError(
+        absl::StrCat("No analysis server on ", socket_path, ": ",
+                     std::strerror(error)));
+  }
+  return fd;
+}
+
+// Reads newline-terminated messages from a socket.
+class LineReader {
+ public:
+  explicit LineReader(int fd) : fd_(fd) {}
+
+  // Reads the next line, without its newline, into `line`. Returns false at
+  // the end of the stream.
+  bool ReadLine(std::string& line) {
+    line.clear();
+    return ConsumeLine([&](llvm::StringRef chunk) { line.append(chunk); });
+  }
+
+  // Copies the next line to `os` as it arrives, without buffering all of it.
+  bool CopyLine(llvm::raw_ostream& os) {
+    return ConsumeLine([&](llvm::StringRef chunk) { os << chunk; });
+  }
+
+ private:
+  // Passes the rest of the current line to `consume` piecewise, and returns
+  // whether it ended with a newline.
+  bool ConsumeLine(llvm::function_ref<void(llvm::StringRef)> consume) {
+    while (true) {
+      if (begin_ == end_) {
+        ssize_t read;
+        do {
+          read = ::read(fd_, buffer_.data(), buffer_.size());
+        } while (read < 0 && errno == EINTR);
+        if (read <= 0)
+          return false;
+        begin_ = 0;
+        end_ = static_cast<size_t>(read);
+      }
+
+      const char* start = buffer_.data() + begin_;
+      const size_t available = end_ - begin_;
+      const auto* newline =
+          static_cast<const char*>(std::memchr(start, '\n', available));
+      if (newline) {
+        consume(llvm::StringRef(start, newline - start));
+        begin_ += newline - start + 1;
+        return true;
+      }
+      consume(llvm::StringRef(start, available));
+      begin_ = end_;
+    }
+  }
+
+  int fd_;
+  std::array<char, 64 * 1024> buffer_;
+  size_t begin_ = 0;
+  size_t end_ = 0;
+};
+
+// Writes the events answering a request to the client. Once the client has
+// gone away, the remaining events are dropped.
+class EventStream {
+ public:
+  explicit EventStream(int fd) : os_(fd, /*shouldClose=*/false) {}
+  // raw_fd_ostream aborts on destruction if an error is left set.
+  ~EventStream() { os_.clear_error(); }
+
+  bool Progress(const AnalysisProgress& progress) {
+    return Write("progress", [&](llvm::json::OStream& json) {
+      json.attribute("unitsDone", static_cast<int64_t>(progress.units_done));
+      json.attribute("unitsTotal", static_cast<int64_t>(progress.units_total));
+      json.attribute("typesExtracted",
+                     static_cast<int64_t>(progress.types_extracted));
+      json.attribute("currentFile", progress.current_file);
+    });
+  }
+
+  bool Result(const std::function<void(llvm::raw_ostream&)>& write) {
+    if (!Write("result", nullptr))
+      return false;
+    write(os_);
+    os_ << '\n';
+    os_.flush();
+    return !os_.has_error();
+  }
+
+  bool Done(const absl::Status& status) {
+    return Write("done", [&](llvm::json::OStream& json) {
+      json.attribute("code", static_cast<int64_t>(status.code()));
+      json.attribute("message", std::string(status.message()));
+    });
+  }
+
+ private:
+  bool Write(llvm::StringRef event,
+             llvm::function_ref<void(llvm::json::OStream&)> attributes) {
+    if (os_.has_error())
+      return false;
+    {
+      llvm::json::OStream json(os_);
+      json.object([&] {
+        json.attribute("event", event);
+        if (attributes)
+          attributes(json);
+      });
+    }
+    os_ << '\n';
+    os_.flush();
+    return !os_.has_error();
+  }
+
+  llvm::raw_fd_ostream os_;
+};
+
+void WriteRequest(llvm::json::OStream& json, const AnalysisRequest& request) {
+  auto strings = [&](llvm::StringRef key,
+                     const std::vector<std::string>& values) {
+    json.attributeArray(key, [&] {
+      for (const std::string& value : values)
+        json.value(value);
+    });
+  };
+
+  json.object([&] {
+    json.attribute("method", "analyze");
+    if (request.compilation_database.empty()) {
+      strings("files", request.files);
+    } else {
+      json.attribute("compilationDatabase", request.compilation_database);
+    }
+    strings("flags", request.flags);
+    json.attribute("workers", static_cast<int64_t>(request.num_workers));
+    strings("targets", request.targets);
+    strings("roots", request.filter.roots);
+    strings("allowFiles", request.filter.file_globs);
+    if (!request.delta_from.empty())
+      json.attribute("deltaFrom", request.delta_from);
+  });
+}
+
+absl::StatusOr<AnalysisRequest> ParseRequest(const llvm::json::Object& object) {
+  auto strings = [&](llvm::StringRef key, std::vector<std::string>& values) {
+    const llvm::json::Array* array = object.getArray(key);
+    if (!array)
+      return true;
+    for (const llvm::json::Value& value : *array) {
+      std::optional<llvm::StringRef> string = value.getAsString();
+      if (!string)
+        return false;
+      values.emplace_back(*string);
+    }
+    return true;
+  };
+
+  AnalysisRequest request;
+  if (!strings("files", request.files) || !strings("flags", request.flags) ||
+      !strings("targets", request.targets) ||
+      !strings("roots", request.filter.roots) ||
+      !strings("allowFiles", request.filter.file_globs)) {
+    return absl::InvalidArgumentError(
+        "\"files\", \"flags\", \"targets\", \"roots\" and \"allowFiles\" "
+        "must be arrays of strings");
+  }
+  request.compilation_database =
+      object.getString("compilationDatabase").value_or("").str();
+  request.delta_from = object.getString("deltaFrom").value_or("").str();
+  request.num_workers =
+      static_cast<unsigned>(object.getInteger("workers").value_or(0));
+  if (request.files.empty() == request.compilation_database.empty()) {
+    return absl::InvalidArgumentError(
+        "An analyze request needs either \"files\" or "
+        "\"compilationDatabase\"");
+  }
+  return request;
+}
+
+// Reads the events answering a request until "done", and returns the status
+// it carries.
+absl::Status ReadEvents(int fd, const ProgressCallback& progress,
+                        llvm::raw_ostream& result) {
+  LineReader reader(fd);
+  std::string line;
+  while (reader.ReadLine(line)) {
+    llvm::Expected<llvm::json::Value> event = llvm::json::parse(line);
+    if (!event) {
+      return absl::DataLossError(
+          absl::StrCat("Malformed event from the analysis server: ",
+                       llvm::toString(event.takeError())));
+    }
+    const llvm::json::Object* object = event->getAsObject();
+    const std::optional<llvm::StringRef> name =
+        object ? object->getString("event") : std::nullopt;
+    if (!name) {
+      return absl::DataLossError(
+          absl::StrCat("Malformed event from the analysis server: ", line));
+    }
+
+    if (*name == "progress") {
+      if (progress) {
+        progress({.units_done = static_cast<size_t>(
+                      object->getInteger("unitsDone").value_or(0)),
+                  .units_total = static_cast<size_t>(
+                      object->getInteger("unitsTotal").value_or(0)),
+                  .types_extracted = static_cast<size_t>(
+                      object->getInteger("typesExtracted").value_or(0)),
+                  .current_file =
+                      object->getString("currentFile").value_or("").str()});
+      }
+    } else if (*name == "result") {
+      if (!reader.CopyLine(result))
+        break;
+    } else if (*name == "done") {
+      return absl::Status(
+          static_cast<absl::StatusCode>(object->getInteger("code").value_or(
+              static_cast<int64_t>(absl::StatusCode::kUnknown))),
+          object->getString("message").value_or("").str());
+    }
+  }
+  // The server is gone without finishing, which is what a clang crash looks
+  // like from here.
+  return absl::UnavailableError(
+      "The analysis server closed the connection before finishing the "
+      "request; it may have crashed");
+}
+
+// Sends one request, written by `write`, on a new connection to the server
+// and reads the events answering it.
+absl::Status Request(const std::string& socket_path,
+                     llvm::function_ref<void(llvm::json::OStream&)> write,
+                     const ProgressCallback& progress,
+                     llvm::raw_ostream& result) {
+  absl::StatusOr<int> connected = Connect(socket_path);
+  if (!connected.ok())
+    return connected.status();
+  ScopedFd fd(*connected);
+
+  {
+    llvm::raw_fd_ostream os(fd.get(), /*shouldClose=*/false);
+    {
+      llvm::json::OStream json(os);
+      write(json);
+    }
+    os << '\n';
+    os.flush();
+    if (os.has_error()) {
+      const std::error_code error = os.error();
+      os.clear_error();
+      return absl::UnavailableError(absl::StrCat(
+          "Cannot send to the analysis server: ", error.message()));
+    }
+  }
+  return ReadEvents(fd.get(), progress, result);
+}
+
+}  // namespace
+
+struct AnalysisServer::Session {
+  explicit Session(const std::vector<std::string>& flags) : analyzer(flags) {}
+
+  // Held for the duration of each request.
+  std::mutex mutex;
+  TypeAnalyzer analyzer;
+  // Guarded by `sessions_mutex_`.
+  uint64_t last_used = 0;
+};
+
+AnalysisServer::AnalysisServer(Options options)
+    : options_(std::move(options)) {}
+
+AnalysisServer::~AnalysisServer() {
+  if (listen_fd_ >= 0) {
+    ::close(listen_fd_);
+    ::unlink(socket_path_.c_str());
+  }
+  for (int fd : wake_fds_) {
+    if (fd >= 0)
+      ::close(fd);
+  }
+}
+
+absl::Status AnalysisServer::Listen(const std::string& socket_path) {
+  absl::StatusOr<sockaddr_un> address = SocketAddress(socket_path);
+  if (!address.ok())
+    return address.status();
+
+  // A socket file that nobody answers on was left by a server that is gone.
+  if (absl::StatusOr<int> existing = Connect(socket_path); existing.ok()) {
+    ::close(*existing);
+    return absl::AlreadyExistsError(
+        absl::StrCat("An analysis server is already listening on ",
+                     socket_path));
+  }
+  ::unlink(socket_path.c_str());
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return absl::ErrnoToStatus(errno, "Cannot create a socket");
+  if (::bind(fd, reinterpret_cast<const sockaddr*>(&*address),
+             sizeof(*address)) != 0 ||
+      ::chmod(socket_path.c_str(), S_IRUSR | S_IWUSR) != 0 ||
+      ::listen(fd, SOMAXCONN) != 0 || ::pipe(wake_fds_) != 0) {
+    const int error = errno;
+    ::close(fd);
+    return absl::ErrnoToStatus(error,
+                               absl::StrCat("Cannot listen on ", socket_path));
+  }
+
+  listen_fd_ = fd;
+  socket_path_ = socket_path;
+  return absl::OkStatus();
+}
+
+absl::Status AnalysisServer::Serve() {
+  if (listen_fd_ < 0)
+    return absl::FailedPreconditionError("The server is not listening");
+
+  absl::Status status;
+  while (!stopping_) {
+    pollfd fds[] = {{.fd = listen_fd_, .events = POLLIN, .revents = 0},
+                    {.fd = wake_fds_[0], .events = POLLIN, .revents = 0}};
+    if (::poll(fds, 2, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      status = absl::ErrnoToStatus(errno, "Cannot wait for clients");
+      break;
+    }
+    if (fds[1].revents != 0 || !(fds[0].revents & POLLIN))
+      continue;
+
+    const int fd = ::accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      status = absl::ErrnoToStatus(errno, "Cannot accept a client");
+      break;
+    }
+    {
+      std::lock_guard lock(connections_mutex_);
+      connections_.insert(fd);
+    }
+    std::thread([this, fd] {
+      HandleConnection(fd);
+      // Closed under the lock, so that Serve never shuts down a descriptor
+      // that was reused in the meantime.
+      std::lock_guard lock(connections_mutex_);
+      connections_.erase(fd);
+      ::close(fd);
+      if (connections_.empty())
+        connections_done_.notify_all();
+    }).detach();
+  }
+
+  // Clients idling on a connection would hold up the shutdown forever; they
+  // find it closed after their current request instead.
+  std::unique_lock lock(connections_mutex_);
+  for (int fd : connections_)
+    ::shutdown(fd, SHUT_RD);
+  connections_done_.wait(lock, [this] { return connections_.empty(); });
+  return status;
+}
+
+void AnalysisServer::Stop() {
+  stopping_ = true;
+  if (wake_fds_[1] >= 0) {
+    const char wake = 0;
+    [[maybe_unused]] ssize_t written = ::write(wake_fds_[1], &wake, 1);
+  }
+}
+
+void AnalysisServer::HandleConnection(int fd) {
+  LineReader reader(fd);
+  std::string line;
+  while (!stopping_ && reader.ReadLine(line)) {
+    llvm::Expected<llvm::json::Value> message = llvm::json::parse(line);
+    if (!message) {
+      EventStream(fd).Done(absl::InvalidArgumentError(absl::StrCat(
+          "Malformed request: ", llvm::toString(message.takeError()))));
+      continue;
+    }
+    const llvm::json::Object* object = message->getAsObject();
+    const std::optional<llvm::StringRef> method =
+        object ? object->getString("method") : std::nullopt;
+
+    if (method == "analyze") {
+      absl::StatusOr<AnalysisRequest> request = ParseRequest(*object);
+      if (request.ok()) {
+        Analyze(*request, fd);
+      } else {
+        EventStream(fd).Done(request.status());
+      }
+    } else if (method == "shutdown") {
+      Stop();
+      EventStream(fd).Done(absl::OkStatus());
+    } else {
+      EventStream(fd).Done(
+          absl::InvalidArgumentError(absl::StrCat("Unknown request: ", line)));
+    }
+  }
+}
+
+void AnalysisServer::Analyze(const AnalysisRequest& request, int fd) {
+  EventStream events(fd);
+  std::shared_ptr<Session> session = SessionFor(request.flags);
+  std::lock_guard lock(session->mutex);
+  TypeAnalyzer& analyzer = session->analyzer;
+
+  if (absl::Status targets = analyzer.SetTargets(request.targets);
+      !targets.ok()) {
+    events.Done(targets);
+    return;
+  }
+  if (absl::Status filter = analyzer.SetExtractionFilter(request.filter);
+      !filter.ok()) {
+    events.Done(filter);
+    return;
+  }
+  analyzer.ResetCancellation();
+  analyzer.SetProgressCallback([&](const AnalysisProgress& progress) {
+    // A client that hung up has no use for the rest of the analysis.
+    if (!events.Progress(progress))
+      analyzer.Cancel();
+  });
+  absl::Status status =
+      request.compilation_database.empty()
+          ? analyzer.AnalyzeSourceFiles(request.files, request.num_workers)
+          : analyzer.AnalyzeProject(request.compilation_database,
+                                    request.num_workers);
+  analyzer.SetProgressCallback(nullptr);
+
+  std::optional<TypeDelta> delta;
+  if (!request.delta_from.empty()) {
+    absl::StatusOr<TypeArchive> previous =
+        TypeArchive::Open(request.delta_from);
+    if (!previous.ok()) {
+      analyzer.Reset();
+      events.Done(previous.status());
+      return;
+    }
+    delta = DiffTypes(previous->ToRegistry(), analyzer.type_registry());
+  }
+
+  AnalysisInputs inputs;
+  if (request.compilation_database.empty()) {
+    inputs.main_file = request.files.front();
+    inputs.files = request.files;
+  } else {
+    inputs.main_file = request.compilation_database;
+    inputs.files = {request.compilation_database};
+  }
+  inputs.clang_flags = request.flags;
+  events.Result([&](llvm::raw_ostream& os) {
+    WriteAnalysisJson(inputs, analyzer.type_registry(), os,
+                      &analyzer.metrics(), delta ? &*delta : nullptr);
+  });
+
+  // The next request may well be for files that changed in between.
+  analyzer.Reset();
+  events.Done(status);
+}
+
+std::shared_ptr<AnalysisServer::Session> AnalysisServer::SessionFor(
+    const std::vector<std::string>& flags) {
+  std::lock_guard lock(sessions_mutex_);
+  std::shared_ptr<Session>& session = sessions_[flags];
+  if (!session) {
+    session = std::make_shared<Session>(flags);
+    if (options_.pch_cache_directory)
+      session->analyzer.SetPchCacheDirectory(*options_.pch_cache_directory);
+    if (options_.analysis_cache_directory) {
+      session->analyzer.SetAnalysisCacheDirectory(
+          *options_.analysis_cache_directory);
+    }
+    if (options_.memory_budget)
+      session->analyzer.SetMemoryBudget(*options_.memory_budget);
+  }
+  session->last_used = ++session_clock_;
+
+  // Requests still running on a dropped session keep it alive until they
+  // finish.
+  while (sessions_.size() > std::max<size_t>(1, options_.max_sessions)) {
+    sessions_.erase(std::min_element(
+        sessions_.begin(), sessions_.end(), [](const auto& a, const auto& b) {
+          return a.second->last_used < b.second->last_used;
+        }));
+  }
+  return session;
+}
+
+std::string DefaultDaemonSocketPath() {
+  if (const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+      runtime && *runtime) {
+    return absl::StrCat(runtime, "/typesynth.sock");
+  }
+  llvm::SmallString<128> path;
+  llvm::sys::path::system_temp_directory(/*ErasedOnReboot=*/true, path);
+  llvm::sys::path::append(path,
+                          absl::StrCat("typesynth-", ::getuid(), ".sock"));
+  return std::string(path);
+}
+
+absl::Status RequestAnalysis(const std::string& socket_path,
+                             const AnalysisRequest& request,
+                             const ProgressCallback& progress,
+                             llvm::raw_ostream& result) {
+  // The server has a working directory of its own.
+  AnalysisRequest absolute = request;
+  auto make_absolute = [](std::string& path) {
+    if (path.empty())
+      return;
+    llvm::SmallString<256> absolute_path(path);
+    llvm::sys::fs::make_absolute(absolute_path);
+    path = std::string(absolute_path);
+  };
+  for (std::string& file : absolute.files)
+    make_absolute(file);
+  make_absolute(absolute.compilation_database);
+  make_absolute(absolute.delta_from);
+
+  return Request(
+      socket_path,
+      [&](llvm::json::OStream& json) { WriteRequest(json, absolute); },
+      progress, result);
+}
+
+absl::Status RequestShutdown(const std::string& socket_path) {
+  return Request(
+      socket_path,
+      [](llvm::json::OStream& json) {
+        json.object([&] { json.attribute("method", "shutdown"); });
+      },
+      nullptr, llvm::nulls());
+}
+
+}  // namespace typesynth
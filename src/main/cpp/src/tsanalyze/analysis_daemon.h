@@ -0,0 +1,164 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ANALYSIS_DAEMON_H
+#define ANALYSIS_DAEMON_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "absl/status/status.h"
+
+#include "tsanalyze.h"
+
+namespace llvm {
+class raw_ostream;
+}  // namespace llvm
+
+namespace typesynth {
+
+// An analysis a client asks an AnalysisServer for. Exactly one of `files` and
+// `compilation_database` is set.
+struct AnalysisRequest {
+  std::vector<std::string> files;
+  std::string compilation_database;
+  std::vector<std::string> flags;
+  unsigned num_workers = 0;
+  std::vector<std::string> targets;
+  // Limits what is extracted, see TypeAnalyzer::SetExtractionFilter.
+  ExtractionFilter filter;
+  // A type archive of an earlier analysis; when set, only what changed since
+  // is sent back.
+  std::string delta_from;
+};
+
+// Serves analyses to local clients over a Unix domain socket. An analyzer is
+// kept alive per set of clang flags between requests, so that precompiled
+// headers, caches and worker threads stay warm, and clang runs outside the
+// clients' processes, so a header that crashes it takes down the server
+// rather than, say, Ghidra.
+//
+// Clients send one request per line, as a JSON object:
+//
+//   {"method": "analyze", "files": [...] or "compilationDatabase": <path>,
+//    "flags": [...], "workers": <n>, "targets": [...], "roots": [...],
+//    "allowFiles": [...], "deltaFrom": <path>}
+//   {"method": "shutdown"}
+//
+// Every field but "method" and the inputs is optional. The server answers
+// each request with a line per event:
+//
+//   {"event": "progress", "unitsDone": <n>, "unitsTotal": <n>,
+//    "typesExtracted": <n>, "currentFile": <path>}
+//   {"event": "result"}, followed by a line with the WriteAnalysisJson
+//     document of the types extracted
+//   {"event": "done", "code": <absl::StatusCode>, "message": <string>}
+//
+// "done" ends every request; "code" is 0 when it succeeded. A failed analysis
+// still sends a result for the files that could be analyzed.
+class AnalysisServer {
+ public:
+  struct Options {
+    // Passed on to every analyzer, see the TypeAnalyzer setters; unset keeps
+    // the analyzer's default.
+    std::optional<std::string> pch_cache_directory;
+    std::optional<std::string> analysis_cache_directory;
+    std::optional<uint64_t> memory_budget;
+    // How many analyzers, each with its own flags, are kept warm at once.
+    size_t max_sessions = 4;
+  };
+
+  explicit AnalysisServer(Options options);
+  ~AnalysisServer();
+  AnalysisServer(const AnalysisServer&) = delete;
+  AnalysisServer& operator=(const AnalysisServer&) = delete;
+
+  // Binds `socket_path`, readable and writable by the current user only. A
+  // socket file left behind by a server that is gone is replaced.
+  absl::Status Listen(const std::string& socket_path);
+
+  // Accepts clients, each on its own thread, until one asks to shut down or
+  // Stop is called, then waits for the ongoing requests to finish.
+  absl::Status Serve();
+
+  // Makes Serve return. Safe to call from any thread or a signal handler.
+  void Stop();
+
+ private:
+  struct Session;
+
+  void HandleConnection(int fd);
+  // Runs an analyze request and writes its events to `fd`.
+  void Analyze(const AnalysisRequest& request, int fd);
+  // The warm session for `flags`, created, and the least recently used one
+  // dropped, as needed.
+  std::shared_ptr<Session> SessionFor(const std::vector<std::string>& flags);
+
+  const Options options_;
+  std::string socket_path_;
+  int listen_fd_ = -1;
+  // Written to by Stop to wake up Serve.
+  int wake_fds_[2] = {-1, -1};
+  std::atomic<bool> stopping_ = false;
+
+  std::mutex sessions_mutex_;
+  std::map<std::vector<std::string>, std::shared_ptr<Session>> sessions_;
+  uint64_t session_clock_ = 0;
+
+  std::mutex connections_mutex_;
+  std::condition_variable connections_done_;
+  // Sockets of the clients being served.
+  std::unordered_set<int> connections_;
+};
+
+// Where servers listen and clients connect unless told otherwise: a socket in
+// $XDG_RUNTIME_DIR, or a per-user one in the temporary directory.
+std::string DefaultDaemonSocketPath();
+
+// Sends `request` to the server listening on `socket_path`, passing its
+// progress reports to `progress` if set, and streams the resulting document
+// to `result`. Relative input paths are resolved here, but flags are passed
+// as they are, so include paths in them should be absolute. Returns the error
+// the analysis failed with, if any, after writing the types it still
+// extracted.
+absl::Status RequestAnalysis(const std::string& socket_path,
+                             const AnalysisRequest& request,
+                             const ProgressCallback& progress,
+                             llvm::raw_ostream& result);
+
+// Asks the server listening on `socket_path` to shut down once its ongoing
+// requests finish.
+absl::Status RequestShutdown(const std::string& socket_path);
+
+}  // namespace typesynth
+
+#endif  //ANALYSIS_DAEMON_H
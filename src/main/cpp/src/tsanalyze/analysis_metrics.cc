@@ -0,0 +1,142 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "analysis_metrics.h"
+
+#include <algorithm>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace typesynth {
+namespace {
+
+double Milliseconds(double seconds) { return seconds * 1000; }
+
+}  // namespace
+
+void AnalysisMetrics::Add(const AnalysisMetrics& other) {
+  analysis_cache_seconds += other.analysis_cache_seconds;
+  pch_seconds += other.pch_seconds;
+  frontend_seconds += other.frontend_seconds;
+  extraction_seconds += other.extraction_seconds;
+  merge_seconds += other.merge_seconds;
+  deduplication_seconds += other.deduplication_seconds;
+  serialization_seconds += other.serialization_seconds;
+  types_created += other.types_created;
+  type_id_cache_hits += other.type_id_cache_hits;
+  type_id_cache_misses += other.type_id_cache_misses;
+  analysis_cache_hits += other.analysis_cache_hits;
+  analysis_cache_misses += other.analysis_cache_misses;
+  header_fragment_hits += other.header_fragment_hits;
+  header_fragment_misses += other.header_fragment_misses;
+  bytes_emitted += other.bytes_emitted;
+  peak_resident_bytes =
+      std::max(peak_resident_bytes, other.peak_resident_bytes);
+  units.insert(units.end(), other.units.begin(), other.units.end());
+}
+
+void AnalysisMetrics::Add(const UnitMetrics& unit) {
+  frontend_seconds += unit.frontend_seconds;
+  extraction_seconds += unit.extraction_seconds;
+  types_created += unit.types_created;
+  units.push_back(unit);
+}
+
+void WriteMetricsJson(const AnalysisMetrics& metrics, llvm::raw_ostream& os) {
+  llvm::json::OStream json(os);
+  json.object([&] {
+    json.attributeObject("phasesMs", [&] {
+      json.attribute("analysisCache",
+                     Milliseconds(metrics.analysis_cache_seconds));
+      json.attribute("precompiledHeaders", Milliseconds(metrics.pch_seconds));
+      json.attribute("frontend", Milliseconds(metrics.frontend_seconds));
+      json.attribute("extraction", Milliseconds(metrics.extraction_seconds));
+      json.attribute("merge", Milliseconds(metrics.merge_seconds));
+      json.attribute("deduplication",
+                     Milliseconds(metrics.deduplication_seconds));
+      json.attribute("serialization",
+                     Milliseconds(metrics.serialization_seconds));
+    });
+    json.attribute("typesCreated", static_cast<int64_t>(metrics.types_created));
+    json.attribute("typeIdCacheHits",
+                   static_cast<int64_t>(metrics.type_id_cache_hits));
+    json.attribute("typeIdCacheMisses",
+                   static_cast<int64_t>(metrics.type_id_cache_misses));
+    const size_t lookups =
+        metrics.type_id_cache_hits + metrics.type_id_cache_misses;
+    json.attribute("typeIdCacheHitRate",
+                   lookups ? static_cast<double>(metrics.type_id_cache_hits) /
+                                 lookups
+                           : 0.0);
+    json.attribute("analysisCacheHits",
+                   static_cast<int64_t>(metrics.analysis_cache_hits));
+    json.attribute("analysisCacheMisses",
+                   static_cast<int64_t>(metrics.analysis_cache_misses));
+    json.attribute("headerFragmentHits",
+                   static_cast<int64_t>(metrics.header_fragment_hits));
+    json.attribute("headerFragmentMisses",
+                   static_cast<int64_t>(metrics.header_fragment_misses));
+    json.attribute("bytesEmitted", static_cast<int64_t>(metrics.bytes_emitted));
+    json.attribute("peakResidentBytes",
+                   static_cast<int64_t>(metrics.peak_resident_bytes));
+    json.attributeArray("units", [&] {
+      for (const UnitMetrics& unit : metrics.units) {
+        json.object([&] {
+          json.attribute("file", unit.file);
+          json.attribute("cacheHit", unit.cache_hit);
+          json.attribute("totalMs", Milliseconds(unit.seconds));
+          json.attribute("frontendMs", Milliseconds(unit.frontend_seconds));
+          json.attribute("extractionMs",
+                         Milliseconds(unit.extraction_seconds));
+          json.attribute("typesCreated",
+                         static_cast<int64_t>(unit.types_created));
+          json.attribute("residentBytes",
+                         static_cast<int64_t>(unit.resident_bytes));
+        });
+      }
+    });
+  });
+}
+
+TimeTraceRecording::TimeTraceRecording(std::optional<unsigned> granularity_us,
+                                       std::string& output) {
+  if (!granularity_us || llvm::getTimeTraceProfilerInstance())
+    return;
+  llvm::timeTraceProfilerInitialize(*granularity_us, "typesynth");
+  output_ = &output;
+}
+
+TimeTraceRecording::~TimeTraceRecording() {
+  if (!output_)
+    return;
+  llvm::SmallString<0> trace;
+  llvm::raw_svector_ostream os(trace);
+  llvm::timeTraceProfilerWrite(os);
+  llvm::timeTraceProfilerCleanup();
+  output_->assign(trace.begin(), trace.end());
+}
+
+}  // namespace typesynth
@@ -0,0 +1,146 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ANALYSIS_METRICS_H
+#define ANALYSIS_METRICS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/TimeProfiler.h>
+
+namespace llvm {
+class raw_ostream;
+}  // namespace llvm
+
+namespace typesynth {
+
+// Timings and counters for one translation unit.
+struct UnitMetrics {
+  std::string file;
+  // Served from the analysis cache without running clang.
+  bool cache_hit = false;
+  double seconds = 0;
+  // Preprocessing and parsing, without the extraction interleaved with them.
+  double frontend_seconds = 0;
+  double extraction_seconds = 0;
+  size_t types_created = 0;
+  // Resident set size of the process once the unit's AST was complete, which
+  // is about when the unit needs the most memory. Includes whatever other
+  // units were running alongside.
+  uint64_t resident_bytes = 0;
+};
+
+// Instrumentation gathered by a TypeAnalyzer over its lifetime, plus the
+// serializer's when it is handed one. Phase times are wall times summed over
+// translation units, so with several workers they can add up to more than the
+// elapsed time.
+struct AnalysisMetrics {
+  double analysis_cache_seconds = 0;
+  double pch_seconds = 0;
+  double frontend_seconds = 0;
+  double extraction_seconds = 0;
+  double merge_seconds = 0;
+  double deduplication_seconds = 0;
+  double serialization_seconds = 0;
+
+  size_t types_created = 0;
+  // Lookups of clang types in the per-unit cache of type ids.
+  size_t type_id_cache_hits = 0;
+  size_t type_id_cache_misses = 0;
+  size_t analysis_cache_hits = 0;
+  size_t analysis_cache_misses = 0;
+  // Headers whose types were taken from a HeaderFragmentCache, and those
+  // extracted afresh.
+  size_t header_fragment_hits = 0;
+  size_t header_fragment_misses = 0;
+  size_t bytes_emitted = 0;
+  // Of the whole process, as of the end of the last analysis.
+  uint64_t peak_resident_bytes = 0;
+
+  std::vector<UnitMetrics> units;
+
+  // Folds in the metrics of a worker, or of a finished unit.
+  void Add(const AnalysisMetrics& other);
+  void Add(const UnitMetrics& unit);
+};
+
+// Writes `metrics` as a JSON object, with times in milliseconds.
+void WriteMetricsJson(const AnalysisMetrics& metrics, llvm::raw_ostream& os);
+
+// Adds the wall time of its scope to `total`, and records the scope as an
+// event named `name` when a time trace is being recorded on this thread.
+class PhaseTimer {
+ public:
+  PhaseTimer(double& total, llvm::StringRef name, llvm::StringRef detail = {})
+      : total_(total),
+        trace_(name, detail),
+        start_(std::chrono::steady_clock::now()) {}
+  ~PhaseTimer() {
+    total_ += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            start_)
+                  .count();
+  }
+
+  PhaseTimer(const PhaseTimer&) = delete;
+  PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+ private:
+  double& total_;
+  llvm::TimeTraceScope trace_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Records a Chrome trace-event profile for as long as it lives, and stores it
+// in `output` when destroyed. Clang's own -ftime-trace events (preprocessing
+// of each header, parsing of each class, ...) are recorded along with the
+// PhaseTimer scopes, as are those of threads that called
+// llvm::timeTraceProfilerFinishThread meanwhile. Does nothing without a
+// granularity, or when the calling thread is already recording. The
+// profiler's state is process-wide, so only one recording should run at a
+// time.
+class TimeTraceRecording {
+ public:
+  // Events shorter than `granularity_us` microseconds are dropped.
+  TimeTraceRecording(std::optional<unsigned> granularity_us,
+                     std::string& output);
+  ~TimeTraceRecording();
+
+  TimeTraceRecording(const TimeTraceRecording&) = delete;
+  TimeTraceRecording& operator=(const TimeTraceRecording&) = delete;
+
+  [[nodiscard]] bool active() const { return output_ != nullptr; }
+
+ private:
+  std::string* output_ = nullptr;
+};
+
+}  // namespace typesynth
+
+#endif  //ANALYSIS_METRICS_H
@@ -0,0 +1,337 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "deduplication.h"
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "hashing.h"
+#include "structural_hash.h"
+
+namespace typesynth {
+
+namespace {
+
+struct NamedDefinitions {
+  std::vector<TypeId> complete;
+  std::vector<TypeId> incomplete;
+};
+
+using NamedDeclarations =
+    std::map<std::pair<models::NodeKind, std::string_view>, NamedDefinitions>;
+
+// Returns the declaration's qualified name and whether it is a complete
+// definition, or nothing for nodes that aren't named declarations.
+std::optional<std::pair<std::string_view, bool>> NamedDeclaration(
+    const TypeRegistry& registry, TypeId type_id) {
+  return registry.Visit(
+      type_id,
+      [&registry]<typename T>(const T& n)
+          -> std::optional<std::pair<std::string_view, bool>> {
+        if constexpr (requires { n.qualified_name; }) {
+          if (n.qualified_name == kEmptyStringId)
+            return std::nullopt;
+          bool is_complete = true;
+          if constexpr (requires { n.is_complete; })
+            is_complete = n.is_complete;
+          return std::make_pair(registry.String(n.qualified_name),
+                                is_complete);
+        } else {
+          return std::nullopt;
+        }
+      });
+}
+
+// Whether any two of `definitions` exist on a common target. Definitions for
+// disjoint targets of a multi-target registry are variants rather than
+// conflicts.
+bool ShareTarget(const TypeRegistry& registry,
+                 const std::vector<TypeId>& definitions) {
+  if (registry.targets().empty())
+    return true;
+  uint64_t seen = 0;
+  for (TypeId type_id : definitions) {
+    const uint64_t mask = registry.TargetMask(type_id);
+    if (seen & mask)
+      return true;
+    seen |= mask;
+  }
+  return false;
+}
+
+// Decides whether two nodes describe the same type, comparing everything the
+// structural hash covers and following references all the way down. Cycles
+// are compared coinductively: a pair under comparison is assumed equal until
+// shown otherwise. Nodes are kept in equivalence classes, so nodes found or
+// declared equal are compared in constant time afterwards.
+class StructuralEquality {
+ public:
+  explicit StructuralEquality(const TypeRegistry& registry)
+      : registry_(registry), parent_(registry.id_bound()) {
+    std::iota(parent_.begin(), parent_.end(), TypeId{0});
+  }
+
+  // The representative of `type_id`'s class.
+  TypeId Find(TypeId type_id) {
+    if (type_id >= parent_.size())
+      return type_id;
+    while (parent_[type_id] != type_id) {
+      parent_[type_id] = parent_[parent_[type_id]];
+      type_id = parent_[type_id];
+    }
+    return type_id;
+  }
+
+  // Puts `from`'s class into `into`'s, whose representative is kept.
+  void Union(TypeId from, TypeId into) {
+    from = Find(from);
+    into = Find(into);
+    if (from != into)
+      parent_[from] = into;
+  }
+
+  // Whether `a` and `b` are equal; if so, they and every pair of nodes found
+  // equal along the way join `a`'s class.
+  bool Equal(TypeId a, TypeId b) {
+    assumed_.clear();
+    const bool equal = Compare(a, b);
+    if (equal) {
+      for (uint64_t pair : assumed_)
+        Union(static_cast<TypeId>(pair), static_cast<TypeId>(pair >> 32));
+    }
+    assumed_.clear();
+    return equal;
+  }
+
+ private:
+  bool Compare(TypeId a, TypeId b) {
+    a = Find(a);
+    b = Find(b);
+    if (a == b)
+      return true;
+    if (!registry_.Contains(a) || !registry_.Contains(b) ||
+        registry_.kind(a) != registry_.kind(b)) {
+      return false;
+    }
+    if (!assumed_.insert((static_cast<uint64_t>(a) << 32) | b).second)
+      return true;
+
+    if (!registry_.targets().empty() &&
+        (registry_.TargetMask(a) != registry_.TargetMask(b) ||
+         !std::ranges::equal(registry_.TargetLayouts(a),
+                             registry_.TargetLayouts(b)))) {
+      return false;
+    }
+
+    return registry_.Visit(a, [&]<typename T>(const T& x) {
+      return Same(x, *registry_.Get<T>(b));
+    });
+  }
+
+  template <typename T>
+  bool Same(const T& x, const T& y) {
+    if constexpr (std::is_same_v<T, models::Primitive>) {
+      return x.primitive == y.primitive && x.size_bits == y.size_bits &&
+             x.is_signed == y.is_signed;
+    } else if constexpr (std::is_same_v<T, models::Pointer> ||
+                         std::is_same_v<T, models::Reference> ||
+                         std::is_same_v<T, models::SymbolicReference>) {
+      return Compare(x.inner, y.inner);
+    } else if constexpr (std::is_same_v<T, models::Function>) {
+      return x.is_variadic == y.is_variadic &&
+             Compare(x.ret_type, y.ret_type) &&
+             std::ranges::equal(registry_.List(x.args), registry_.List(y.args),
+                                [this](const auto& l, const auto& r) {
+                                  return l.name == r.name &&
+                                         Compare(l.type, r.type);
+                                });
+    } else if constexpr (std::is_same_v<T, models::StructDecl> ||
+                         std::is_same_v<T, models::UnionDecl>) {
+      return x.name == y.name && x.qualified_name == y.qualified_name &&
+             x.size_bytes == y.size_bytes && x.is_packed == y.is_packed &&
+             x.is_anonymous == y.is_anonymous &&
+             x.is_complete == y.is_complete &&
+             std::ranges::equal(registry_.List(x.fields),
+                                registry_.List(y.fields),
+                                [this](const auto& l, const auto& r) {
+                                  return l.name == r.name &&
+                                         l.offset_bits == r.offset_bits &&
+                                         l.bit_width == r.bit_width &&
+                                         Compare(l.type, r.type);
+                                });
+    } else if constexpr (std::is_same_v<T, models::EnumDecl>) {
+      return x.name == y.name && x.qualified_name == y.qualified_name &&
+             x.size_bytes == y.size_bytes &&
+             x.is_anonymous == y.is_anonymous &&
+             std::ranges::equal(registry_.List(x.constants),
+                                registry_.List(y.constants),
+                                [](const auto& l, const auto& r) {
+                                  return l.name == r.name &&
+                                         l.value == r.value;
+                                }) &&
+             Compare(x.underlying, y.underlying);
+    } else if constexpr (std::is_same_v<T, models::TypedefDecl>) {
+      return x.name == y.name && x.qualified_name == y.qualified_name &&
+             Compare(x.underlying, y.underlying);
+    } else if constexpr (std::is_same_v<T, models::FunctionDecl>) {
+      return x.name == y.name && x.qualified_name == y.qualified_name &&
+             std::ranges::equal(registry_.List(x.param_names),
+                                registry_.List(y.param_names)) &&
+             Compare(x.type, y.type);
+    }
+  }
+
+  const TypeRegistry& registry_;
+  std::vector<TypeId> parent_;
+  // Pairs assumed equal during the current comparison, as (a << 32) | b.
+  std::unordered_set<uint64_t> assumed_;
+};
+
+// Splits the complete definitions of each name into classes of equal ones,
+// keyed like `named`, and returns each class's first definition. A name's
+// forward declarations fold into its definition unless it is in `ambiguous`.
+std::map<NamedDeclarations::key_type, std::vector<TypeId>> ClassifyDefinitions(
+    const NamedDeclarations& named,
+    const std::set<NamedDeclarations::key_type>& ambiguous,
+    StructuralEquality& equality) {
+  for (const auto& [key, definitions] : named) {
+    if (!definitions.complete.empty() && !ambiguous.contains(key)) {
+      for (TypeId forward : definitions.incomplete)
+        equality.Union(forward, definitions.complete.front());
+    }
+  }
+
+  std::map<NamedDeclarations::key_type, std::vector<TypeId>> classes;
+  for (const auto& [key, definitions] : named) {
+    std::vector<TypeId>& representatives = classes[key];
+    for (TypeId type_id : definitions.complete) {
+      if (std::ranges::none_of(representatives, [&](TypeId representative) {
+            return equality.Equal(representative, type_id);
+          })) {
+        representatives.push_back(type_id);
+      }
+    }
+  }
+  return classes;
+}
+
+}  // namespace
+
+std::vector<TypeConflict> DeduplicateTypes(TypeRegistry& registry) {
+  // Keyed by kind and qualified name; ordered so conflicts are reported
+  // deterministically.
+  NamedDeclarations named;
+  for (TypeId type_id : registry) {
+    if (auto declaration = NamedDeclaration(registry, type_id)) {
+      auto& definitions = named[{registry.kind(type_id), declaration->first}];
+      if (declaration->second) {
+        definitions.complete.push_back(type_id);
+      } else {
+        definitions.incomplete.push_back(type_id);
+      }
+    }
+  }
+
+  // A forward declaration can only stand for its name's definition when
+  // there is just one. Which names have several isn't known before their
+  // definitions are compared, and comparing them depends on how forward
+  // declarations they refer to resolve, so names found ambiguous are set
+  // aside and the definitions compared again until no more turn up.
+  std::set<NamedDeclarations::key_type> ambiguous;
+  std::optional<StructuralEquality> equality;
+  std::map<NamedDeclarations::key_type, std::vector<TypeId>> classes;
+  for (bool settled = false; !settled;) {
+    equality.emplace(registry);
+    classes = ClassifyDefinitions(named, ambiguous, *equality);
+    settled = true;
+    for (const auto& [key, representatives] : classes) {
+      if (representatives.size() > 1 && ambiguous.insert(key).second)
+        settled = false;
+    }
+  }
+
+  // References to one of several same-name definitions are hashed by which
+  // one they refer to, so they aren't all taken for the same type.
+  StructuralHasher hasher(registry);
+  for (const auto& [key, representatives] : classes) {
+    if (representatives.size() < 2)
+      continue;
+    for (TypeId type_id : named.at(key).complete) {
+      const auto index = std::ranges::find_if(
+          representatives, [&](TypeId representative) {
+            return equality->Find(representative) == equality->Find(type_id);
+          }) - representatives.begin();
+      hasher.SetIdentity(type_id,
+                         HashBuilder()
+                             .Add(static_cast<uint64_t>(key.first))
+                             .Add(key.second)
+                             .Add(static_cast<uint64_t>(index))
+                             .value());
+    }
+  }
+
+  // Fold everything else. Equal hashes only nominate candidates; nodes are
+  // only merged once they compare equal.
+  std::unordered_map<uint64_t, std::vector<TypeId>> candidates;
+  for (TypeId type_id : registry) {
+    if (equality->Find(type_id) != type_id)
+      continue;
+    std::vector<TypeId>& bucket = candidates[hasher.HashOf(type_id)];
+    if (std::ranges::none_of(bucket, [&](TypeId candidate) {
+          return equality->Equal(candidate, type_id);
+        })) {
+      bucket.push_back(type_id);
+    }
+  }
+
+  std::vector<TypeConflict> conflicts;
+  for (const auto& [key, representatives] : classes) {
+    if (representatives.size() > 1 && ShareTarget(registry, representatives)) {
+      TypeConflict& conflict = conflicts.emplace_back(
+          TypeConflict{.qualified_name = std::string(key.second)});
+      for (TypeId representative : representatives)
+        conflict.definitions.push_back(equality->Find(representative));
+    }
+  }
+
+  std::unordered_map<TypeId, TypeId> replacements;
+  for (TypeId type_id : registry) {
+    if (TypeId representative = equality->Find(type_id);
+        representative != type_id) {
+      replacements.emplace(type_id, representative);
+    }
+  }
+
+  registry.ReplaceTypes(replacements);
+  return conflicts;
+}
+
+}  // namespace typesynth
@@ -0,0 +1,53 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef DEDUPLICATION_H
+#define DEDUPLICATION_H
+
+#include <string>
+#include <vector>
+
+#include "type_registry.h"
+
+namespace typesynth {
+
+// Two or more definitions that share a qualified name but disagree on their
+// contents, e.g. a record laid out differently under different macros.
+struct TypeConflict {
+  std::string qualified_name;
+  std::vector<TypeId> definitions;
+};
+
+// Folds structurally identical nodes of `registry` into a single node and
+// redirects every reference to the survivor. Nodes are only folded once they
+// compare equal, not merely hash equally. Forward declarations fold into the
+// one complete definition of the same name when there is exactly one.
+// Same-name definitions that differ are all kept, along with the references
+// to each, and returned as conflicts, unless they exist on disjoint targets of
+// a multi-target registry.
+std::vector<TypeConflict> DeduplicateTypes(TypeRegistry& registry);
+
+}  // namespace typesynth
+
+#endif  //DEDUPLICATION_H
@@ -0,0 +1,87 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "dependency_manifest.h"
+
+#include <optional>
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "hashing.h"
+
+namespace typesynth {
+
+namespace {
+
+std::optional<uint64_t> HashFile(llvm::vfs::FileSystem& file_system,
+                                 const std::string& path) {
+  auto buffer = file_system.getBufferForFile(path);
+  if (!buffer)
+    return std::nullopt;
+  return HashBuilder().Add((*buffer)->getBuffer()).value();
+}
+
+}  // namespace
+
+absl::Status WriteDependencyManifest(const std::string& manifest_path,
+                                     llvm::ArrayRef<std::string> dependencies,
+                                     llvm::vfs::FileSystem& file_system) {
+  // One "<content hash> <path>" line per file.
+  auto error = llvm::writeToOutput(manifest_path, [&](llvm::raw_ostream& os) {
+    for (const std::string& path : dependencies) {
+      if (std::optional<uint64_t> hash = HashFile(file_system, path))
+        os << llvm::utohexstr(*hash) << ' ' << path << '\n';
+    }
+    return llvm::Error::success();
+  });
+  if (error) {
+    return absl::InternalError(llvm::toString(std::move(error)));
+  }
+  return absl::OkStatus();
+}
+
+bool IsDependencyManifestCurrent(const std::string& manifest_path,
+                                 llvm::vfs::FileSystem& file_system) {
+  auto manifest = llvm::MemoryBuffer::getFile(manifest_path);
+  if (!manifest)
+    return false;
+
+  llvm::StringRef lines = (*manifest)->getBuffer();
+  while (!lines.empty()) {
+    auto [line, rest] = lines.split('\n');
+    lines = rest;
+    auto [hash_text, path] = line.split(' ');
+    uint64_t expected = 0;
+    if (hash_text.getAsInteger(16, expected))
+      return false;
+
+    if (HashFile(file_system, path.str()) != expected)
+      return false;
+  }
+  return true;
+}
+
+}  // namespace typesynth
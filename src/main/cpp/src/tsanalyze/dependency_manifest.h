@@ -0,0 +1,58 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef DEPENDENCY_MANIFEST_H
+#define DEPENDENCY_MANIFEST_H
+
+#include <string>
+
+#include <clang/Frontend/Utils.h>
+#include <llvm/Support/VirtualFileSystem.h>
+
+#include "absl/status/status.h"
+
+namespace typesynth {
+
+// Collects every file a compilation reads, system headers and the inputs of
+// loaded PCHs included, since any of them can change the extracted types.
+class SourceDependencyCollector : public clang::DependencyCollector {
+ public:
+  bool needSystemDependencies() override { return true; }
+  bool needInputFileDeps() override { return true; }
+};
+
+// Writes `dependencies` to `manifest_path` along with the content hash of each
+// one, replacing the file atomically.
+absl::Status WriteDependencyManifest(const std::string& manifest_path,
+                                     llvm::ArrayRef<std::string> dependencies,
+                                     llvm::vfs::FileSystem& file_system);
+
+// Returns whether the manifest at `manifest_path` exists and every file it
+// lists still has the recorded contents.
+bool IsDependencyManifestCurrent(const std::string& manifest_path,
+                                 llvm::vfs::FileSystem& file_system);
+
+}  // namespace typesynth
+
+#endif  //DEPENDENCY_MANIFEST_H
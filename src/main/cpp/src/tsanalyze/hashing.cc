@@ -0,0 +1,58 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "hashing.h"
+
+namespace typesynth {
+
+namespace {
+
+uint64_t Mix(uint64_t value) {
+  // splitmix64 finalizer.
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebULL;
+  value ^= value >> 31;
+  return value;
+}
+
+}  // namespace
+
+HashBuilder& HashBuilder::Add(uint64_t value) {
+  state_ = Mix(state_ ^ Mix(value + 0x9e3779b97f4a7c15ULL));
+  return *this;
+}
+
+HashBuilder& HashBuilder::Add(std::string_view value) {
+  // FNV-1a over the bytes, then folded in like any other value.
+  uint64_t fnv = 0xcbf29ce484222325ULL;
+  for (unsigned char c : value) {
+    fnv ^= c;
+    fnv *= 0x100000001b3ULL;
+  }
+  return Add(value.size()).Add(fnv);
+}
+
+}  // namespace typesynth
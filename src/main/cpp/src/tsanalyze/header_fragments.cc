@@ -0,0 +1,133 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "header_fragments.h"
+
+#include <utility>
+
+#include <clang/Basic/SourceManager.h>
+#include <clang/Lex/MacroInfo.h>
+#include <clang/Lex/Token.h>
+
+namespace typesynth {
+
+namespace {
+
+// Tags that keep definitions and removals apart in the macro history.
+constexpr uint64_t kMacroDefined = 1;
+constexpr uint64_t kMacroUndefined = 2;
+
+}  // namespace
+
+HeaderFragmentCache::HeaderFragmentCache(size_t max_types)
+    : max_types_(max_types) {}
+
+std::shared_ptr<const TypeRegistry> HeaderFragmentCache::Find(
+    uint64_t key) const {
+  std::lock_guard lock(mutex_);
+  auto it = fragments_.find(key);
+  return it == fragments_.end() ? nullptr : it->second;
+}
+
+void HeaderFragmentCache::Insert(uint64_t key, TypeRegistry fragment) {
+  const size_t types = fragment.size();
+  auto shared = std::make_shared<const TypeRegistry>(std::move(fragment));
+  std::lock_guard lock(mutex_);
+  if (types > max_types_ - types_)
+    return;
+  if (fragments_.try_emplace(key, std::move(shared)).second)
+    types_ += types;
+}
+
+void HeaderFragmentCache::Clear() {
+  std::lock_guard lock(mutex_);
+  fragments_.clear();
+  types_ = 0;
+}
+
+HeaderKeyTracker::HeaderKeyTracker(const clang::SourceManager& source_manager,
+                                   uint64_t options_hash)
+    : source_manager_(source_manager), options_hash_(options_hash) {}
+
+void HeaderKeyTracker::FileChanged(clang::SourceLocation loc,
+                                   FileChangeReason reason,
+                                   clang::SrcMgr::CharacteristicKind file_type,
+                                   clang::FileID prev_file) {
+  if (reason == EnterFile) {
+    const clang::FileID file = source_manager_.getFileID(loc);
+    clang::OptionalFileEntryRef entry =
+        source_manager_.getFileEntryRefForID(file);
+    std::optional<llvm::MemoryBufferRef> buffer =
+        source_manager_.getBufferOrNone(file);
+    // The main file and the predefines buffer are not headers.
+    if (file == source_manager_.getMainFileID() || !entry || !buffer)
+      return;
+
+    HashBuilder key;
+    key.Add(options_hash_)
+        .Add(macro_history_.value())
+        .Add(entry->getName())
+        .Add(buffer->getBuffer());
+    headers_[file] = {.key = key.value()};
+  } else if (reason == ExitFile) {
+    if (auto it = headers_.find(prev_file); it != headers_.end())
+      it->second.complete = true;
+  }
+}
+
+void HeaderKeyTracker::MacroDefined(const clang::Token& name,
+                                    const clang::MacroDirective* directive) {
+  macro_history_.Add(kMacroDefined);
+  const clang::MacroInfo* info = directive->getMacroInfo();
+  if (info->getDefinitionLoc().isValid()) {
+    // Spans the name, the parameters and the replacement list.
+    macro_history_.Add(
+        std::string_view(source_manager_.getCharacterData(
+                             info->getDefinitionLoc()),
+                         info->getDefinitionLength(source_manager_)));
+  } else {
+    macro_history_.Add(name.getIdentifierInfo()->getName());
+  }
+}
+
+void HeaderKeyTracker::MacroUndefined(
+    const clang::Token& name, const clang::MacroDefinition& definition,
+    const clang::MacroDirective* undef) {
+  macro_history_.Add(kMacroUndefined)
+      .Add(name.getIdentifierInfo()->getName());
+}
+
+std::optional<uint64_t> HeaderKeyTracker::KeyFor(clang::FileID file) const {
+  auto it = headers_.find(file);
+  if (it == headers_.end())
+    return std::nullopt;
+  return it->second.key;
+}
+
+bool HeaderKeyTracker::IsComplete(clang::FileID file) const {
+  auto it = headers_.find(file);
+  return it != headers_.end() && it->second.complete;
+}
+
+}  // namespace typesynth
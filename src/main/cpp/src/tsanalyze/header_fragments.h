@@ -0,0 +1,123 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef HEADER_FRAGMENTS_H
+#define HEADER_FRAGMENTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include <clang/Basic/SourceLocation.h>
+#include <clang/Lex/PPCallbacks.h>
+#include <llvm/ADT/DenseMap.h>
+
+#include "absl/container/flat_hash_map.h"
+#include "hashing.h"
+#include "type_registry.h"
+
+namespace clang {
+class SourceManager;
+}  // namespace clang
+
+namespace typesynth {
+
+// The types extracted from the top-level declarations of a header, along
+// with everything they refer to, keyed by HeaderKeyTracker. Translation units
+// that include a header under a key already stored take its fragment instead
+// of extracting the header's declarations again, so extraction scales with
+// the distinct headers of a project rather than with how often each one is
+// included. Since the keys assume files don't change, fragments are only
+// kept for one analysis, and up to `max_types` types in all. Safe to share
+// between threads.
+class HeaderFragmentCache {
+ public:
+  explicit HeaderFragmentCache(size_t max_types = size_t{1} << 21);
+
+  [[nodiscard]] std::shared_ptr<const TypeRegistry> Find(uint64_t key) const;
+
+  // Stores `fragment` under `key` unless a fragment is stored there already,
+  // or it would take the cache past its size. The headers met first, which
+  // are the ones most widely shared, are thus the ones kept.
+  void Insert(uint64_t key, TypeRegistry fragment);
+
+  // Drops every fragment, as files may change between analyses.
+  void Clear();
+
+ private:
+  const size_t max_types_;
+  mutable std::mutex mutex_;
+  size_t types_ = 0;
+  absl::flat_hash_map<uint64_t, std::shared_ptr<const TypeRegistry>>
+      fragments_;
+};
+
+// Keys every header a translation unit includes, as soon as it is entered, by
+// what decides the declarations it yields: its path and contents, the
+// compiler options, and every macro definition and removal up to where it was
+// included, in order. What the header's own includes resolve to follows from
+// those while the files don't change, which is assumed for the length of an
+// analysis. Declarations made before the #include and `#pragma pack` state
+// are not part of the key; headers rarely depend on either.
+class HeaderKeyTracker : public clang::PPCallbacks {
+ public:
+  // `options_hash` stands for the compiler options, as computed by
+  // HashPreprocessorOptions.
+  HeaderKeyTracker(const clang::SourceManager& source_manager,
+                   uint64_t options_hash);
+
+  void FileChanged(clang::SourceLocation loc, FileChangeReason reason,
+                   clang::SrcMgr::CharacteristicKind file_type,
+                   clang::FileID prev_file) override;
+  void MacroDefined(const clang::Token& name,
+                    const clang::MacroDirective* directive) override;
+  void MacroUndefined(const clang::Token& name,
+                      const clang::MacroDefinition& definition,
+                      const clang::MacroDirective* undef) override;
+
+  // The key of the header `file` was entered for, or nothing for the main
+  // file and the predefines.
+  [[nodiscard]] std::optional<uint64_t> KeyFor(clang::FileID file) const;
+
+  // Whether the preprocessor got to the end of the header `file` was entered
+  // for, rather than stopping inside it on a fatal error.
+  [[nodiscard]] bool IsComplete(clang::FileID file) const;
+
+ private:
+  struct Header {
+    uint64_t key;
+    bool complete = false;
+  };
+
+  const clang::SourceManager& source_manager_;
+  const uint64_t options_hash_;
+  HashBuilder macro_history_;
+  llvm::DenseMap<clang::FileID, Header> headers_;
+};
+
+}  // namespace typesynth
+
+#endif  //HEADER_FRAGMENTS_H
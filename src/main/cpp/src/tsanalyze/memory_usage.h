@@ -0,0 +1,48 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <cstdint>
+
+namespace typesynth {
+
+// Resident set size of the process right now, in bytes, or 0 where it cannot
+// be measured.
+uint64_t CurrentResidentBytes();
+
+// Peak resident set size of the process so far, in bytes.
+uint64_t PeakResidentBytes();
+
+// Physical memory of the machine in bytes, or 0 if unknown.
+uint64_t PhysicalMemoryBytes();
+
+// Hands memory the allocator holds on to, but no longer uses, back to the
+// system where that is supported, so that it stops counting as resident.
+void ReleaseFreeMemory();
+
+}  // namespace typesynth
+
+#endif  //MEMORY_USAGE_H
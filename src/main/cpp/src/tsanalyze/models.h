@@ -25,12 +25,18 @@
 #ifndef MODELS_H
 #define MODELS_H
 
-#include <map>
+#include <cstdint>
 #include <string>
 #include <vector>
 
 namespace typesynth {
 using TypeId = uint32_t;
+// Never assigned to a node; stands in for "no type".
+inline constexpr TypeId kInvalidTypeId = 0;
+// Index of a string in a StringPool.
+using StringId = uint32_t;
+// Always present in a pool, and stands for the empty string.
+inline constexpr StringId kEmptyStringId = 0;
 namespace models {
 
 struct SourceLocation {
@@ -40,9 +46,10 @@ struct SourceLocation {
   std::string snippet;
 };
 
-enum class NodeKind {
+enum class NodeKind : uint8_t {
   kStructDeclaration,
   kUnionDeclaration,
+  kEnumDeclaration,
   kTypedefDeclaration,
   kFunctionDeclaration,
   kPointer,
@@ -52,60 +59,145 @@ enum class NodeKind {
   kFunction,
 };
 
-struct TypeNode {
-  TypeId id;
-  NodeKind kind;
+// The node records below are plain values stored by TypeRegistry in one array
+// per kind. Strings are ids in the registry's string pool, and variable-length
+// members are ranges of arrays the registry shares between all nodes; use
+// TypeRegistry::String and TypeRegistry::List to read them.
+
+// A range of `size` elements of one of the registry's shared arrays.
+template <typename T>
+struct ListRef {
+  uint32_t offset = 0;
+  uint32_t size = 0;
 };
 
-struct Pointer : TypeNode {
+struct Pointer {
   TypeId inner;
 };
 
-struct Reference : TypeNode {
+struct Reference {
   TypeId inner;
 };
 
-struct SymbolicReference : TypeNode {
+struct SymbolicReference {
   TypeId inner;
 };
 
 struct FunctionArgument {
-  std::string name;
+  StringId name;
   TypeId type;
 };
 
-struct Function : TypeNode {
+struct Function {
   TypeId ret_type;
-  std::vector<FunctionArgument> args;
+  ListRef<FunctionArgument> args;
   bool is_variadic;
 };
 
-struct Primitive : TypeNode {
-  std::string primitive;
+struct Primitive {
+  StringId primitive;
+  uint32_t size_bits;
+  bool is_signed;
 };
 
 struct RecordField {
-  std::string name;
+  StringId name;
   TypeId type;
   uint32_t offset_bits;
+  // Zero unless the field is a bit-field.
+  uint32_t bit_width;
 };
 
-struct StructDecl : TypeNode {
-  std::string name;
-  std::string qualified_name;
-  std::vector<RecordField> fields;
+struct StructDecl {
+  StringId name;
+  StringId qualified_name;
+  ListRef<RecordField> fields;
+  uint32_t size_bytes;
   bool is_packed;
   bool is_anonymous;
+  // False for records that were only forward-declared in the translation unit.
+  bool is_complete;
 };
 
-struct UnionDecl : TypeNode {
-  std::string name;
-  std::string qualified_name;
-  std::vector<RecordField> fields;
+struct UnionDecl {
+  StringId name;
+  StringId qualified_name;
+  ListRef<RecordField> fields;
+  uint32_t size_bytes;
   bool is_packed;
   bool is_anonymous;
+  bool is_complete;
+};
+
+struct EnumConstant {
+  StringId name;
+  int64_t value;
+};
+
+struct EnumDecl {
+  StringId name;
+  StringId qualified_name;
+  TypeId underlying;
+  ListRef<EnumConstant> constants;
+  uint32_t size_bytes;
+  bool is_anonymous;
+};
+
+struct TypedefDecl {
+  StringId name;
+  StringId qualified_name;
+  TypeId underlying;
+};
+
+struct FunctionDecl {
+  StringId name;
+  StringId qualified_name;
+  // The `Function` node describing this declaration's prototype.
+  TypeId type;
+  ListRef<StringId> param_names;
 };
 
+// Layout of a record, enum or primitive on one target of a multi-target
+// registry, where it differs from the layout its node carries. Kept apart from
+// the nodes, since few types are laid out differently.
+struct TargetLayout {
+  // Index into TypeRegistry::targets().
+  uint32_t target;
+  // In bytes for records and enums, in bits for primitives.
+  uint32_t size;
+  // Primitives only.
+  bool is_signed;
+  // Records only: the offset of each field, in order.
+  std::vector<uint32_t> field_offsets_bits;
+
+  bool operator==(const TargetLayout&) const = default;
+};
+
+// Maps each node record to its kind. Structs and unions, which share a
+// shape, are told apart by their record type.
+template <typename T>
+struct KindOf;
+
+#define TYPESYNTH_NODE_KIND(Type, Kind)               \
+  template <>                                         \
+  struct KindOf<Type> {                               \
+    static constexpr NodeKind value = NodeKind::Kind; \
+  };
+TYPESYNTH_NODE_KIND(StructDecl, kStructDeclaration)
+TYPESYNTH_NODE_KIND(UnionDecl, kUnionDeclaration)
+TYPESYNTH_NODE_KIND(EnumDecl, kEnumDeclaration)
+TYPESYNTH_NODE_KIND(TypedefDecl, kTypedefDeclaration)
+TYPESYNTH_NODE_KIND(FunctionDecl, kFunctionDeclaration)
+TYPESYNTH_NODE_KIND(Pointer, kPointer)
+TYPESYNTH_NODE_KIND(Reference, kReference)
+TYPESYNTH_NODE_KIND(Primitive, kPrimitive)
+TYPESYNTH_NODE_KIND(SymbolicReference, kSymbolicReference)
+TYPESYNTH_NODE_KIND(Function, kFunction)
+#undef TYPESYNTH_NODE_KIND
+
+template <typename T>
+inline constexpr NodeKind kKindOf = KindOf<T>::value;
+
 }  // namespace models
 }  // namespace typesynth
 
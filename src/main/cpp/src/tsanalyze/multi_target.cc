@@ -0,0 +1,140 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "multi_target.h"
+
+#include <algorithm>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+
+#include "structural_hash.h"
+
+namespace typesynth {
+
+namespace {
+
+// The layout the node stored under `type_id` carries for `target`, for the
+// kinds whose layout depends on the target.
+std::optional<models::TargetLayout> InlineLayout(const TypeRegistry& registry,
+                                                 TypeId type_id,
+                                                 uint32_t target) {
+  return registry.Visit(
+      type_id,
+      [&]<typename T>(const T& n) -> std::optional<models::TargetLayout> {
+        if constexpr (std::is_same_v<T, models::Primitive>) {
+          return models::TargetLayout{.target = target,
+                                      .size = n.size_bits,
+                                      .is_signed = n.is_signed};
+        } else if constexpr (std::is_same_v<T, models::StructDecl> ||
+                             std::is_same_v<T, models::UnionDecl>) {
+          models::TargetLayout layout{
+              .target = target, .size = n.size_bytes, .is_signed = false};
+          for (const auto& field : registry.List(n.fields))
+            layout.field_offsets_bits.push_back(field.offset_bits);
+          return layout;
+        } else if constexpr (std::is_same_v<T, models::EnumDecl>) {
+          return models::TargetLayout{
+              .target = target, .size = n.size_bytes, .is_signed = false};
+        } else {
+          return std::nullopt;
+        }
+      });
+}
+
+// One type of the combined registry, and the targets it was matched on.
+struct TargetEntity {
+  TypeId representative;
+  uint64_t mask;
+};
+
+}  // namespace
+
+TypeRegistry CombineTargets(std::span<const TypeRegistry> registries,
+                            std::vector<std::string> targets) {
+  TypeRegistry combined;
+
+  // Merging hands out increasing ids, so the nodes of each target occupy a
+  // range of ids past those of the previous target.
+  std::vector<TypeId> range_ends;
+  range_ends.reserve(registries.size());
+  for (const TypeRegistry& registry : registries) {
+    combined.Merge(registry);
+    range_ends.push_back(combined.id_bound());
+  }
+
+  // Matches every node against the entities of the same shape, in id order so
+  // the first target's node represents each entity. A node joins the first
+  // entity not yet matched on its target, which pairs up the several nodes a
+  // target may have for one shape, e.g. with differing layouts, in the order
+  // they were extracted.
+  StructuralHasher shapes(combined, {.include_layout = false});
+  std::unordered_map<uint64_t, std::vector<TargetEntity>> entities;
+  std::unordered_map<TypeId, TypeId> replacements;
+  std::unordered_map<TypeId, std::vector<models::TargetLayout>> layouts;
+  uint32_t target = 0;
+  for (TypeId type_id : combined) {
+    while (type_id >= range_ends[target])
+      ++target;
+    const uint64_t bit = uint64_t{1} << target;
+
+    auto& candidates = entities[shapes.HashOf(type_id)];
+    auto it = std::find_if(
+        candidates.begin(), candidates.end(),
+        [bit](const TargetEntity& entity) { return !(entity.mask & bit); });
+    if (it == candidates.end()) {
+      candidates.push_back(TargetEntity{.representative = type_id,
+                                        .mask = bit});
+      continue;
+    }
+
+    it->mask |= bit;
+    replacements.emplace(type_id, it->representative);
+    auto layout = InlineLayout(combined, type_id, target);
+    if (layout &&
+        InlineLayout(combined, it->representative, target) != layout) {
+      layouts[it->representative].push_back(*std::move(layout));
+    }
+  }
+
+  combined.ReplaceTypes(replacements);
+
+  const uint64_t all = targets.size() >= 64
+                           ? ~uint64_t{0}
+                           : (uint64_t{1} << targets.size()) - 1;
+  combined.SetTargets(std::move(targets));
+  for (const auto& [hash, candidates] : entities) {
+    for (const TargetEntity& entity : candidates) {
+      if (entity.mask != all)
+        combined.SetTargetMask(entity.representative, entity.mask);
+    }
+  }
+  for (auto& [type_id, type_layouts] : layouts) {
+    for (auto& layout : type_layouts)
+      combined.AddTargetLayout(type_id, std::move(layout));
+  }
+  return combined;
+}
+
+}  // namespace typesynth
@@ -0,0 +1,50 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MULTI_TARGET_H
+#define MULTI_TARGET_H
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include "type_registry.h"
+
+namespace typesynth {
+
+// Combines the registries of one analysis run once per target, in the order
+// of `targets`, into a single multi-target registry (see
+// TypeRegistry::targets). Nodes that describe the same type on several
+// targets, ignoring layout, are stored once: the node of the first target
+// keeps its inline layout, and layouts on later targets are recorded only
+// where they differ from it. Types missing on some targets record the targets
+// they exist on. There may be fewer registries than targets, in which case
+// the missing targets have no types.
+[[nodiscard]] TypeRegistry CombineTargets(
+    std::span<const TypeRegistry> registries,
+    std::vector<std::string> targets);
+
+}  // namespace typesynth
+
+#endif  //MULTI_TARGET_H
@@ -0,0 +1,257 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "pch_cache.h"
+
+#include <clang/Basic/FileManager.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendActions.h>
+#include <clang/Lex/HeaderSearchOptions.h>
+#include <clang/Lex/Lexer.h>
+#include <clang/Lex/PreprocessorOptions.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "dependency_manifest.h"
+#include "hashing.h"
+
+namespace typesynth {
+
+namespace {
+
+// Returns the `#include <...>` (or `#import <...>`) lines that open the
+// preamble of `source`. Scanning stops at the first directive of any other
+// kind, since a macro definition or local include could change what the
+// following headers expand to.
+std::string SharedIncludePrefix(llvm::StringRef source,
+                                const clang::LangOptions& lang_opts) {
+  clang::PreambleBounds bounds =
+      clang::Lexer::ComputePreamble(source, lang_opts);
+  llvm::StringRef preamble = source.take_front(bounds.Size);
+
+  std::string prefix;
+  bool in_block_comment = false;
+  while (!preamble.empty()) {
+    auto [line, rest] = preamble.split('\n');
+    preamble = rest;
+    line = line.trim();
+
+    if (in_block_comment) {
+      in_block_comment = !line.contains("*/");
+      continue;
+    }
+    if (line.empty() || line.starts_with("//"))
+      continue;
+    if (line.starts_with("/*")) {
+      in_block_comment = !line.contains("*/");
+      continue;
+    }
+
+    if (!line.consume_front("#"))
+      break;
+    line = line.ltrim();
+    llvm::StringRef directive;
+    if (line.consume_front("include")) {
+      directive = "#include ";
+    } else if (line.consume_front("import")) {
+      directive = "#import ";
+    } else {
+      break;
+    }
+
+    line = line.ltrim();
+    size_t close = line.find('>');
+    if (!line.starts_with("<") || close == llvm::StringRef::npos)
+      break;
+
+    absl::StrAppend(&prefix, directive.str(), line.take_front(close + 1).str(),
+                    "\n");
+  }
+  return prefix;
+}
+
+absl::Status BuildPch(
+    const clang::CompilerInvocation& invocation,
+    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> file_system,
+    const std::string& prefix, const std::string& base_path) {
+  const std::string header_path = base_path + ".h";
+  if (auto error = llvm::writeToOutput(header_path, [&](llvm::raw_ostream& os) {
+        os << prefix;
+        return llvm::Error::success();
+      })) {
+    return absl::InternalError(llvm::toString(std::move(error)));
+  }
+
+  // Same options as the translation unit so the PCH passes clang's
+  // compatibility checks when it is loaded, only with the prefix as input.
+  auto pch_invocation = std::make_shared<clang::CompilerInvocation>(invocation);
+  clang::FrontendOptions& frontend_opts = pch_invocation->getFrontendOpts();
+  clang::InputKind input_kind = frontend_opts.Inputs.front().getKind();
+  frontend_opts.Inputs = {
+      clang::FrontendInputFile(header_path, input_kind.getHeader())};
+  frontend_opts.OutputFile = base_path + ".pch";
+  frontend_opts.ProgramAction = clang::frontend::GeneratePCH;
+  pch_invocation->getPreprocessorOpts().ImplicitPCHInclude.clear();
+
+  clang::CompilerInstance compiler;
+  compiler.setInvocation(std::move(pch_invocation));
+  compiler.createDiagnostics(*file_system, new clang::IgnoringDiagConsumer());
+  compiler.createFileManager(file_system);
+
+  auto dependencies = std::make_shared<SourceDependencyCollector>();
+  compiler.addDependencyCollector(dependencies);
+
+  clang::GeneratePCHAction action;
+  if (!compiler.ExecuteAction(action)) {
+    return absl::InternalError(
+        absl::StrCat("Failed to precompile headers for: ", header_path));
+  }
+
+  // Written last, so a manifest only ever describes a complete PCH.
+  return WriteDependencyManifest(base_path + ".deps",
+                                 dependencies->getDependencies(), *file_system);
+}
+
+}  // namespace
+
+PchCache::PchCache(std::string cache_directory)
+    : cache_directory_(std::move(cache_directory)) {}
+
+uint64_t HashPreprocessorOptions(
+    const clang::CompilerInvocation& invocation) {
+  // The module hash covers the language options and target, but leaves out
+  // user header search paths. The same include names different headers under
+  // different include paths, so those and the macro definitions are hashed
+  // as well.
+  HashBuilder hash;
+  hash.Add(invocation.getModuleHash());
+  const clang::HeaderSearchOptions& header_search =
+      invocation.getHeaderSearchOpts();
+  hash.Add(header_search.Sysroot).Add(header_search.ResourceDir);
+  for (const auto& entry : header_search.UserEntries) {
+    hash.Add(entry.Path)
+        .Add(static_cast<uint64_t>(entry.Group))
+        .Add(entry.IsFramework)
+        .Add(entry.IgnoreSysRoot);
+  }
+  for (const auto& system_prefix : header_search.SystemHeaderPrefixes) {
+    hash.Add(system_prefix.Prefix).Add(system_prefix.IsSystemHeader);
+  }
+  const clang::PreprocessorOptions& preprocessor =
+      invocation.getPreprocessorOpts();
+  for (const auto& [macro, is_undef] : preprocessor.Macros) {
+    hash.Add(macro).Add(is_undef);
+  }
+  for (const std::string& include : preprocessor.Includes) {
+    hash.Add(include);
+  }
+  return hash.value();
+}
+
+absl::StatusOr<std::string> PchCache::GetOrBuild(
+    const clang::CompilerInvocation& invocation,
+    clang::FileManager& file_manager, const std::string& main_file) {
+  auto buffer = file_manager.getBufferForFile(main_file);
+  if (!buffer) {
+    return absl::NotFoundError(absl::StrCat("File not found: ", main_file));
+  }
+
+  const std::string prefix =
+      SharedIncludePrefix((*buffer)->getBuffer(), invocation.getLangOpts());
+  if (prefix.empty()) {
+    return absl::NotFoundError(
+        absl::StrCat("No shared include prefix in: ", main_file));
+  }
+
+  const uint64_t key = HashBuilder()
+                           .Add(HashPreprocessorOptions(invocation))
+                           .Add(prefix)
+                           .value();
+  const std::string base_path =
+      absl::StrCat(cache_directory_, "/", absl::Hex(key, absl::kZeroPad16));
+
+  std::shared_ptr<Entry> entry;
+  {
+    std::lock_guard lock(entries_mutex_);
+    auto& slot = entries_[key];
+    if (!slot)
+      slot = std::make_shared<Entry>();
+    entry = slot;
+  }
+
+  // Only the first translation unit with this key validates or builds the PCH;
+  // the others wait for it here.
+  std::lock_guard lock(entry->mutex);
+  if (!entry->ready) {
+    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> file_system =
+        file_manager.getVirtualFileSystemPtr();
+    if (llvm::sys::fs::exists(base_path + ".pch") &&
+        IsDependencyManifestCurrent(base_path + ".deps", *file_system)) {
+      entry->status = absl::OkStatus();
+    } else if (std::error_code error =
+                   llvm::sys::fs::create_directories(cache_directory_)) {
+      entry->status = absl::InternalError(error.message());
+    } else {
+      entry->status = BuildPch(invocation, file_system, prefix, base_path);
+    }
+    entry->ready = true;
+  }
+
+  if (!entry->status.ok())
+    return entry->status;
+  return base_path + ".pch";
+}
+
+void PchCache::Revalidate() {
+  std::lock_guard lock(entries_mutex_);
+  entries_.clear();
+}
+
+void PchCache::Invalidate(const std::string& pch_path) {
+  // Without its manifest the PCH no longer counts as current on disk either.
+  llvm::StringRef base_path = pch_path;
+  base_path.consume_back(".pch");
+  llvm::sys::fs::remove(base_path + ".deps");
+
+  uint64_t key = 0;
+  if (!absl::SimpleHexAtoi(llvm::sys::path::filename(base_path).str(), &key))
+    return;
+  std::shared_ptr<Entry> entry;
+  {
+    std::lock_guard lock(entries_mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end())
+      return;
+    entry = it->second;
+  }
+  std::lock_guard lock(entry->mutex);
+  entry->status = absl::FailedPreconditionError(
+      absl::StrCat("Precompiled header failed to load: ", pch_path));
+  entry->ready = true;
+}
+
+}  // namespace typesynth
@@ -0,0 +1,92 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PCH_CACHE_H
+#define PCH_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+namespace clang {
+class CompilerInvocation;
+class FileManager;
+}  // namespace clang
+
+namespace typesynth {
+
+// Hashes what decides how the preprocessor reads a header under
+// `invocation`: the language options and target, the header search paths,
+// and the macros and includes given on the command line.
+uint64_t HashPreprocessorOptions(const clang::CompilerInvocation& invocation);
+
+// Builds precompiled headers for the run of `#include <...>` directives that
+// opens a translation unit, and hands them out to every later translation unit
+// starting with the same includes under compatible flags. PCHs are written to
+// `cache_directory` along with a manifest of the content hashes of every
+// header they cover, so they survive across runs until a header changes.
+// Whether a PCH is current is only checked once until Revalidate is called,
+// which long-lived analyzers do before every analysis.
+// Safe to share between threads.
+class PchCache {
+ public:
+  explicit PchCache(std::string cache_directory);
+
+  // Returns the path of a PCH covering the shared include prefix of
+  // `main_file`, building it first if needed. `invocation` must already have
+  // `main_file` as its input. Fails with NotFound when the file doesn't begin
+  // with system includes.
+  absl::StatusOr<std::string> GetOrBuild(
+      const clang::CompilerInvocation& invocation,
+      clang::FileManager& file_manager, const std::string& main_file);
+
+  // Forgets which PCHs were found current and which failed to build, so that
+  // the next GetOrBuild for each checks its manifest, or builds it, again.
+  void Revalidate();
+
+  // Marks the PCH at `pch_path`, as returned by GetOrBuild, as one clang
+  // failed to load. It is no longer handed out, and is rebuilt after the next
+  // Revalidate.
+  void Invalidate(const std::string& pch_path);
+
+ private:
+  struct Entry {
+    std::mutex mutex;
+    bool ready = false;
+    absl::Status status;
+  };
+
+  std::string cache_directory_;
+  std::mutex entries_mutex_;
+  absl::flat_hash_map<uint64_t, std::shared_ptr<Entry>> entries_;
+};
+
+}  // namespace typesynth
+
+#endif  //PCH_CACHE_H
@@ -0,0 +1,80 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "root_filter.h"
+
+#include <algorithm>
+
+#include <llvm/Support/Error.h>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+
+#include "hashing.h"
+
+namespace typesynth {
+
+absl::StatusOr<RootFilter> RootFilter::Create(const ExtractionFilter& filter) {
+  RootFilter root_filter;
+  for (const std::string& glob : filter.file_globs) {
+    llvm::Expected<llvm::GlobPattern> pattern =
+        llvm::GlobPattern::create(glob);
+    if (!pattern) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Invalid glob ", glob, ": ", llvm::toString(pattern.takeError())));
+    }
+    root_filter.globs_.push_back(std::move(*pattern));
+  }
+
+  for (const std::string& root : filter.roots) {
+    root_filter.roots_.insert(root);
+    const size_t separator = root.rfind("::");
+    root_filter.root_names_.insert(separator == std::string::npos
+                                       ? root
+                                       : root.substr(separator + 2));
+  }
+
+  // Sorted, so that the same filter given in another order hashes the same.
+  std::vector<std::string> roots(filter.roots);
+  std::vector<std::string> globs(filter.file_globs);
+  std::ranges::sort(roots);
+  std::ranges::sort(globs);
+  HashBuilder hash;
+  hash.Add(roots.size());
+  for (const std::string& root : roots)
+    hash.Add(root);
+  hash.Add(globs.size());
+  for (const std::string& glob : globs)
+    hash.Add(glob);
+  root_filter.hash_ = hash.value();
+  return root_filter;
+}
+
+bool RootFilter::IsFileAllowed(llvm::StringRef path) const {
+  return std::ranges::any_of(globs_, [path](const llvm::GlobPattern& glob) {
+    return glob.match(path);
+  });
+}
+
+}  // namespace typesynth
@@ -0,0 +1,91 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ROOT_FILTER_H
+#define ROOT_FILTER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/GlobPattern.h>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/statusor.h"
+
+namespace typesynth {
+
+// Limits extraction to what some declarations need. The declarations named in
+// `roots`, and all those in files matching one of `file_globs`, are roots,
+// and only they and the types they refer to, directly or not, are extracted.
+// An empty filter extracts everything.
+struct ExtractionFilter {
+  // Qualified names of functions, records, enums and typedefs, such as
+  // "CreateFileW" or "ns::Widget".
+  std::vector<std::string> roots;
+  // Patterns as llvm::GlobPattern takes them, matched against file paths as
+  // they were included; "*" also matches "/".
+  std::vector<std::string> file_globs;
+};
+
+// An ExtractionFilter ready for matching.
+class RootFilter {
+ public:
+  // Fails on malformed globs.
+  static absl::StatusOr<RootFilter> Create(const ExtractionFilter& filter);
+
+  [[nodiscard]] bool has_roots() const { return !roots_.empty(); }
+  [[nodiscard]] bool has_file_globs() const { return !globs_.empty(); }
+
+  // Whether the declarations in the file at `path` are all roots.
+  [[nodiscard]] bool IsFileAllowed(llvm::StringRef path) const;
+
+  // Whether a declaration with the unqualified name `name` may be a root;
+  // cheap enough to run before its qualified name is built.
+  [[nodiscard]] bool MayBeRoot(llvm::StringRef name) const {
+    return root_names_.contains(std::string_view(name));
+  }
+
+  [[nodiscard]] bool IsRoot(std::string_view qualified_name) const {
+    return roots_.contains(qualified_name);
+  }
+
+  // Tells the filters apart in cache keys.
+  [[nodiscard]] uint64_t hash() const { return hash_; }
+
+ private:
+  RootFilter() = default;
+
+  std::vector<llvm::GlobPattern> globs_;
+  absl::flat_hash_set<std::string> roots_;
+  // The last component of each root.
+  absl::flat_hash_set<std::string> root_names_;
+  uint64_t hash_ = 0;
+};
+
+}  // namespace typesynth
+
+#endif  //ROOT_FILTER_H
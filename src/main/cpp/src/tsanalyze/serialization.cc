@@ -0,0 +1,348 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "serialization.h"
+
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "absl/strings/str_cat.h"
+
+namespace typesynth {
+namespace {
+
+// Deeper chains of symbolic references or nested derived types are cut off
+// rather than followed, which also guards against cycles.
+constexpr int kMaxDepth = 64;
+
+class AnalysisJsonWriter {
+ public:
+  AnalysisJsonWriter(const TypeRegistry& registry, StableTypeIds stable_ids,
+                     llvm::raw_ostream& os)
+      : registry_(registry),
+        stable_ids_(std::move(stable_ids)),
+        json_(os) {}
+
+  void Write(const AnalysisInputs& inputs, const TypeDelta* delta,
+             std::span<const ClosureRoot> roots = {}) {
+    json_.object([&] {
+      json_.attribute("version", kAnalysisJsonVersion);
+      json_.attribute("mainFile", inputs.main_file);
+      json_.attributeArray("files", [&] {
+        for (const std::string& file : inputs.files)
+          json_.value(file);
+      });
+      json_.attributeArray("clangFlags", [&] {
+        for (const std::string& flag : inputs.clang_flags)
+          json_.value(flag);
+      });
+      json_.attributeArray("targets", [&] {
+        for (const std::string& target : registry_.targets())
+          json_.value(target);
+      });
+      json_.attributeObject("types", [&] {
+        if (!delta) {
+          for (TypeId type_id : registry_)
+            MaybeWriteNode(type_id);
+          return;
+        }
+        for (TypeId type_id : delta->added)
+          MaybeWriteNode(type_id);
+        for (TypeId type_id : delta->changed)
+          MaybeWriteNode(type_id);
+      });
+      if (delta) {
+        json_.attributeObject("delta", [&] {
+          json_.attributeArray("changed", [&] {
+            for (TypeId type_id : delta->changed) {
+              if (IsWritten(type_id))
+                json_.value(Key(type_id));
+            }
+          });
+          json_.attributeArray("removed", [&] {
+            for (uint64_t id : delta->removed)
+              json_.value(FormatId(id));
+          });
+        });
+      }
+      if (!roots.empty()) {
+        json_.attributeObject("roots", [&] {
+          for (const ClosureRoot& root : roots) {
+            json_.attributeArray(root.query, [&] {
+              for (TypeId type_id : root.types)
+                json_.value(Key(RootType(type_id)));
+            });
+          }
+        });
+      }
+    });
+  }
+
+ private:
+  llvm::StringRef String(StringId id) const {
+    return llvm::StringRef(registry_.String(id));
+  }
+
+  // Follows symbolic references to the node they stand for.
+  TypeId Resolve(TypeId type_id) const {
+    for (int depth = 0; depth < kMaxDepth; ++depth) {
+      const auto* symbolic =
+          registry_.Get<models::SymbolicReference>(type_id);
+      if (!symbolic)
+        return type_id;
+      type_id = symbolic->inner;
+    }
+    return type_id;
+  }
+
+  // Function declarations are not written, so they are found as their
+  // prototype.
+  TypeId RootType(TypeId type_id) const {
+    type_id = Resolve(type_id);
+    if (const auto* function = registry_.Get<models::FunctionDecl>(type_id))
+      return function->type;
+    return type_id;
+  }
+
+  void Reference(llvm::StringRef key, TypeId type_id) {
+    json_.attribute(key, Key(type_id));
+  }
+
+  static std::string FormatId(uint64_t id) {
+    return absl::StrCat(absl::Hex(id, absl::kZeroPad16));
+  }
+
+  std::string Key(TypeId type_id) const {
+    return FormatId(stable_ids_.IdOf(Resolve(type_id)));
+  }
+
+  // Symbolic references stand for the declaration they name, and function
+  // declarations are not types.
+  bool IsWritten(TypeId type_id) const {
+    const models::NodeKind kind = registry_.kind(type_id);
+    return kind != models::NodeKind::kSymbolicReference &&
+           kind != models::NodeKind::kFunctionDeclaration;
+  }
+
+  void MaybeWriteNode(TypeId type_id) {
+    if (IsWritten(type_id))
+      WriteNode(type_id);
+  }
+
+  // Appends a C-like spelling of `type_id` to `name`.
+  void AppendName(TypeId type_id, std::string& name, int depth = 0) const {
+    type_id = Resolve(type_id);
+    if (!registry_.Contains(type_id) || depth >= kMaxDepth) {
+      name += "?";
+      return;
+    }
+
+    registry_.Visit(type_id, [&]<typename T>(const T& n) {
+      if constexpr (std::is_same_v<T, models::Primitive>) {
+        name += registry_.String(n.primitive);
+      } else if constexpr (std::is_same_v<T, models::Pointer>) {
+        AppendName(n.inner, name, depth + 1);
+        name += " *";
+      } else if constexpr (std::is_same_v<T, models::Reference>) {
+        AppendName(n.inner, name, depth + 1);
+        name += " &";
+      } else if constexpr (std::is_same_v<T, models::Function>) {
+        AppendName(n.ret_type, name, depth + 1);
+        name += " (";
+        const auto args = registry_.List(n.args);
+        for (size_t i = 0; i < args.size(); ++i) {
+          if (i > 0)
+            name += ", ";
+          AppendName(args[i].type, name, depth + 1);
+        }
+        if (n.is_variadic)
+          name += args.empty() ? "..." : ", ...";
+        name += ")";
+      } else if constexpr (std::is_same_v<T, models::SymbolicReference>) {
+        name += "?";
+      } else {
+        name += registry_.String(n.qualified_name);
+      }
+    });
+  }
+
+  void Fields(models::ListRef<models::RecordField> fields) {
+    json_.attributeArray("fields", [&] {
+      for (const auto& field : registry_.List(fields)) {
+        json_.object([&] {
+          json_.attribute("name", String(field.name));
+          Reference("type", field.type);
+          json_.attribute("offsetInBits", field.offset_bits);
+          if (field.bit_width != 0)
+            json_.attribute("bitWidth", field.bit_width);
+        });
+      }
+    });
+  }
+
+  // Where a type of a multi-target registry exists, when not on all targets,
+  // and its layouts on the targets where they differ from the node's.
+  void TargetTables(TypeId type_id) {
+    if (registry_.targets().empty())
+      return;
+
+    const size_t num_targets = registry_.targets().size();
+    const uint64_t mask = registry_.TargetMask(type_id);
+    if (std::popcount(mask) != static_cast<int>(num_targets)) {
+      json_.attributeArray("targets", [&] {
+        for (size_t i = 0; i < num_targets; ++i) {
+          if (mask & (uint64_t{1} << i))
+            json_.value(static_cast<int64_t>(i));
+        }
+      });
+    }
+
+    const auto layouts = registry_.TargetLayouts(type_id);
+    if (layouts.empty())
+      return;
+    const models::NodeKind kind = registry_.kind(type_id);
+    json_.attributeArray("layouts", [&] {
+      for (const auto& layout : layouts) {
+        json_.object([&] {
+          json_.attribute("target", layout.target);
+          if (kind == models::NodeKind::kPrimitive) {
+            json_.attribute("sizeInBits", layout.size);
+            json_.attribute("signed", layout.is_signed);
+            return;
+          }
+          json_.attribute("sizeInBytes", layout.size);
+          if (kind != models::NodeKind::kEnumDeclaration) {
+            json_.attributeArray("fieldOffsetsInBits", [&] {
+              for (uint32_t offset : layout.field_offsets_bits)
+                json_.value(offset);
+            });
+          }
+        });
+      }
+    });
+  }
+
+  void WriteNode(TypeId type_id) {
+    name_.clear();
+    AppendName(type_id, name_);
+
+    json_.attributeObject(Key(type_id), [&] {
+      registry_.Visit(type_id, [&]<typename T>(const T& n) {
+        if constexpr (std::is_same_v<T, models::Primitive>) {
+          json_.attribute("kind", "PrimitiveType");
+          json_.attribute("name", llvm::StringRef(name_));
+          json_.attribute("sizeInBits", n.size_bits);
+          json_.attribute("signed", n.is_signed);
+        } else if constexpr (std::is_same_v<T, models::Pointer>) {
+          json_.attribute("kind", "PointerType");
+          json_.attribute("name", llvm::StringRef(name_));
+          Reference("pointeeType", n.inner);
+        } else if constexpr (std::is_same_v<T, models::Reference>) {
+          json_.attribute("kind", "ReferenceType");
+          json_.attribute("name", llvm::StringRef(name_));
+          Reference("referencedType", n.inner);
+        } else if constexpr (std::is_same_v<T, models::Function>) {
+          json_.attribute("kind", "FunctionPrototype");
+          json_.attribute("name", llvm::StringRef(name_));
+          Reference("returnType", n.ret_type);
+          json_.attributeArray("parameterTypes", [&] {
+            for (const auto& arg : registry_.List(n.args))
+              json_.value(Key(arg.type));
+          });
+          json_.attribute("isVariadic", n.is_variadic);
+        } else if constexpr (std::is_same_v<T, models::StructDecl> ||
+                             std::is_same_v<T, models::UnionDecl>) {
+          json_.attribute("kind", std::is_same_v<T, models::StructDecl>
+                                      ? "StructType"
+                                      : "UnionType");
+          json_.attribute("name", llvm::StringRef(name_));
+          Fields(n.fields);
+          json_.attribute("sizeInBytes", n.size_bytes);
+        } else if constexpr (std::is_same_v<T, models::EnumDecl>) {
+          json_.attribute("kind", "EnumType");
+          json_.attribute("name", llvm::StringRef(name_));
+          json_.attributeArray("enumerators", [&] {
+            for (const auto& constant : registry_.List(n.constants)) {
+              json_.object([&] {
+                json_.attribute("name", String(constant.name));
+                json_.attribute("value", constant.value);
+              });
+            }
+          });
+          json_.attribute("sizeInBytes", n.size_bytes);
+        } else if constexpr (std::is_same_v<T, models::TypedefDecl>) {
+          json_.attribute("kind", "TypedefType");
+          json_.attribute("name", llvm::StringRef(name_));
+          Reference("underlyingType", n.underlying);
+        }
+      });
+      TargetTables(type_id);
+    });
+  }
+
+  const TypeRegistry& registry_;
+  const StableTypeIds stable_ids_;
+  llvm::json::OStream json_;
+  // Reused between nodes to avoid an allocation per name.
+  std::string name_;
+};
+
+}  // namespace
+
+void WriteAnalysisJson(const AnalysisInputs& inputs,
+                       const TypeRegistry& registry, llvm::raw_ostream& os,
+                       AnalysisMetrics* metrics, const TypeDelta* delta) {
+  const uint64_t start = os.tell();
+  double seconds = 0;
+  {
+    PhaseTimer timer(seconds, "WriteAnalysisJson");
+    AnalysisJsonWriter(registry, StableTypeIds(registry), os)
+        .Write(inputs, delta);
+    os.flush();
+  }
+  if (metrics) {
+    metrics->serialization_seconds += seconds;
+    metrics->bytes_emitted += os.tell() - start;
+  }
+}
+
+void WriteTypeClosureJson(const AnalysisInputs& inputs,
+                          const TypeRegistry& registry,
+                          StableTypeIds stable_ids,
+                          std::span<const ClosureRoot> roots,
+                          llvm::raw_ostream& os) {
+  AnalysisJsonWriter(registry, std::move(stable_ids), os)
+      .Write(inputs, /*delta=*/nullptr, roots);
+  os.flush();
+}
+
+}  // namespace typesynth
@@ -0,0 +1,104 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SERIALIZATION_H
+#define SERIALIZATION_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "analysis_metrics.h"
+#include "stable_ids.h"
+#include "type_registry.h"
+
+namespace llvm {
+class raw_ostream;
+}  // namespace llvm
+
+namespace typesynth {
+
+// What was analyzed to produce the types being serialized.
+struct AnalysisInputs {
+  std::string main_file;
+  std::vector<std::string> files;
+  std::vector<std::string> clang_flags;
+};
+
+// Version of the document WriteAnalysisJson writes. Documents without a
+// version are version 1, which keyed types by registry id and wrote
+// references as pointers. Version 2 keys types by StableTypeIds id, and
+// writes references as "ReferenceType" with a "referencedType".
+inline constexpr int64_t kAnalysisJsonVersion = 2;
+
+// Writes `registry` as the JSON document consumed by the Ghidra plugin:
+//
+//   {"version": ..., "mainFile": ..., "files": [...], "clangFlags": [...],
+//    "targets": [...], "types": {"<key>": {"kind": ..., "name": ..., ...}}}
+//
+// Types are keyed by their StableTypeIds id, as 16 hex digits, and refer to
+// each other by key. Symbolic references are resolved to the declaration they
+// name and are not written themselves.
+// "targets" lists the triples of a multi-target registry, and is empty
+// otherwise. Types not on every target then list the indices of those they
+// are on under "targets", and types laid out differently on some targets
+// list those layouts under "layouts", as {"target": <index>, ...} with the
+// size, signedness and field offsets the type itself carries.
+// Nodes are written straight to `os` as they are visited, names included,
+// rather than built up as a JSON document first. The only memory that grows
+// with the registry is its StableTypeIds, which holds an id for every type.
+// Write failures are reported through `os`. The time taken and bytes written
+// are added to `metrics` if given.
+//
+// Given a `delta` against an earlier registry, "types" only holds the added
+// and changed types, and a "delta" object lists the keys of the changed
+// ones under "changed" and of the removed ones under "removed".
+void WriteAnalysisJson(const AnalysisInputs& inputs,
+                       const TypeRegistry& registry, llvm::raw_ostream& os,
+                       AnalysisMetrics* metrics = nullptr,
+                       const TypeDelta* delta = nullptr);
+
+// A root of a type closure as it was asked for, by name or key, and the
+// types that were found for it.
+struct ClosureRoot {
+  std::string query;
+  std::vector<TypeId> types;
+};
+
+// Writes `registry`, the types reachable from some roots such as
+// TypeArchive::ToRegistry gives for a Closure, as WriteAnalysisJson does, but
+// keyed by `stable_ids`, which a registry that only holds part of the types
+// cannot compute the same way. A "roots" object maps the query of each of
+// `roots` to the keys of its types, where function declarations, which are
+// not written, stand for their prototype.
+void WriteTypeClosureJson(const AnalysisInputs& inputs,
+                          const TypeRegistry& registry,
+                          StableTypeIds stable_ids,
+                          std::span<const ClosureRoot> roots,
+                          llvm::raw_ostream& os);
+
+}  // namespace typesynth
+
+#endif  //SERIALIZATION_H
@@ -0,0 +1,122 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "stable_ids.h"
+
+#include <algorithm>
+
+#include "hashing.h"
+#include "structural_hash.h"
+
+namespace typesynth {
+
+StableTypeIds::StableTypeIds(const TypeRegistry& registry) {
+  StructuralHasher hasher(registry, {.reference_by_name = true});
+
+  // Group by identity first; identities are unique unless several
+  // definitions share a name, or identical nodes were never folded.
+  std::unordered_map<uint64_t, std::vector<TypeId>> by_identity;
+  entries_.reserve(registry.size());
+  for (TypeId type_id : registry) {
+    const uint64_t identity = hasher.IdentityOf(type_id);
+    entries_.emplace(type_id, Entry{.id = identity,
+                                    .content = hasher.HashOf(type_id)});
+    by_identity[identity].push_back(type_id);
+  }
+
+  for (auto& [identity, type_ids] : by_identity) {
+    if (type_ids.size() == 1)
+      continue;
+    // Ordered by content so the ids don't depend on extraction order; only
+    // unfolded duplicates fall back to it.
+    std::stable_sort(type_ids.begin(), type_ids.end(),
+                     [this](TypeId a, TypeId b) {
+                       return entries_[a].content < entries_[b].content;
+                     });
+    for (size_t i = 0; i < type_ids.size(); ++i) {
+      Entry& entry = entries_[type_ids[i]];
+      HashBuilder id;
+      id.Add(identity).Add(entry.content);
+      if (i > 0 && entries_[type_ids[i - 1]].content == entry.content)
+        id.Add(static_cast<uint64_t>(i));
+      entry.id = id.value();
+    }
+  }
+}
+
+StableTypeIds::StableTypeIds(
+    std::span<const std::pair<TypeId, uint64_t>> ids) {
+  entries_.reserve(ids.size());
+  for (const auto& [type_id, id] : ids)
+    entries_.emplace(type_id, Entry{.id = id, .content = 0});
+}
+
+uint64_t StableTypeIds::IdOf(TypeId type_id) const {
+  if (auto it = entries_.find(type_id); it != entries_.end())
+    return it->second.id;
+  return HashBuilder().Add(type_id).value();
+}
+
+uint64_t StableTypeIds::ContentOf(TypeId type_id) const {
+  if (auto it = entries_.find(type_id); it != entries_.end())
+    return it->second.content;
+  return 0;
+}
+
+TypeDelta DiffTypes(const TypeRegistry& previous,
+                    const TypeRegistry& current) {
+  const StableTypeIds previous_ids(previous);
+  const StableTypeIds current_ids(current);
+
+  std::unordered_map<uint64_t, uint64_t> previous_contents;
+  previous_contents.reserve(previous.size());
+  for (TypeId type_id : previous) {
+    if (previous.kind(type_id) != models::NodeKind::kSymbolicReference) {
+      previous_contents.emplace(previous_ids.IdOf(type_id),
+                                previous_ids.ContentOf(type_id));
+    }
+  }
+
+  TypeDelta delta;
+  for (TypeId type_id : current) {
+    if (current.kind(type_id) == models::NodeKind::kSymbolicReference)
+      continue;
+    auto it = previous_contents.find(current_ids.IdOf(type_id));
+    if (it == previous_contents.end()) {
+      delta.added.push_back(type_id);
+      continue;
+    }
+    if (it->second != current_ids.ContentOf(type_id))
+      delta.changed.push_back(type_id);
+    previous_contents.erase(it);
+  }
+
+  // Whatever was not matched is gone; sorted so output is deterministic.
+  for (const auto& [id, content] : previous_contents)
+    delta.removed.push_back(id);
+  std::sort(delta.removed.begin(), delta.removed.end());
+  return delta;
+}
+
+}  // namespace typesynth
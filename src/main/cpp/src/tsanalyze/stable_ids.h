@@ -0,0 +1,86 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef STABLE_IDS_H
+#define STABLE_IDS_H
+
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "type_registry.h"
+
+namespace typesynth {
+
+// Ids for the types of a registry that derive from the types themselves
+// rather than from the order they were extracted in, so the same header gives
+// the same ids on every run. Named declarations are identified by kind and
+// qualified name, so a record keeps its id when its fields change; other
+// types by their content, referring to named declarations by name. Same-name
+// definitions that differ are told apart by their content.
+class StableTypeIds {
+ public:
+  explicit StableTypeIds(const TypeRegistry& registry);
+
+  // Takes ids computed earlier, such as those a type archive stores, as they
+  // are. ContentOf is then 0 for every type.
+  explicit StableTypeIds(std::span<const std::pair<TypeId, uint64_t>> ids);
+
+  // The stable id of `type_id`. Ids missing from the registry get one that is
+  // only stable within this registry.
+  [[nodiscard]] uint64_t IdOf(TypeId type_id) const;
+
+  // A hash of everything that is written out for `type_id`, layout included,
+  // which changes exactly when the type does. Types it refers to only count
+  // through their ids.
+  [[nodiscard]] uint64_t ContentOf(TypeId type_id) const;
+
+ private:
+  struct Entry {
+    uint64_t id;
+    uint64_t content;
+  };
+  std::unordered_map<TypeId, Entry> entries_;
+};
+
+// The differences between two registries of the same code, such as before
+// and after a header changed, by stable id.
+struct TypeDelta {
+  // Types of the current registry that are new, or whose content changed.
+  std::vector<TypeId> added;
+  std::vector<TypeId> changed;
+  // Stable ids of the types of the previous registry that are gone.
+  std::vector<uint64_t> removed;
+};
+
+// Symbolic references are left out, as they stand for the declaration they
+// name.
+[[nodiscard]] TypeDelta DiffTypes(const TypeRegistry& previous,
+                                  const TypeRegistry& current);
+
+}  // namespace typesynth
+
+#endif  //STABLE_IDS_H
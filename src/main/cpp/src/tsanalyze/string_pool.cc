@@ -0,0 +1,50 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "string_pool.h"
+
+#include <cstring>
+
+namespace typesynth {
+
+StringPool::StringPool() : strings_(1) {}
+
+StringId StringPool::Intern(std::string_view value) {
+  if (value.empty())
+    return kEmptyStringId;
+
+  if (auto it = ids_.find(value); it != ids_.end())
+    return it->second;
+
+  // The map is keyed on the arena copy, since `value` may not outlive this
+  // call.
+  char* copy = arena_.Allocate<char>(value.size());
+  std::memcpy(copy, value.data(), value.size());
+  const auto id = static_cast<StringId>(strings_.size());
+  strings_.emplace_back(copy, value.size());
+  ids_.emplace(strings_.back(), id);
+  return id;
+}
+
+}  // namespace typesynth
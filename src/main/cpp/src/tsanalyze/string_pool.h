@@ -0,0 +1,68 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include <llvm/Support/Allocator.h>
+
+#include "absl/container/flat_hash_map.h"
+
+#include "models.h"
+
+namespace typesynth {
+
+// Stores each distinct string once and hands out dense ids for them. Strings
+// are copied into a bump-allocated arena, so the views returned by Get stay
+// valid for the lifetime of the pool, including across moves.
+class StringPool {
+ public:
+  StringPool();
+  StringPool(StringPool&&) noexcept = default;
+  StringPool& operator=(StringPool&&) noexcept = default;
+
+  StringPool(const StringPool&) = delete;
+  StringPool& operator=(const StringPool&) = delete;
+
+  // Returns the id of `value`, adding it to the pool if it is new.
+  StringId Intern(std::string_view value);
+
+  [[nodiscard]] std::string_view Get(StringId id) const { return strings_[id]; }
+
+  // Number of distinct strings, including the empty string.
+  [[nodiscard]] size_t size() const { return strings_.size(); }
+
+ private:
+  std::vector<std::string_view> strings_;
+  absl::flat_hash_map<std::string_view, StringId> ids_;
+  llvm::BumpPtrAllocator arena_;
+};
+
+}  // namespace typesynth
+
+#endif  //STRING_POOL_H
@@ -0,0 +1,151 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "structural_hash.h"
+
+#include <string_view>
+#include <type_traits>
+
+namespace typesynth {
+
+namespace {
+
+// Returns the qualified name of a named declaration, or an empty view for
+// anonymous declarations and nodes that aren't declarations at all.
+std::string_view DeclaredName(const TypeRegistry& registry, TypeId type_id) {
+  return registry.Visit(
+      type_id, [&registry]<typename T>(const T& n) -> std::string_view {
+        if constexpr (requires { n.qualified_name; }) {
+          return registry.String(n.qualified_name);
+        } else {
+          return {};
+        }
+      });
+}
+
+}  // namespace
+
+uint64_t StructuralHasher::IdentityOf(TypeId type_id) {
+  if (!registry_.Contains(type_id))
+    return HashBuilder().Add(type_id).value();
+  if (auto it = identities_.find(type_id); it != identities_.end())
+    return it->second;
+
+  std::string_view name = DeclaredName(registry_, type_id);
+  if (name.empty())
+    return HashOf(type_id);
+
+  return HashBuilder()
+      .Add(static_cast<uint64_t>(registry_.kind(type_id)))
+      .Add(name)
+      .value();
+}
+
+uint64_t StructuralHasher::HashOf(TypeId type_id) {
+  if (auto it = hashes_.find(type_id); it != hashes_.end())
+    return it->second;
+
+  if (!registry_.Contains(type_id))
+    return HashBuilder().Add(type_id).value();
+
+  // Anonymous declarations are hashed by content when referenced, so a cycle
+  // through one would never bottom out. Break it with a fixed marker.
+  if (!in_progress_.insert(type_id).second)
+    return HashBuilder().Add(std::string_view("(cycle)")).value();
+
+  // Strings are hashed by content; their ids depend on interning order.
+  auto str = [this](StringId id) { return registry_.String(id); };
+  HashBuilder hash;
+  hash.Add(static_cast<uint64_t>(registry_.kind(type_id)));
+
+  registry_.Visit(type_id, [&]<typename T>(const T& n) {
+    if constexpr (std::is_same_v<T, models::Primitive>) {
+      hash.Add(str(n.primitive));
+      if (options_.include_layout)
+        hash.Add(n.size_bits).Add(n.is_signed);
+    } else if constexpr (std::is_same_v<T, models::Pointer> ||
+                         std::is_same_v<T, models::Reference>) {
+      hash.Add(ReferenceTo(n.inner));
+    } else if constexpr (std::is_same_v<T, models::SymbolicReference>) {
+      hash.Add(IdentityOf(n.inner));
+    } else if constexpr (std::is_same_v<T, models::Function>) {
+      hash.Add(ReferenceTo(n.ret_type)).Add(n.args.size);
+      for (const auto& arg : registry_.List(n.args))
+        hash.Add(str(arg.name)).Add(ReferenceTo(arg.type));
+      hash.Add(n.is_variadic);
+    } else if constexpr (std::is_same_v<T, models::StructDecl> ||
+                         std::is_same_v<T, models::UnionDecl>) {
+      hash.Add(str(n.name)).Add(str(n.qualified_name)).Add(n.fields.size);
+      for (const auto& field : registry_.List(n.fields)) {
+        hash.Add(str(field.name))
+            .Add(ReferenceTo(field.type))
+            .Add(field.bit_width);
+        if (options_.include_layout)
+          hash.Add(field.offset_bits);
+      }
+      if (options_.include_layout)
+        hash.Add(n.size_bytes);
+      hash.Add(n.is_packed)
+          .Add(n.is_anonymous)
+          .Add(n.is_complete);
+    } else if constexpr (std::is_same_v<T, models::EnumDecl>) {
+      hash.Add(str(n.name))
+          .Add(str(n.qualified_name))
+          .Add(ReferenceTo(n.underlying));
+      hash.Add(n.constants.size);
+      for (const auto& constant : registry_.List(n.constants)) {
+        hash.Add(str(constant.name))
+            .Add(static_cast<uint64_t>(constant.value));
+      }
+      if (options_.include_layout)
+        hash.Add(n.size_bytes);
+      hash.Add(n.is_anonymous);
+    } else if constexpr (std::is_same_v<T, models::TypedefDecl>) {
+      hash.Add(str(n.name))
+          .Add(str(n.qualified_name))
+          .Add(ReferenceTo(n.underlying));
+    } else if constexpr (std::is_same_v<T, models::FunctionDecl>) {
+      hash.Add(str(n.name))
+          .Add(str(n.qualified_name))
+          .Add(ReferenceTo(n.type));
+      for (StringId param_name : registry_.List(n.param_names))
+        hash.Add(str(param_name));
+    }
+  });
+
+  if (options_.include_layout && !registry_.targets().empty()) {
+    hash.Add(registry_.TargetMask(type_id));
+    for (const auto& layout : registry_.TargetLayouts(type_id)) {
+      hash.Add(layout.target).Add(layout.size).Add(layout.is_signed);
+      for (uint32_t offset : layout.field_offsets_bits)
+        hash.Add(offset);
+    }
+  }
+
+  in_progress_.erase(type_id);
+  hashes_.emplace(type_id, hash.value());
+  return hash.value();
+}
+
+}  // namespace typesynth
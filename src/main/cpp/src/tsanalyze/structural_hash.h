@@ -0,0 +1,87 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef STRUCTURAL_HASH_H
+#define STRUCTURAL_HASH_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "hashing.h"
+#include "type_registry.h"
+
+namespace typesynth {
+
+// Computes a hash of a type node's structure that is independent of the ids
+// its registry happened to hand out, so equal types extracted from different
+// translation units hash equally. Named declarations are referred to by kind
+// and qualified name rather than by content, which keeps hashing of
+// self-referential records finite. Hashes are deterministic across runs.
+class StructuralHasher {
+ public:
+  struct Options {
+    // Off, sizes, signedness and field offsets are left out, so the same type
+    // extracted for different targets hashes equally. On, the target tables
+    // of multi-target registries are hashed as well.
+    bool include_layout = true;
+    // Refer to named declarations by name wherever they are referenced, not
+    // only through symbolic references, so that a type's hash is independent
+    // of the contents of the declarations it refers to.
+    bool reference_by_name = false;
+  };
+
+  explicit StructuralHasher(const TypeRegistry& registry)
+      : StructuralHasher(registry, Options()) {}
+  StructuralHasher(const TypeRegistry& registry, Options options)
+      : registry_(registry), options_(options) {}
+
+  [[nodiscard]] uint64_t HashOf(TypeId type_id);
+
+  // Hash used wherever `type_id` is referred to from another node: the
+  // qualified name for named declarations, the full structure otherwise.
+  [[nodiscard]] uint64_t IdentityOf(TypeId type_id);
+
+  // Has references to `type_id` hash as `identity` instead, for telling apart
+  // definitions that share a qualified name. Must be called before hashing.
+  void SetIdentity(TypeId type_id, uint64_t identity) {
+    identities_[type_id] = identity;
+  }
+
+ private:
+  // How a node refers to `type_id`, per Options::reference_by_name.
+  uint64_t ReferenceTo(TypeId type_id) {
+    return options_.reference_by_name ? IdentityOf(type_id) : HashOf(type_id);
+  }
+
+  const TypeRegistry& registry_;
+  const Options options_;
+  std::unordered_map<TypeId, uint64_t> hashes_;
+  std::unordered_map<TypeId, uint64_t> identities_;
+  std::unordered_set<TypeId> in_progress_;
+};
+
+}  // namespace typesynth
+
+#endif  //STRUCTURAL_HASH_H
@@ -22,55 +22,860 @@
  * THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/DeclGroup.h>
+#include <clang/AST/DeclObjC.h>
+#include <clang/AST/RecordLayout.h>
+#include <clang/Basic/FileManager.h>
 #include <clang/Frontend/CompilerInstance.h>
-#include <llvm/ADT/StringExtras.h>
+#include <clang/Frontend/FrontendAction.h>
+#include <clang/Frontend/Utils.h>
+#include <clang/Lex/Preprocessor.h>
+#include <clang/Lex/HeaderSearchOptions.h>
+#include <clang/Lex/PreprocessorOptions.h>
+#include <clang/Tooling/ArgumentsAdjusters.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/JSONCompilationDatabase.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/Support/Chrono.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/VirtualFileSystem.h>
 
 #include "absl/strings/str_cat.h"
+#include "dependency_manifest.h"
+#include "header_fragments.h"
+#include "memory_usage.h"
+#include "multi_target.h"
 #include "tsanalyze.h"
 
 namespace typesynth {
 
-using models::NodeKind;
+// Feeds declarations to the analyzer as the parser produces them, so types
+// are extracted while the rest of the file is still being parsed. With
+// `header_keys`, each header declaration goes in under the key of its header,
+// so those of headers already extracted by another translation unit are
+// skipped as they arrive.
+class ExtractionConsumer : public clang::ASTConsumer {
+ public:
+  ExtractionConsumer(TypeAnalyzer& analyzer,
+                     const HeaderKeyTracker* header_keys)
+      : analyzer_(analyzer), header_keys_(header_keys) {}
+
+  void Initialize(clang::ASTContext& context) override { context_ = &context; }
+
+  // Returning false makes the parser give up on the rest of the file.
+  bool HandleTopLevelDecl(clang::DeclGroupRef group) override {
+    if (analyzer_.cancelled())
+      return false;
+    PhaseTimer timer(analyzer_.unit_metrics_.extraction_seconds,
+                     "ExtractTypes");
+    const clang::SourceManager& source_manager =
+        context_->getSourceManager();
+    for (const clang::Decl* decl : group) {
+      const clang::FileID file = source_manager.getFileID(
+          source_manager.getExpansionLoc(decl->getLocation()));
+      if (analyzer_.SkipsFile(file, source_manager) &&
+          !analyzer_.DefinesIncompleteType(*decl))
+        continue;
+      std::optional<uint64_t> key;
+      if (header_keys_ && file != source_manager.getMainFileID())
+        key = header_keys_->KeyFor(file);
+      if (key) {
+        header_keys_seen_.try_emplace(file, *key);
+        analyzer_.ProcessHeaderDeclaration(*key, decl, *context_);
+      } else {
+        analyzer_.ProcessDeclaration(decl, *context_);
+      }
+    }
+    return true;
+  }
+
+  // Declarations loaded from the precompiled header never went through the
+  // parser, so they are picked up once the rest of the file is done.
+  void HandleTranslationUnit(clang::ASTContext& context) override {
+    // The AST is complete and not yet torn down, which is about when the
+    // translation unit takes the most memory.
+    analyzer_.unit_metrics_.resident_bytes = CurrentResidentBytes();
+    PhaseTimer timer(analyzer_.unit_metrics_.extraction_seconds,
+                     "ExtractTypes");
+    for (const clang::Decl* decl : context.getTranslationUnitDecl()->decls()) {
+      if (analyzer_.cancelled())
+        return;
+      if (decl->isFromASTFile()) {
+        analyzer_.ProcessDeclaration(decl, context);
+      }
+    }
+
+    // A header the preprocessor stopped inside yielded only some of its
+    // declarations, which must not stand in for all of them elsewhere.
+    for (const auto& [file, key] : header_keys_seen_) {
+      if (!header_keys_->IsComplete(file))
+        analyzer_.DiscardHeaderFragment(key);
+    }
+  }
+
+ private:
+  TypeAnalyzer& analyzer_;
+  const HeaderKeyTracker* header_keys_;
+  clang::ASTContext* context_ = nullptr;
+  llvm::DenseMap<clang::FileID, uint64_t> header_keys_seen_;
+};
+
+namespace {
+
+class ExtractionAction : public clang::ASTFrontendAction {
+ public:
+  ExtractionAction(TypeAnalyzer& analyzer, bool share_headers)
+      : analyzer_(analyzer), share_headers_(share_headers) {}
+
+ protected:
+  std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+      clang::CompilerInstance& compiler, llvm::StringRef in_file) override {
+    HeaderKeyTracker* header_keys = nullptr;
+    if (share_headers_) {
+      auto tracker = std::make_unique<HeaderKeyTracker>(
+          compiler.getSourceManager(),
+          HashPreprocessorOptions(compiler.getInvocation()));
+      header_keys = tracker.get();
+      compiler.getPreprocessor().addPPCallbacks(std::move(tracker));
+    }
+    return std::make_unique<ExtractionConsumer>(analyzer_, header_keys);
+  }
+
+  void ExecuteAction() override {
+    began_parsing_ = true;
+    clang::ASTFrontendAction::ExecuteAction();
+  }
+
+ public:
+  // False when the translation unit failed before parsing began, as it does
+  // when its PCH cannot be loaded.
+  [[nodiscard]] bool began_parsing() const { return began_parsing_; }
+
+ private:
+  TypeAnalyzer& analyzer_;
+  bool share_headers_;
+  bool began_parsing_ = false;
+};
+
+clang::DiagnosticsEngine* CreateDiagnosticsEngine() {
+  // Headers pulled in for type extraction routinely fail to compile in full
+  // (missing SDKs, unsupported extensions); whatever clang managed to parse is
+  // still useful, so diagnostics are swallowed rather than printed.
+  return new clang::DiagnosticsEngine(
+      clang::IntrusiveRefCntPtr<clang::DiagnosticIDs>(
+          new clang::DiagnosticIDs()),
+      new clang::DiagnosticOptions, new clang::IgnoringDiagConsumer(),
+      /*ShouldOwnClient=*/true);
+}
+
+// The file system `compiler`'s options call for, with `source_buffers` in
+// front of it. Null without buffers, which leaves the choice to clang.
+llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> CreateFileSystem(
+    clang::CompilerInstance& compiler,
+    llvm::IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> source_buffers) {
+  if (!source_buffers)
+    return nullptr;
+  auto overlay = llvm::makeIntrusiveRefCnt<llvm::vfs::OverlayFileSystem>(
+      clang::createVFSFromCompilerInvocation(compiler.getInvocation(),
+                                             compiler.getDiagnostics()));
+  overlay->pushOverlay(std::move(source_buffers));
+  return overlay;
+}
+
+// Admits translation units of a parallel analysis while they fit in a memory
+// budget. A unit fits when the resident set plus the most a unit was recently
+// seen to grow it stays within the budget; until one finished, a guess stands
+// in for that. The resident set is only known for the whole process, so what
+// a unit grows it by includes what units running beside it allocated
+// meanwhile. The estimate errs high, which throttles early rather than late.
+class MemoryGate {
+ public:
+  explicit MemoryGate(uint64_t budget) : budget_(budget) {}
+
+  // Blocks until a unit may start, and returns the resident set it starts
+  // from.
+  uint64_t Enter() {
+    std::unique_lock lock(mutex_);
+    uint64_t resident = CurrentResidentBytes();
+    while (budget_ != 0 && running_ > 0 && resident + unit_bytes_ > budget_) {
+      // Memory is also freed elsewhere, so wake up now and then regardless.
+      changed_.wait_for(lock, std::chrono::milliseconds(50));
+      resident = CurrentResidentBytes();
+    }
+    ++running_;
+    return resident;
+  }
+
+  // Ends a unit that started at `start_resident` and peaked at
+  // `peak_resident`, or zero if it was never measured.
+  void Leave(uint64_t start_resident, uint64_t peak_resident) {
+    {
+      std::lock_guard lock(mutex_);
+      --running_;
+      // A decaying maximum, so a one-off giant does not throttle every unit
+      // after it.
+      const uint64_t grown =
+          peak_resident > start_resident ? peak_resident - start_resident : 0;
+      unit_bytes_ = std::max(grown, unit_bytes_ - unit_bytes_ / 8);
+    }
+    changed_.notify_all();
+  }
+
+  // Whether another unit would not fit right now.
+  bool NearBudget() {
+    std::lock_guard lock(mutex_);
+    return budget_ != 0 && CurrentResidentBytes() + unit_bytes_ > budget_;
+  }
+
+ private:
+  static constexpr uint64_t kInitialUnitBytes = uint64_t{512} << 20;
+
+  const uint64_t budget_;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  size_t running_ = 0;
+  uint64_t unit_bytes_ = kInitialUnitBytes;
+};
+
+std::string AbsoluteSourcePath(const clang::tooling::CompileCommand& command) {
+  if (llvm::sys::path::is_absolute(command.Filename))
+    return command.Filename;
+
+  llvm::SmallString<256> path(command.Directory);
+  llvm::sys::path::append(path, command.Filename);
+  return std::string(path);
+}
+
+}  // namespace
 
 TypeAnalyzer::TypeAnalyzer(std::vector<std::string> flags)
-    : compiler_flags_(std::move(flags)) {}
+    : compiler_flags_(std::move(flags)) {
+  llvm::SmallString<256> cache_directory;
+  if (llvm::sys::path::cache_directory(cache_directory)) {
+    llvm::sys::path::append(cache_directory, "typesynth");
+    pch_cache_ = std::make_shared<PchCache>(
+        (llvm::Twine(cache_directory) + "/pch").str());
+    analysis_cache_ = std::make_shared<AnalysisCache>(
+        (llvm::Twine(cache_directory) + "/analysis").str());
+  }
+  header_fragments_ = std::make_shared<HeaderFragmentCache>();
+  memory_budget_ = PhysicalMemoryBytes() / 4 * 3;
+}
+
+TypeAnalyzer::TypeAnalyzer(TypeAnalyzer&&) noexcept = default;
+TypeAnalyzer& TypeAnalyzer::operator=(TypeAnalyzer&&) noexcept = default;
+TypeAnalyzer::~TypeAnalyzer() = default;
+
+void TypeAnalyzer::SetPchCacheDirectory(const std::string& directory) {
+  pch_cache_ =
+      directory.empty() ? nullptr : std::make_shared<PchCache>(directory);
+}
+
+void TypeAnalyzer::SetAnalysisCacheDirectory(const std::string& directory) {
+  analysis_cache_ = directory.empty()
+                        ? nullptr
+                        : std::make_shared<AnalysisCache>(directory);
+}
+
+void TypeAnalyzer::SetHeaderSharing(bool enabled) {
+  if (!enabled) {
+    header_fragments_ = nullptr;
+  } else if (!header_fragments_) {
+    header_fragments_ = std::make_shared<HeaderFragmentCache>();
+  }
+}
+
+void TypeAnalyzer::SetSourceBuffers(const std::vector<SourceBuffer>& buffers) {
+  source_buffers_ = nullptr;
+  if (!buffers.empty()) {
+    // Stamped with the time they were mounted, so that a precompiled header
+    // that included an earlier version of a buffer is checked against the
+    // new contents.
+    const time_t mounted =
+        llvm::sys::toTimeT(std::chrono::system_clock::now());
+    source_buffers_ =
+        llvm::makeIntrusiveRefCnt<llvm::vfs::InMemoryFileSystem>();
+    for (const SourceBuffer& buffer : buffers) {
+      llvm::SmallString<256> path(buffer.path);
+      llvm::sys::fs::make_absolute(path);
+      llvm::sys::path::remove_dots(path, /*remove_dot_dot=*/true);
+      source_buffers_->addFile(
+          path, mounted,
+          llvm::MemoryBuffer::getMemBufferCopy(buffer.contents, path));
+    }
+  }
+
+  // File managers cache what they looked up, including the files the old
+  // buffers shadowed or the new ones shadow.
+  file_manager_ = nullptr;
+  for (TypeAnalyzer& worker : workers_) {
+    worker.file_manager_ = nullptr;
+  }
+  if (header_fragments_)
+    header_fragments_->Clear();
+}
+
+absl::Status TypeAnalyzer::SetExtractionFilter(
+    const ExtractionFilter& filter) {
+  if (filter.roots.empty() && filter.file_globs.empty()) {
+    root_filter_ = nullptr;
+    return absl::OkStatus();
+  }
+  absl::StatusOr<RootFilter> root_filter = RootFilter::Create(filter);
+  if (!root_filter.ok())
+    return root_filter.status();
+  root_filter_ = std::make_shared<const RootFilter>(*std::move(root_filter));
+  return absl::OkStatus();
+}
+
+void TypeAnalyzer::Reset() {
+  type_registry_ = TypeRegistry();
+  type_conflicts_.clear();
+  file_manager_ = nullptr;
+  for (TypeAnalyzer& worker : workers_) {
+    worker.file_manager_ = nullptr;
+  }
+  if (header_fragments_)
+    header_fragments_->Clear();
+}
+
+void TypeAnalyzer::SetProgressCallback(ProgressCallback callback) {
+  progress_callback_ = std::move(callback);
+}
 
 absl::Status TypeAnalyzer::AnalyzeSourceFile(const std::string& filepath) {
-  auto compiler = CreateCompilerInstance();
+  return AnalyzeForEachTarget([&] {
+    TimeTraceRecording recording(time_trace_granularity_, time_trace_);
+    if (progress_callback_) {
+      progress_callback_({.units_done = 0,
+                          .units_total = 1,
+                          .types_extracted = 0,
+                          .current_file = filepath});
+    }
 
-  // Initialize the file and source management components for clang.
-  compiler->createFileManager();
-  clang::FileManager& file_manager = compiler->getFileManager();
-  compiler->createSourceManager(file_manager);
-  clang::SourceManager& source_manager = compiler->getSourceManager();
+    const size_t types_before = type_registry_.size();
+    absl::Status status = AnalyzeFile(filepath);
+    const size_t types_extracted = type_registry_.size() - types_before;
+    {
+      PhaseTimer timer(metrics_.deduplication_seconds, "DeduplicateTypes");
+      type_conflicts_ = DeduplicateTypes(type_registry_);
+    }
+    metrics_.peak_resident_bytes = PeakResidentBytes();
 
-  // Set up the source file with clang.
-  const clang::FileEntryRef file = file_manager.getFileRef(filepath).get();
-  if (!file) {
-    return absl::NotFoundError(absl::StrCat("File not found: ", filepath));
+    if (progress_callback_) {
+      progress_callback_({.units_done = 1,
+                          .units_total = 1,
+                          .types_extracted = types_extracted});
+    }
+    return status;
+  });
+}
+
+absl::Status TypeAnalyzer::AnalyzeProject(
+    const std::string& compilation_database, unsigned num_workers) {
+  std::string error;
+  std::unique_ptr<clang::tooling::CompilationDatabase> database;
+  if (llvm::sys::path::extension(compilation_database) == ".json") {
+    database = clang::tooling::JSONCompilationDatabase::loadFromFile(
+        compilation_database, error,
+        clang::tooling::JSONCommandLineSyntax::AutoDetect);
+  } else {
+    database = clang::tooling::CompilationDatabase::loadFromDirectory(
+        compilation_database, error);
+  }
+  if (!database) {
+    return absl::NotFoundError(
+        absl::StrCat("Failed to load compilation database: ", error));
   }
 
-  clang::FileID file_id = source_manager.createFileID(
-      file, clang::SourceLocation(), clang::SrcMgr::C_User);
-  if (file_id.isInvalid()) {
-    return absl::InternalError("Failed to create the clang File ID");
+  const std::vector<clang::tooling::CompileCommand> commands =
+      database->getAllCompileCommands();
+  if (commands.empty()) {
+    return absl::NotFoundError(absl::StrCat(
+        "No compile commands found in: ", compilation_database));
   }
 
-  source_manager.setMainFileID(file_id);
+  std::vector<std::string> files;
+  files.reserve(commands.size());
+  for (const auto& command : commands) {
+    files.push_back(AbsoluteSourcePath(command));
+  }
 
-  compiler->createPreprocessor(clang::TU_Complete);
-  clang::Preprocessor& preprocessor = compiler->getPreprocessor();
+  return AnalyzeForEachTarget([&] {
+    return AnalyzeInParallel(files, num_workers,
+                             [&](TypeAnalyzer& worker, size_t i) {
+                               return worker.AnalyzeCompileCommand(
+                                   commands[i]);
+                             });
+  });
+}
 
-  compiler->createASTContext();
-  clang::ASTContext& ast_context = compiler->getASTContext();
+absl::Status TypeAnalyzer::AnalyzeSourceFiles(
+    const std::vector<std::string>& filepaths, unsigned num_workers) {
+  return AnalyzeForEachTarget([&] {
+    return AnalyzeInParallel(filepaths, num_workers,
+                             [&](TypeAnalyzer& worker, size_t i) {
+                               return worker.AnalyzeFile(filepaths[i]);
+                             });
+  });
+}
 
-  // todo: possibly refactor this into a different reusable method.
+absl::Status TypeAnalyzer::SetTargets(std::vector<std::string> targets) {
+  if (targets.size() > 64) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("At most 64 targets are supported, got ", targets.size()));
+  }
+  if (type_registry_.size() != 0 && targets != type_registry_.targets()) {
+    return absl::FailedPreconditionError(
+        "The analyzer already holds types analyzed for other targets");
+  }
+  targets_ = std::move(targets);
+  return absl::OkStatus();
 }
 
-void TypeAnalyzer::ProcessTranslationUnit(const clang::ASTContext& context) {
-  for (const clang::Decl* decl : context.getTranslationUnitDecl()->decls()) {
+absl::Status TypeAnalyzer::AnalyzeForEachTarget(
+    const std::function<absl::Status()>& analyze) {
+  // Headers may have changed since an earlier analysis of a long-lived
+  // analyzer checked the PCHs over them, or extracted the fragments of them.
+  if (pch_cache_)
+    pch_cache_->Revalidate();
+  if (header_fragments_)
+    header_fragments_->Clear();
+  if (targets_.empty())
+    return analyze();
+
+  // One recording spans all passes; the passes' own ones are then inactive.
+  TimeTraceRecording recording(time_trace_granularity_, time_trace_);
+  TypeRegistry accumulated = std::exchange(type_registry_, TypeRegistry());
+  std::vector<TypeRegistry> per_target;
+  per_target.reserve(targets_.size());
+  absl::Status status;
+  for (const std::string& target : targets_) {
+    if (cancelled())
+      break;
+    target_triple_ = target;
+    status.Update(analyze());
+    per_target.push_back(std::exchange(type_registry_, TypeRegistry()));
+  }
+  target_triple_.clear();
+
+  {
+    PhaseTimer timer(metrics_.merge_seconds, "CombineTargets");
+    TypeRegistry combined = CombineTargets(per_target, targets_);
+    per_target.clear();
+    if (accumulated.size() == 0) {
+      type_registry_ = std::move(combined);
+    } else {
+      type_registry_ = std::move(accumulated);
+      type_registry_.Merge(combined);
+    }
+  }
+  {
+    PhaseTimer timer(metrics_.deduplication_seconds, "DeduplicateTypes");
+    type_conflicts_ = DeduplicateTypes(type_registry_);
+  }
+  return status;
+}
+
+absl::Status TypeAnalyzer::AnalyzeInParallel(
+    const std::vector<std::string>& files, unsigned num_workers,
+    const std::function<absl::Status(TypeAnalyzer&, size_t)>& analyze_unit) {
+  TimeTraceRecording recording(time_trace_granularity_, time_trace_);
+  if (num_workers == 0)
+    num_workers = std::max(1u, std::thread::hardware_concurrency());
+  num_workers = static_cast<unsigned>(
+      std::max<size_t>(1, std::min<size_t>(num_workers, files.size())));
+
+  // Each worker owns an analyzer, so registries and compiler instances are
+  // never shared between threads until the final merge.
+  while (workers_.size() < num_workers) {
+    workers_.emplace_back(compiler_flags_);
+  }
+  for (TypeAnalyzer& worker : workers_) {
+    worker.compiler_flags_ = compiler_flags_;
+    worker.pch_cache_ = pch_cache_;
+    worker.analysis_cache_ = analysis_cache_;
+    worker.source_buffers_ = source_buffers_;
+    worker.target_triple_ = target_triple_;
+    worker.header_fragments_ = header_fragments_;
+    worker.root_filter_ = root_filter_;
+    worker.cancelled_ = cancelled_;
+  }
+
+  std::atomic<size_t> next_unit = 0;
+  std::atomic<size_t> units_done = 0;
+  std::atomic<size_t> types_extracted = 0;
+  std::mutex progress_mutex;
+  auto report = [&](std::string current_file) {
+    if (!progress_callback_)
+      return;
+    std::lock_guard lock(progress_mutex);
+    progress_callback_({.units_done = units_done,
+                        .units_total = files.size(),
+                        .types_extracted = types_extracted,
+                        .current_file = std::move(current_file)});
+  };
+
+  std::mutex failures_mutex;
+  std::vector<std::string> failures;
+  MemoryGate memory_gate(memory_budget_);
+  // Also set when an enclosing AnalyzeForEachTarget is recording.
+  const bool trace_workers = time_trace_granularity_.has_value() &&
+                             llvm::getTimeTraceProfilerInstance() != nullptr;
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(num_workers);
+    for (unsigned w = 0; w < num_workers; ++w) {
+      threads.emplace_back([&, analyzer = &workers_[w]] {
+        // Each thread records its own events, which are merged into the
+        // calling thread's trace once it finishes.
+        if (trace_workers) {
+          llvm::timeTraceProfilerInitialize(*time_trace_granularity_,
+                                            "typesynth worker");
+        }
+        // Registry size as of the last time it was compacted.
+        size_t compacted_size = analyzer->type_registry_.size();
+        for (size_t i = next_unit++; i < files.size() && !cancelled();
+             i = next_unit++) {
+          const uint64_t start_resident = memory_gate.Enter();
+          report(files[i]);
+          const size_t types_before = analyzer->type_registry_.size();
+          absl::Status status = analyze_unit(*analyzer, i);
+          types_extracted += analyzer->type_registry_.size() - types_before;
+          ++units_done;
+          if (!status.ok() && !absl::IsCancelled(status)) {
+            std::lock_guard lock(failures_mutex);
+            failures.emplace_back(status.message());
+          }
+
+          // Near the budget, fold the worker's types whenever they doubled,
+          // which keeps the total work linear. Folding only empties slots, so
+          // the survivors are copied into fresh storage to let go of the
+          // nodes, lists and strings of the rest. What was freed is then
+          // handed back to the system.
+          if (memory_gate.NearBudget()) {
+            if (analyzer->type_registry_.size() >= 2 * compacted_size) {
+              PhaseTimer timer(analyzer->metrics_.deduplication_seconds,
+                               "DeduplicateTypes");
+              DeduplicateTypes(analyzer->type_registry_);
+              TypeRegistry compacted;
+              compacted.Merge(analyzer->type_registry_);
+              analyzer->type_registry_ = std::move(compacted);
+              compacted_size = analyzer->type_registry_.size();
+            }
+            ReleaseFreeMemory();
+          }
+          memory_gate.Leave(start_resident,
+                            analyzer->unit_metrics_.resident_bytes);
+        }
+        // Shrink each registry while still in parallel; most of the
+        // duplication is between translation units of the same worker.
+        {
+          PhaseTimer timer(analyzer->metrics_.deduplication_seconds,
+                           "DeduplicateTypes");
+          DeduplicateTypes(analyzer->type_registry_);
+        }
+        if (trace_workers)
+          llvm::timeTraceProfilerFinishThread();
+      });
+    }
+  }
+
+  for (unsigned w = 0; w < num_workers; ++w) {
+    {
+      PhaseTimer timer(metrics_.merge_seconds, "MergeRegistries");
+      type_registry_.Merge(workers_[w].type_registry_);
+      workers_[w].type_registry_ = TypeRegistry();
+    }
+    metrics_.Add(workers_[w].metrics_);
+    workers_[w].metrics_ = AnalysisMetrics();
+  }
+  {
+    PhaseTimer timer(metrics_.deduplication_seconds, "DeduplicateTypes");
+    type_conflicts_ = DeduplicateTypes(type_registry_);
+  }
+  metrics_.peak_resident_bytes = PeakResidentBytes();
+  report("");
+
+  if (cancelled()) {
+    return absl::CancelledError(absl::StrCat(
+        "Analysis cancelled after ", units_done.load(), " of ", files.size(),
+        " translation units"));
+  }
+  if (!failures.empty()) {
+    return absl::InternalError(absl::StrCat(
+        failures.size(), " of ", files.size(),
+        " translation units failed to analyze. First failure: ",
+        failures.front()));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status TypeAnalyzer::AnalyzeCompileCommand(
+    const clang::tooling::CompileCommand& command) {
+  auto compiler = CreateCompilerInstance(command);
+  if (!compiler.ok())
+    return compiler.status();
+
+  return RunExtraction(**compiler, AbsoluteSourcePath(command));
+}
+
+void TypeAnalyzer::ExtractTypes(const clang::ASTContext& context) {
+  ResetUnitTables();
+  for (const clang::Decl* decl : context.getTranslationUnitDecl()->decls())
     ProcessDeclaration(decl, context);
+  ResetUnitTables();
+}
+
+void TypeAnalyzer::ResetUnitTables() {
+  qual_type_ids_.clear();
+  derived_type_ids_.clear();
+  decl_to_type_id_.clear();
+  types_in_progress_.clear();
+  qualified_name_prefixes_.clear();
+  allowed_files_.clear();
+  reused_fragments_.clear();
+  reused_fragment_keys_.clear();
+  new_fragments_.clear();
+}
+
+void TypeAnalyzer::ProcessHeaderDeclaration(uint64_t key,
+                                            const clang::Decl* decl,
+                                            const clang::ASTContext& context) {
+  if (reused_fragment_keys_.contains(key))
+    return;
+  auto it = new_fragments_.find(key);
+  if (it == new_fragments_.end()) {
+    // The first declaration of the header decides for all of them.
+    if (std::shared_ptr<const TypeRegistry> fragment =
+            header_fragments_->Find(key)) {
+      ++metrics_.header_fragment_hits;
+      reused_fragments_.push_back(std::move(fragment));
+      reused_fragment_keys_.insert(key);
+      return;
+    }
+    ++metrics_.header_fragment_misses;
+    it = new_fragments_.insert({key, {}}).first;
+  }
+  ProcessDeclaration(decl, context);
+  CollectDeclarationRoots(decl, it->second);
+}
+
+void TypeAnalyzer::DiscardHeaderFragment(uint64_t key) {
+  new_fragments_.erase(key);
+}
+
+void TypeAnalyzer::CollectDeclarationRoots(const clang::Decl* declaration,
+                                           std::vector<TypeId>& roots) const {
+  // Mirrors the declarations ProcessDeclaration descends into.
+  if (const auto* context = llvm::dyn_cast<clang::DeclContext>(declaration);
+      context && (llvm::isa<clang::NamespaceDecl>(declaration) ||
+                  llvm::isa<clang::LinkageSpecDecl>(declaration))) {
+    for (const clang::Decl* inner : context->decls())
+      CollectDeclarationRoots(inner, roots);
+    return;
+  }
+  if (auto it = decl_to_type_id_.find(declaration->getCanonicalDecl());
+      it != decl_to_type_id_.end()) {
+    roots.push_back(it->second);
+  }
+}
+
+void TypeAnalyzer::FinishHeaderFragments(TypeRegistry& extracted,
+                                         bool share) {
+  if (share) {
+    for (const auto& [key, roots] : new_fragments_) {
+      TypeRegistry fragment;
+      fragment.MergeReachable(extracted, roots);
+      header_fragments_->Insert(key, std::move(fragment));
+    }
+  }
+  for (const auto& fragment : reused_fragments_)
+    extracted.Merge(*fragment);
+  reused_fragments_.clear();
+  reused_fragment_keys_.clear();
+  new_fragments_.clear();
+}
+
+absl::Status TypeAnalyzer::AnalyzeFile(const std::string& filepath) {
+  auto compiler = CreateCompilerInstance();
+  return RunExtraction(*compiler, filepath);
+}
+
+absl::Status TypeAnalyzer::RunExtraction(clang::CompilerInstance& compiler,
+                                         const std::string& filepath) {
+  unit_metrics_ = UnitMetrics{.file = filepath};
+  absl::Status status;
+  {
+    PhaseTimer timer(unit_metrics_.seconds, "AnalyzeTranslationUnit",
+                     filepath);
+    status = ExtractTranslationUnit(compiler, filepath);
+  }
+  metrics_.Add(unit_metrics_);
+  return status;
+}
+
+absl::Status TypeAnalyzer::ExtractTranslationUnit(
+    clang::CompilerInstance& compiler, const std::string& filepath) {
+  // Reuse the file manager of earlier translation units unless relative paths
+  // resolve against a different directory now, and make sure the source file
+  // is reachable before committing to a parse.
+  if (file_manager_ && file_manager_->getFileSystemOpts().WorkingDir ==
+                           compiler.getFileSystemOpts().WorkingDir) {
+    compiler.setFileManager(file_manager_.get());
+  } else {
+    file_manager_ =
+        compiler.createFileManager(CreateFileSystem(compiler, source_buffers_));
+  }
+  if (!compiler.getFileManager().getOptionalFileRef(filepath)) {
+    return absl::NotFoundError(absl::StrCat("File not found: ", filepath));
+  }
+
+  clang::FrontendOptions& frontend_opts = compiler.getFrontendOpts();
+  clang::InputKind input_kind = frontend_opts.DashX;
+  if (input_kind.isUnknown()) {
+    input_kind = clang::FrontendOptions::getInputKindForExtension(
+        llvm::sys::path::extension(filepath).drop_front());
+  }
+  frontend_opts.Inputs.clear();
+  frontend_opts.Inputs.emplace_back(filepath, input_kind);
+  // Only declarations matter, so function bodies are neither parsed nor
+  // semantically analyzed. Set before the cache key is computed, which
+  // covers the frontend options.
+  frontend_opts.SkipFunctionBodies = true;
+  // Compile commands from the driver ask clang to leak the AST at exit, which
+  // a process analyzing many translation units cannot afford.
+  frontend_opts.DisableFree = false;
+
+  if (cancelled()) {
+    return absl::CancelledError(
+        absl::StrCat("Analysis cancelled before: ", filepath));
+  }
+
+  // Translation units whose inputs are all unchanged since they were last
+  // analyzed are served from the cache without running clang at all.
+  llvm::vfs::FileSystem& file_system =
+      compiler.getFileManager().getVirtualFileSystem();
+  std::optional<uint64_t> cache_key;
+  if (analysis_cache_) {
+    PhaseTimer timer(metrics_.analysis_cache_seconds, "LookupAnalysisCache");
+    absl::StatusOr<uint64_t> key = analysis_cache_->KeyFor(
+        compiler.getInvocation(), compiler.getFileManager(), filepath);
+    if (key.ok()) {
+      // Filtered analyses extract less, and are cached apart.
+      cache_key = *key;
+      if (root_filter_)
+        cache_key = HashBuilder().Add(*key).Add(root_filter_->hash()).value();
+      if (std::optional<TypeRegistry> cached =
+              analysis_cache_->Lookup(*cache_key, file_system)) {
+        ++metrics_.analysis_cache_hits;
+        unit_metrics_.cache_hit = true;
+        unit_metrics_.types_created = cached->size();
+        type_registry_.Merge(*cached);
+        return absl::OkStatus();
+      }
+    }
+    ++metrics_.analysis_cache_misses;
+  }
+
+  // Load the system headers this file opens with from a precompiled header
+  // when one can be built; the parse only has to cover the rest. Without one,
+  // the analysis simply parses everything.
+  if (pch_cache_) {
+    PhaseTimer timer(metrics_.pch_seconds, "PrecompiledHeader");
+    absl::StatusOr<std::string> pch = pch_cache_->GetOrBuild(
+        compiler.getInvocation(), compiler.getFileManager(), filepath);
+    if (pch.ok()) {
+      compiler.getPreprocessorOpts().ImplicitPCHInclude = *pch;
+      // Tolerate headers that were touched but not changed since the build.
+      compiler.getHeaderSearchOpts().ValidateASTInputFilesContent = true;
+    }
+  }
+
+  ResetUnitTables();
+
+  auto dependencies = std::make_shared<SourceDependencyCollector>();
+  compiler.addDependencyCollector(dependencies);
+
+  // Extract into an empty registry so this translation unit's types can be
+  // cached on their own, then fold them into the accumulated ones.
+  TypeRegistry accumulated = std::exchange(type_registry_, TypeRegistry());
+  const bool share_headers = header_fragments_ && !root_filter_;
+  ExtractionAction action(*this, share_headers);
+  double execute_seconds = 0;
+  bool succeeded = false;
+  {
+    PhaseTimer timer(execute_seconds, "ParseAndExtract", filepath);
+    succeeded = compiler.ExecuteAction(action);
+    // Clang refuses a PCH over a header that changed after it was validated,
+    // before anything is parsed. Parse without it then, and have it rebuilt
+    // for later analyses.
+    std::string& pch = compiler.getPreprocessorOpts().ImplicitPCHInclude;
+    if (!action.began_parsing() && !pch.empty()) {
+      pch_cache_->Invalidate(pch);
+      pch.clear();
+      ExtractionAction retry(*this, share_headers);
+      succeeded = compiler.ExecuteAction(retry);
+    }
+  }
+  TypeRegistry extracted =
+      std::exchange(type_registry_, std::move(accumulated));
+  unit_metrics_.frontend_seconds =
+      execute_seconds - unit_metrics_.extraction_seconds;
+  unit_metrics_.types_created = extracted.size();
+
+  // Fragments only come from clean, complete analyses, which is also what
+  // makes the ones reused here complete. Merging them in keeps this
+  // translation unit's types self-contained for the analysis cache.
+  if (header_fragments_) {
+    PhaseTimer timer(metrics_.merge_seconds, "MergeHeaderFragments");
+    FinishHeaderFragments(extracted, succeeded && !cancelled());
   }
+
+  // Only clean, complete analyses are cached: a missing header is an error,
+  // and would not show up as a dependency that could later invalidate the
+  // entry.
+  if (succeeded && !cancelled() && cache_key) {
+    PhaseTimer timer(metrics_.analysis_cache_seconds, "StoreAnalysisCache");
+    analysis_cache_->Store(*cache_key, extracted,
+                           dependencies->getDependencies(), file_system)
+        .IgnoreError();
+  }
+
+  // Types extracted before an error are kept in the registry.
+  if (type_registry_.size() == 0) {
+    type_registry_ = std::move(extracted);
+  } else {
+    PhaseTimer timer(metrics_.merge_seconds, "MergeRegistries");
+    type_registry_.Merge(extracted);
+  }
+
+  if (cancelled()) {
+    return absl::CancelledError(
+        absl::StrCat("Analysis cancelled while analyzing: ", filepath));
+  }
+  if (!succeeded) {
+    return absl::InternalError(
+        absl::StrCat("Clang reported errors while analyzing: ", filepath));
+  }
+  return absl::OkStatus();
 }
 
 void TypeAnalyzer::ProcessDeclaration(const clang::Decl* declaration,
@@ -79,6 +884,7 @@ void TypeAnalyzer::ProcessDeclaration(const clang::Decl* declaration,
   //  * Unions
   //  * Functions
   //  * Structs
+  //  * Enums
   //  * Typedefs
   //  * Objective-C Classes
 
@@ -88,14 +894,25 @@ void TypeAnalyzer::ProcessDeclaration(const clang::Decl* declaration,
   if (!declaration)
     return;
 
+  // Only roots are extracted here; what they refer to is extracted as it is
+  // reached through IDForQualType, or completed here once its definition
+  // follows the reference. Namespaces are descended into below.
+  if (root_filter_ &&
+      !llvm::isa<clang::NamespaceDecl, clang::LinkageSpecDecl>(declaration) &&
+      !IsExtractionRoot(*declaration, context) &&
+      !DefinesIncompleteType(*declaration))
+    return;
+
   switch (declaration->getKind()) {
-    case clang::Decl::Record: {
+    case clang::Decl::Record:
+    case clang::Decl::CXXRecord: {
       // Includes: Structs and unions.
       auto record_decl = llvm::dyn_cast<clang::RecordDecl>(declaration);
       if (!record_decl)
         break;
 
-      if (record_decl->isStruct() || record_decl->isUnion()) {
+      if (record_decl->isStruct() || record_decl->isClass() ||
+          record_decl->isUnion()) {
         ProcessRecordDecl(*record_decl, context);
       }
       break;
@@ -116,8 +933,9 @@ void TypeAnalyzer::ProcessDeclaration(const clang::Decl* declaration,
       ProcessEnumDecl(*enum_decl, context);
       break;
     }
-    case clang::Decl::Typedef: {
-      auto typedef_decl = llvm::dyn_cast<clang::TypedefDecl>(declaration);
+    case clang::Decl::Typedef:
+    case clang::Decl::TypeAlias: {
+      auto typedef_decl = llvm::dyn_cast<clang::TypedefNameDecl>(declaration);
       if (!typedef_decl)
         break;
 
@@ -143,130 +961,433 @@ void TypeAnalyzer::ProcessDeclaration(const clang::Decl* declaration,
       }
       break;
     }
+    case clang::Decl::LinkageSpec: {
+      // Handle: extern "C" { ... } blocks, common in C headers.
+      auto linkage_decl = llvm::dyn_cast<clang::LinkageSpecDecl>(declaration);
+      if (!linkage_decl)
+        break;
+
+      for (auto inner_decl : linkage_decl->decls()) {
+        ProcessDeclaration(inner_decl, context);
+      }
+      break;
+    }
     default:
       break;
   }
 }
 
+bool TypeAnalyzer::IsExtractionRoot(const clang::Decl& declaration,
+                                    const clang::ASTContext& context) {
+  const clang::SourceManager& source_manager = context.getSourceManager();
+  if (root_filter_->has_file_globs() &&
+      IsFileAllowed(source_manager.getFileID(source_manager.getExpansionLoc(
+                        declaration.getLocation())),
+                    source_manager)) {
+    return true;
+  }
+  if (!root_filter_->has_roots())
+    return false;
+
+  // The qualified name is only built for declarations whose own name could
+  // match.
+  const auto* named = llvm::dyn_cast<clang::NamedDecl>(&declaration);
+  const clang::IdentifierInfo* identifier =
+      named ? named->getIdentifier() : nullptr;
+  return identifier && root_filter_->MayBeRoot(identifier->getName()) &&
+         root_filter_->IsRoot(FullyQualifiedDeclName(declaration, context));
+}
+
+bool TypeAnalyzer::IsFileAllowed(clang::FileID file,
+                                 const clang::SourceManager& source_manager) {
+  auto [it, inserted] = allowed_files_.try_emplace(file.getHashValue(), false);
+  if (inserted) {
+    if (clang::OptionalFileEntryRef entry =
+            source_manager.getFileEntryRefForID(file)) {
+      it->second = root_filter_->IsFileAllowed(entry->getName());
+    }
+  }
+  return it->second;
+}
+
+bool TypeAnalyzer::SkipsFile(clang::FileID file,
+                             const clang::SourceManager& source_manager) {
+  return root_filter_ && !root_filter_->has_roots() &&
+         !IsFileAllowed(file, source_manager);
+}
+
 void TypeAnalyzer::ProcessRecordDecl(const clang::RecordDecl& record_decl,
                                      const clang::ASTContext& context) {
+  // Declarations are processed as they are parsed, so a record may first be
+  // seen before its definition and is then revisited once that arrives.
+  const TypeId type_id = GetOrCreateTypeId(record_decl);
+  if (IsTypeProcessed(type_id) &&
+      !(IsIncompleteType(type_id) && record_decl.getDefinition()))
+    return;
+
+  // Prefer the definition wherever the record was referenced from; records
+  // without a usable one are emitted as opaque, incomplete types.
+  const clang::RecordDecl* definition = record_decl.getDefinition();
+  if (definition &&
+      (definition->isInvalidDecl() || definition->isDependentType())) {
+    definition = nullptr;
+  }
+  const clang::RecordDecl& decl = definition ? *definition : record_decl;
 
-  bool is_packed = IsRecordPacked(record_decl);
-  bool is_anon = record_decl.isAnonymousStructOrUnion();
+  bool is_packed = IsRecordPacked(decl);
+  bool is_anon = decl.isAnonymousStructOrUnion();
 
   // when we encounter an inline/anonymous structure declaration, model it as
   // though it is both: a declaration and subsequent usage.
 
-  // Record each field while incrementing the bit width counter to use for
-  //  the offset_bits value.
-  uint32_t off_bits_ctr = 0;
+  // Mark the record as in progress so that self-referential fields (through
+  // pointers) resolve to this id instead of recursing.
+  types_in_progress_.insert(type_id);
+
   std::vector<models::RecordField> fields;
-  for (auto field : record_decl.fields()) {
-    auto entry = models::RecordField{
-        .name = field->getNameAsString(),
-        .type = IDForQualType(field->getType(),
-                              context),
-        .offset_bits = off_bits_ctr};
-    fields.push_back(entry);
-    off_bits_ctr += field->getBitWidthValue();
-  }
-
-  if (record_decl.isStruct()) {
-    auto node = models::StructDecl{
-        next_type_id_,
-        NodeKind::kStructDeclaration,
-        .name = NameForRecordDecl(record_decl),
-        .qualified_name = FullyQualifiedDeclName(record_decl, context),
-        .fields = fields,
-        .is_packed = is_packed,
-        .is_anonymous = is_anon};
-    // todo: push to type registry
-  } else if (record_decl.isUnion()) {
-    auto node = models::UnionDecl{
-        next_type_id_,
-        NodeKind::kUnionDeclaration,
-        .name = NameForRecordDecl(record_decl),
-        .qualified_name = FullyQualifiedDeclName(record_decl, context),
-        .fields = fields,
-        .is_packed = is_packed,
-        .is_anonymous = is_anon};
-    // todo: push to type registry
+  uint32_t size_bytes = 0;
+  if (definition) {
+    const clang::ASTRecordLayout& layout =
+        context.getASTRecordLayout(definition);
+    size_bytes = layout.getSize().getQuantity();
+
+    for (auto field : definition->fields()) {
+      auto entry = models::RecordField{
+          .name = type_registry_.Intern(field->getName()),
+          .type = IDForQualType(field->getType(), context),
+          .offset_bits = static_cast<uint32_t>(
+              layout.getFieldOffset(field->getFieldIndex())),
+          .bit_width = field->isBitField() ? field->getBitWidthValue() : 0};
+      fields.push_back(entry);
+    }
+  }
+
+  types_in_progress_.erase(type_id);
+
+  const StringId name = type_registry_.Intern(NameForRecordDecl(decl));
+  const StringId qualified_name =
+      type_registry_.Intern(FullyQualifiedDeclName(decl, context));
+  const auto field_list =
+      type_registry_.AddList(std::span<const models::RecordField>(fields));
+  if (decl.isUnion()) {
+    type_registry_.Insert(type_id,
+                          models::UnionDecl{
+                              .name = name,
+                              .qualified_name = qualified_name,
+                              .fields = field_list,
+                              .size_bytes = size_bytes,
+                              .is_packed = is_packed,
+                              .is_anonymous = is_anon,
+                              .is_complete = definition != nullptr});
+  } else {
+    type_registry_.Insert(type_id,
+                          models::StructDecl{
+                              .name = name,
+                              .qualified_name = qualified_name,
+                              .fields = field_list,
+                              .size_bytes = size_bytes,
+                              .is_packed = is_packed,
+                              .is_anonymous = is_anon,
+                              .is_complete = definition != nullptr});
+  }
+}
+
+void TypeAnalyzer::ProcessEnumDecl(const clang::EnumDecl& enum_decl,
+                                   const clang::ASTContext& context) {
+  const TypeId type_id = GetOrCreateTypeId(enum_decl);
+  if (IsTypeProcessed(type_id) &&
+      !(IsIncompleteType(type_id) && enum_decl.getDefinition()))
+    return;
+
+  const clang::EnumDecl* definition = enum_decl.getDefinition();
+  const clang::EnumDecl& decl = definition ? *definition : enum_decl;
+
+  types_in_progress_.insert(type_id);
+
+  std::vector<models::EnumConstant> constants;
+  for (const auto* enumerator : decl.enumerators()) {
+    constants.push_back(models::EnumConstant{
+        .name = type_registry_.Intern(enumerator->getName()),
+        .value = enumerator->getInitVal().isSigned()
+                     ? enumerator->getInitVal().getSExtValue()
+                     : static_cast<int64_t>(
+                           enumerator->getInitVal().getZExtValue())});
+  }
+
+  // Enums without a fixed underlying type have none until they are defined.
+  clang::QualType integer_type = decl.getIntegerType();
+  TypeId underlying = kInvalidTypeId;
+  uint32_t size_bytes = 0;
+  if (!integer_type.isNull()) {
+    underlying = IDForQualType(integer_type, context);
+    size_bytes = context.getTypeSizeInChars(integer_type).getQuantity();
   }
+
+  types_in_progress_.erase(type_id);
+
+  type_registry_.Insert(
+      type_id,
+      models::EnumDecl{
+          .name = type_registry_.Intern(decl.getName()),
+          .qualified_name =
+              type_registry_.Intern(FullyQualifiedDeclName(decl, context)),
+          .underlying = underlying,
+          .constants = type_registry_.AddList(
+              std::span<const models::EnumConstant>(constants)),
+          .size_bytes = size_bytes,
+          .is_anonymous = decl.getName().empty()});
+}
+
+void TypeAnalyzer::ProcessFunctionDecl(const clang::FunctionDecl& function_decl,
+                                       const clang::ASTContext& context) {
+  // Templates have no concrete prototype to extract.
+  if (function_decl.isTemplated() || function_decl.isDependentContext())
+    return;
+
+  const TypeId type_id = GetOrCreateTypeId(function_decl);
+  if (IsTypeProcessed(type_id))
+    return;
+
+  std::vector<StringId> param_names;
+  param_names.reserve(function_decl.getNumParams());
+  for (const auto* param : function_decl.parameters()) {
+    param_names.push_back(type_registry_.Intern(param->getName()));
+  }
+
+  const TypeId prototype = IDForQualType(function_decl.getType(), context);
+  type_registry_.Insert(
+      type_id,
+      models::FunctionDecl{
+          .name = type_registry_.Intern(function_decl.getNameAsString()),
+          .qualified_name = type_registry_.Intern(
+              FullyQualifiedDeclName(function_decl, context)),
+          .type = prototype,
+          .param_names = type_registry_.AddList(
+              std::span<const StringId>(param_names))});
+}
+
+void TypeAnalyzer::ProcessTypedefDecl(const clang::TypedefNameDecl& typedef_decl,
+                                      const clang::ASTContext& context) {
+  if (typedef_decl.getUnderlyingType()->isDependentType())
+    return;
+
+  const TypeId type_id = GetOrCreateTypeId(typedef_decl);
+  if (IsTypeProcessed(type_id))
+    return;
+
+  types_in_progress_.insert(type_id);
+  TypeId underlying = IDForQualType(typedef_decl.getUnderlyingType(), context);
+  types_in_progress_.erase(type_id);
+
+  type_registry_.Insert(
+      type_id,
+      models::TypedefDecl{
+          .name = type_registry_.Intern(typedef_decl.getName()),
+          .qualified_name = type_registry_.Intern(
+              FullyQualifiedDeclName(typedef_decl, context)),
+          .underlying = underlying});
+}
+
+void TypeAnalyzer::ProcessObjCInterfaceDecl(
+    const clang::ObjCInterfaceDecl& interface_decl,
+    const clang::ASTContext& context) {
+  // Interfaces are modelled as the structs their instances are laid out as.
+  // Only the interface's own ivars are listed; the superclass's precede them
+  // and are covered by the offsets.
+  const TypeId type_id = GetOrCreateTypeId(interface_decl);
+  if (IsTypeProcessed(type_id) &&
+      !(IsIncompleteType(type_id) && interface_decl.getDefinition()))
+    return;
+
+  const clang::ObjCInterfaceDecl* definition = interface_decl.getDefinition();
+  if (definition && definition->isInvalidDecl()) {
+    definition = nullptr;
+  }
+  const clang::ObjCInterfaceDecl& decl =
+      definition ? *definition : interface_decl;
+
+  types_in_progress_.insert(type_id);
+
+  std::vector<models::RecordField> fields;
+  uint32_t size_bytes = 0;
+  if (definition) {
+    const clang::ASTRecordLayout& layout =
+        context.getASTObjCInterfaceLayout(definition);
+    size_bytes = layout.getSize().getQuantity();
+
+    // The layout's field offsets follow the order of all declared ivars,
+    // including those from extensions and the implementation.
+    unsigned field_index = 0;
+    for (const clang::ObjCIvarDecl* ivar =
+             const_cast<clang::ObjCInterfaceDecl*>(definition)
+                 ->all_declared_ivar_begin();
+         ivar; ivar = ivar->getNextIvar(), ++field_index) {
+      fields.push_back(models::RecordField{
+          .name = type_registry_.Intern(ivar->getName()),
+          .type = IDForQualType(ivar->getType(), context),
+          .offset_bits =
+              static_cast<uint32_t>(layout.getFieldOffset(field_index)),
+          .bit_width = ivar->isBitField() ? ivar->getBitWidthValue() : 0});
+    }
+  }
+
+  types_in_progress_.erase(type_id);
+
+  type_registry_.Insert(
+      type_id,
+      models::StructDecl{
+          .name = type_registry_.Intern(decl.getName()),
+          .qualified_name =
+              type_registry_.Intern(FullyQualifiedDeclName(decl, context)),
+          .fields = type_registry_.AddList(
+              std::span<const models::RecordField>(fields)),
+          .size_bytes = size_bytes,
+          .is_packed = false,
+          .is_anonymous = false,
+          .is_complete = definition != nullptr});
 }
 
 TypeId TypeAnalyzer::IDForQualType(const clang::QualType& qual_type,
                                    const clang::ASTContext& context) {
 
-  // Check if a matching node is in our cache.
-  clang::PrintingPolicy policy(context.getLangOpts());
-  policy.adjustForCPlusPlus();
-  std::string type_as_string = qual_type.getAsString(policy);
-  if (string_to_type_id_.contains(type_as_string)) {
-    return string_to_type_id_[type_as_string];
-  }
-
-  TypeId next = next_type_id_++;
-
-  if (qual_type->isBuiltinType()) {
-    auto node = models::Primitive{
-        next,
-        NodeKind::kPrimitive,
-        type_as_string,
-    };
-    // todo: push to type registry
-  } else if (qual_type->isPointerType()) {
-    clang::QualType inner = qual_type->getPointeeType();
-    auto node = models::Pointer{next, NodeKind::kPointer,
-                                .inner = IDForQualType(inner, context)};
-    // todo: push to type registry
-  } else if (qual_type->isReferenceType()) {
-    clang::QualType inner = qual_type.getNonReferenceType();
-    auto node = models::Reference{next, NodeKind::kReference,
-                                  .inner = IDForQualType(inner, context)};
-    // todo: push to type registry
-  } else if (qual_type->isFunctionType()) {
-    const auto* fn_proto = llvm::cast<clang::FunctionProtoType>(qual_type);
-
-    TypeId ret_type_id = IDForQualType(fn_proto->getReturnType(), context);
-    bool is_variadic = fn_proto->isVariadic();
+  // Check if a matching node is in our cache. The ASTContext uniques types,
+  // so the opaque pointer (which also encodes qualifiers) identifies a type
+  // exactly without printing it. Canonical types are deliberately not used:
+  // they would erase typedefs.
+  const void* key = qual_type.getAsOpaquePtr();
+  if (auto it = qual_type_ids_.find(key); it != qual_type_ids_.end()) {
+    ++metrics_.type_id_cache_hits;
+    return it->second;
+  }
+  ++metrics_.type_id_cache_misses;
+
+  // Qualifiers and elaborated keywords (`struct Foo`, `ns::Foo`) don't change
+  // the shape of a type, and any other sugar that isn't a symbolic reference
+  // (parentheses, attributes, template specializations, ...) is peeled one
+  // layer at a time.
+  clang::QualType type = qual_type.getUnqualifiedType();
+  if (const auto* elaborated =
+          llvm::dyn_cast<clang::ElaboratedType>(type.getTypePtr())) {
+    type = elaborated->getNamedType();
+  } else if (!IsSymbolicReference(type) && type->isSugared()) {
+    type = type.getSingleStepDesugaredType(context);
+  }
+
+  TypeId type_id = kInvalidTypeId;
+  if (type != qual_type) {
+    type_id = IDForQualType(type, context);
+  } else if (IsSymbolicReference(type)) {
+    // Handle declared identifiers.
+    const clang::Decl* decl = nullptr;
+    if (const auto* typedef_type = type->getAs<clang::TypedefType>()) {
+      decl = typedef_type->getDecl();
+    } else {
+      decl = type->getAsTagDecl();
+    }
 
+    // Make sure the referenced declaration itself ends up in the registry,
+    // even when it isn't reachable from the top-level declarations (nested
+    // records, template specializations, ...).
+    TypeId referenced = GetOrCreateTypeId(*decl);
+    if (!IsTypeProcessed(referenced)) {
+      if (const auto* record_decl = llvm::dyn_cast<clang::RecordDecl>(decl)) {
+        ProcessRecordDecl(*record_decl, context);
+      } else if (const auto* enum_decl =
+                     llvm::dyn_cast<clang::EnumDecl>(decl)) {
+        ProcessEnumDecl(*enum_decl, context);
+      } else if (const auto* typedef_decl =
+                     llvm::dyn_cast<clang::TypedefNameDecl>(decl)) {
+        ProcessTypedefDecl(*typedef_decl, context);
+      }
+    }
+
+    type_id =
+        InternDerivedType(models::SymbolicReference{.inner = referenced});
+  } else if (type->isPointerType()) {
+    clang::QualType inner = type->getPointeeType();
+    type_id = InternDerivedType(
+        models::Pointer{.inner = IDForQualType(inner, context)});
+  } else if (type->isReferenceType()) {
+    clang::QualType inner = type.getNonReferenceType();
+    type_id = InternDerivedType(
+        models::Reference{.inner = IDForQualType(inner, context)});
+  } else if (const auto* fn_type = type->getAs<clang::FunctionType>()) {
+    TypeId ret_type_id = IDForQualType(fn_type->getReturnType(), context);
+
+    // Unprototyped C functions (`int f()`) accept anything.
+    bool is_variadic = true;
     std::vector<models::FunctionArgument> args;
 
-    for (const auto arg : fn_proto->getParamTypes()) {
-      args.push_back(models::FunctionArgument {
-        .name = "",
-        .type = IDForQualType(arg, context)
-      });
+    if (const auto* fn_proto =
+            llvm::dyn_cast<clang::FunctionProtoType>(fn_type)) {
+      is_variadic = fn_proto->isVariadic();
+      args.reserve(fn_proto->getNumParams());
+      for (const auto arg : fn_proto->getParamTypes()) {
+        args.push_back(models::FunctionArgument{
+            .name = kEmptyStringId, .type = IDForQualType(arg, context)});
+      }
     }
 
-    auto node = models::Function{
-      next,
-      NodeKind::kFunction,
-      .args = args,
-      .is_variadic = is_variadic
-    };
-    // todo: push to type registry
-  } else if (IsSymbolicReference(qual_type)) {
-    // Handle declared identifiers.
+    type_id = InternDerivedType(
+        models::Function{.ret_type = ret_type_id, .is_variadic = is_variadic},
+        args);
+  } else {
+    // Builtins, and anything else we don't model structurally yet (arrays,
+    // vectors, member pointers, ...), are recorded as named primitives. This
+    // is the only place a type's name has to be printed.
+    clang::PrintingPolicy policy(context.getLangOpts());
+    policy.adjustForCPlusPlus();
+
+    uint32_t size_bits = 0;
+    if (!type->isIncompleteType() && !type->isDependentType() &&
+        !type->isSizelessType()) {
+      size_bits = context.getTypeSize(type);
+    }
+
+    type_id = type_registry_.NewId();
+    type_registry_.Insert(
+        type_id,
+        models::Primitive{
+            .primitive = type_registry_.Intern(type.getAsString(policy)),
+            .size_bits = size_bits,
+            .is_signed = type->isSignedIntegerType()});
+  }
+
+  qual_type_ids_.emplace(key, type_id);
+  return type_id;
+}
 
-    // fixme: bad idea to do just this.
-    TypeId referenced = string_to_type_id_[type_as_string];
+template <typename T>
+TypeId TypeAnalyzer::InternDerivedType(
+    T node, std::span<const models::FunctionArgument> args) {
+  // Derived nodes are fully described by their kind and the ids they refer
+  // to, so equal ones are shared rather than created per spelling.
+  std::vector<TypeId> key = {static_cast<TypeId>(models::kKindOf<T>)};
+  if constexpr (std::is_same_v<T, models::Function>) {
+    key.push_back(node.ret_type);
+    for (const auto& arg : args)
+      key.push_back(arg.type);
+    key.push_back(node.is_variadic);
+  } else {
+    key.push_back(node.inner);
+  }
 
-    auto node = models::SymbolicReference {
-      next,
-      NodeKind::kSymbolicReference,
-      .inner = referenced
-    };
-    // todo: push to type registry
+  auto [it, inserted] =
+      derived_type_ids_.try_emplace(std::move(key), kInvalidTypeId);
+  if (inserted) {
+    if constexpr (std::is_same_v<T, models::Function>)
+      node.args = type_registry_.AddList(args);
+    it->second = type_registry_.NewId();
+    type_registry_.Insert(it->second, node);
   }
+  return it->second;
 }
 
 bool TypeAnalyzer::IsSymbolicReference(const clang::QualType& qual_type) {
-
-  return qual_type->isTypedefNameType() ||
-         qual_type->getAsRecordDecl() != nullptr ||
-         qual_type->getAs<clang::EnumType>() != nullptr ||
-         qual_type->getAs<clang::ElaboratedType>() != nullptr;
+  // Only the outermost layer counts: a typedef of a pointer is a reference to
+  // the typedef, not a pointer.
+  return llvm::isa<clang::TypedefType, clang::RecordType, clang::EnumType>(
+      qual_type.getTypePtr());
 }
 
 bool TypeAnalyzer::IsRecordPacked(const clang::RecordDecl& record_decl) {
@@ -288,7 +1409,29 @@ bool TypeAnalyzer::IsRecordPacked(const clang::RecordDecl& record_decl) {
 }
 
 bool TypeAnalyzer::IsTypeProcessed(TypeId type_id) const {
-  return type_registry_.contains(type_id);
+  return type_registry_.Contains(type_id) ||
+         types_in_progress_.contains(type_id);
+}
+
+bool TypeAnalyzer::IsIncompleteType(TypeId type_id) const {
+  if (types_in_progress_.contains(type_id))
+    return false;
+  if (const auto* struct_decl = type_registry_.Get<models::StructDecl>(type_id))
+    return !struct_decl->is_complete;
+  if (const auto* union_decl = type_registry_.Get<models::UnionDecl>(type_id))
+    return !union_decl->is_complete;
+  if (const auto* enum_decl = type_registry_.Get<models::EnumDecl>(type_id))
+    return enum_decl->constants.size == 0;
+  return false;
+}
+
+bool TypeAnalyzer::DefinesIncompleteType(
+    const clang::Decl& declaration) const {
+  const auto* tag = llvm::dyn_cast<clang::TagDecl>(&declaration);
+  if (!tag || !tag->isThisDeclarationADefinition())
+    return false;
+  auto it = decl_to_type_id_.find(tag->getCanonicalDecl());
+  return it != decl_to_type_id_.end() && IsIncompleteType(it->second);
 }
 
 std::string TypeAnalyzer::FullyQualifiedDeclName(
@@ -297,47 +1440,54 @@ std::string TypeAnalyzer::FullyQualifiedDeclName(
   // todo: consider refactoring to return an error status if the declaration is
   //  anonymous.
 
-  // To determine the fully-qualified identifier of a declaration,
-  // we are going to recurse and record the identifiers of each of its
-  // lexical contexts until we reach the translation unit.
+  const std::string& prefix = QualifiedNamePrefix(declaration.getDeclContext());
 
-  const clang::DeclContext* ctx = declaration.getDeclContext();
-  std::vector<std::string> name_stack;
-
-  while (ctx && !llvm::isa<clang::TranslationUnitDecl>(ctx)) {
-    if (llvm::isa<clang::NamespaceDecl>(ctx)) {
-      // Handle: namespaces
-      const auto* ns = llvm::cast<clang::NamespaceDecl>(ctx);
-      if (ns->isAnonymousNamespace()) {
-        name_stack.emplace_back("(anonymous namespace)");
-      } else {
-        std::string ns_name = ns->getNameAsString();
-        name_stack.push_back(ns_name);
-      }
-    } else if (llvm::isa<clang::RecordDecl>(ctx)) {
-      // Handle: structs, unions
-      const auto* record = llvm::cast<clang::RecordDecl>(ctx);
-      name_stack.push_back(NameForRecordDecl(*record));
-    }
-    ctx = ctx->getLexicalParent();
+  // Now, determine if this is a named declaration, and if so, append it to
+  // its context's prefix.
+  const auto* named_decl = llvm::dyn_cast<clang::NamedDecl>(&declaration);
+  if (!named_decl) {
+    // Without a name of its own, the declaration is named by its context.
+    return prefix.empty() ? std::string()
+                          : prefix.substr(0, prefix.size() - 2);
   }
 
-  std::ranges::reverse(name_stack);
-
-  // Now, determine if this is a named declaration, and if so, append it to our
-  // final result.
+  std::string name = named_decl->getNameAsString();
+  if (name.empty())
+    return "";
+  return prefix + name;
+}
 
-  if (const auto* named_decl = llvm::dyn_cast<clang::NamedDecl>(&declaration)) {
-    std::string name = named_decl->getNameAsString();
-    if (name.empty())
-      return "";
+const std::string& TypeAnalyzer::QualifiedNamePrefix(
+    const clang::DeclContext* ctx) {
+  static const std::string kNoPrefix;
+  if (!ctx || llvm::isa<clang::TranslationUnitDecl>(ctx))
+    return kNoPrefix;
 
-    name_stack.push_back(name);
+  if (auto it = qualified_name_prefixes_.find(ctx);
+      it != qualified_name_prefixes_.end()) {
+    return it->second;
   }
 
-  std::string fq_name = llvm::join(name_stack.begin(), name_stack.end(), "::");
+  // Copied, since inserting below may move the parent's entry. Contexts other
+  // than namespaces and records (linkage specs, functions, ...) don't
+  // contribute a component of their own.
+  std::string prefix = QualifiedNamePrefix(ctx->getLexicalParent());
+  if (const auto* ns = llvm::dyn_cast<clang::NamespaceDecl>(ctx)) {
+    // Handle: namespaces
+    if (ns->isAnonymousNamespace()) {
+      prefix += "(anonymous namespace)";
+    } else {
+      prefix += ns->getName();
+    }
+    prefix += "::";
+  } else if (const auto* record = llvm::dyn_cast<clang::RecordDecl>(ctx)) {
+    // Handle: structs, unions
+    prefix += NameForRecordDecl(*record);
+    prefix += "::";
+  }
 
-  return fq_name;
+  return qualified_name_prefixes_.emplace(ctx, std::move(prefix))
+      .first->second;
 }
 
 std::string TypeAnalyzer::NameForRecordDecl(
@@ -345,29 +1495,42 @@ std::string TypeAnalyzer::NameForRecordDecl(
 
   if (record_decl.isAnonymousStructOrUnion()) {
     std::string anon_name = "(anonymous ";
-    if (record_decl.isStruct())
-      anon_name += "struct";
-    else
+    if (record_decl.isUnion())
       anon_name += "union";
+    else
+      anon_name += "struct";
     anon_name += ")";
     return anon_name;
   }
 
+  // C idiom: `typedef struct { ... } name;` names the record by its typedef.
+  if (record_decl.getName().empty()) {
+    if (const auto* typedef_decl = record_decl.getTypedefNameForAnonDecl())
+      return typedef_decl->getNameAsString();
+  }
+
   std::string record_name = record_decl.getNameAsString();
   return record_name;
 }
 
+TypeId TypeAnalyzer::GetOrCreateTypeId(const clang::Decl& declaration) {
+  const clang::Decl* canonical = declaration.getCanonicalDecl();
+  auto it = decl_to_type_id_.find(canonical);
+  if (it != decl_to_type_id_.end())
+    return it->second;
+
+  TypeId type_id = type_registry_.NewId();
+  decl_to_type_id_.emplace(canonical, type_id);
+  return type_id;
+}
+
 std::unique_ptr<clang::CompilerInstance> TypeAnalyzer::CreateCompilerInstance()
     const {
 
   auto compiler = std::make_unique<clang::CompilerInstance>();
 
   // Create diagnostics engine
-  auto* diagnostics_engine = new clang::DiagnosticsEngine(
-      clang::IntrusiveRefCntPtr<clang::DiagnosticIDs>(
-          new clang::DiagnosticIDs()),
-      new clang::DiagnosticOptions);
-  compiler->setDiagnostics(diagnostics_engine);
+  compiler->setDiagnostics(CreateDiagnosticsEngine());
 
   auto invocation = std::make_shared<clang::CompilerInvocation>();
 
@@ -376,6 +1539,11 @@ std::unique_ptr<clang::CompilerInstance> TypeAnalyzer::CreateCompilerInstance()
   for (const auto& flag : compiler_flags_) {
     cflags.push_back(flag.c_str());
   }
+  // The last -triple wins, so this overrides one the flags may give.
+  if (!target_triple_.empty()) {
+    cflags.push_back("-triple");
+    cflags.push_back(target_triple_.c_str());
+  }
   clang::CompilerInvocation::CreateFromArgs(*invocation, cflags,
                                             compiler->getDiagnostics());
 
@@ -384,4 +1552,43 @@ std::unique_ptr<clang::CompilerInstance> TypeAnalyzer::CreateCompilerInstance()
   return compiler;
 }
 
+absl::StatusOr<std::unique_ptr<clang::CompilerInstance>>
+TypeAnalyzer::CreateCompilerInstance(
+    const clang::tooling::CompileCommand& command) const {
+
+  auto compiler = std::make_unique<clang::CompilerInstance>();
+  compiler->setDiagnostics(CreateDiagnosticsEngine());
+
+  // Compilation databases record full driver command lines. Strip outputs and
+  // stop after semantic analysis so the driver plans a single cc1 job.
+  clang::tooling::CommandLineArguments args = command.CommandLine;
+  args = clang::tooling::getClangStripOutputAdjuster()(args, command.Filename);
+  args = clang::tooling::getClangSyntaxOnlyAdjuster()(args, command.Filename);
+  args.insert(args.end(), compiler_flags_.begin(), compiler_flags_.end());
+  if (!target_triple_.empty())
+    args.push_back("--target=" + target_triple_);
+
+  std::vector<const char*> cargs;
+  cargs.reserve(args.size());
+  for (const auto& arg : args) {
+    cargs.push_back(arg.c_str());
+  }
+
+  clang::CreateInvocationOptions options;
+  options.Diags = &compiler->getDiagnostics();
+  std::shared_ptr<clang::CompilerInvocation> invocation =
+      clang::createInvocation(cargs, std::move(options));
+  if (!invocation) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Unusable compile command for: ", command.Filename));
+  }
+
+  // Relative include paths in the database are relative to the command's
+  // working directory, not ours.
+  invocation->getFileSystemOpts().WorkingDir = command.Directory;
+  compiler->setInvocation(std::move(invocation));
+
+  return compiler;
+}
+
 }  // namespace typesynth
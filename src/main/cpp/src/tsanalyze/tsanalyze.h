@@ -25,20 +25,44 @@
 #ifndef TSANALYZE_H
 #define TSANALYZE_H
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/ADT/MapVector.h>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 
+#include "analysis_cache.h"
+#include "analysis_metrics.h"
+#include "deduplication.h"
 #include "models.h"
+#include "pch_cache.h"
+#include "root_filter.h"
+#include "type_registry.h"
 
 // Forward declarations for clang to reduce compilation dependencies.
 namespace clang {
 class Decl;
+class DeclContext;
 class ASTContext;
 class CompilerInstance;
 class DiagnosticsEngine;
+class FileID;
+class FileManager;
 class SourceManager;
 class QualType;
 class Type;
@@ -47,19 +71,228 @@ class EnumDecl;
 class TypedefNameDecl;
 class FunctionDecl;
 class ObjCInterfaceDecl;
+namespace tooling {
+struct CompileCommand;
+}  // namespace tooling
 }  // namespace clang
 
+namespace llvm::vfs {
+class InMemoryFileSystem;
+}  // namespace llvm::vfs
+
 namespace typesynth {
 
+class HeaderFragmentCache;
+
+// Snapshot of a running analysis, as passed to a ProgressCallback.
+struct AnalysisProgress {
+  size_t units_done = 0;
+  size_t units_total = 0;
+  // Types extracted so far, counted before identical ones are folded.
+  size_t types_extracted = 0;
+  // The translation unit that was just started, or empty once all are done.
+  std::string current_file;
+};
+
+using ProgressCallback = std::function<void(const AnalysisProgress&)>;
+
+// A source file or header held in memory rather than on disk.
+struct SourceBuffer {
+  std::string path;
+  std::string contents;
+};
+
 class TypeAnalyzer {
  public:
   explicit TypeAnalyzer(std::vector<std::string> flags);
+  TypeAnalyzer(TypeAnalyzer&&) noexcept;
+  TypeAnalyzer& operator=(TypeAnalyzer&&) noexcept;
+  ~TypeAnalyzer();
 
+  // Analyzes a single translation unit. Types already in the registry are
+  // kept, and identical ones are folded together afterwards. Repeated calls
+  // share one file manager, so source files are assumed not to change over
+  // the analyzer's lifetime.
   absl::Status AnalyzeSourceFile(const std::string& filepath);
 
+  // Analyzes every translation unit listed in a compilation database, given
+  // either as a compile_commands.json file or the directory containing one.
+  // Translation units are spread across `num_workers` threads (one per core
+  // when zero), each with its own registry, and the registries are merged
+  // into this analyzer's once all of them finish, folding types that several
+  // translation units share into one node. `compiler_flags_` are
+  // appended to every command line. Types from translation units that
+  // succeeded are kept even when others fail.
+  absl::Status AnalyzeProject(const std::string& compilation_database,
+                              unsigned num_workers = 0);
+
+  // Analyzes several translation units with this analyzer's flags, spread
+  // across worker threads the same way as AnalyzeProject.
+  absl::Status AnalyzeSourceFiles(const std::vector<std::string>& filepaths,
+                                  unsigned num_workers = 0);
+
+  // Extracts the types declared in a translation unit that was parsed
+  // elsewhere, such as an ASTUnit, into the registry. Identical types are not
+  // folded. Lets benchmarks time extraction apart from parsing.
+  void ExtractTypes(const clang::ASTContext& context);
+
+  // Called as each translation unit starts and once more when the analysis
+  // finishes. Calls may come from worker threads but are never concurrent.
+  void SetProgressCallback(ProgressCallback callback);
+
+  // Asks the analysis running on another thread to stop. Clang is stopped at
+  // the next top-level declaration, translation units not yet started are
+  // skipped, and the analysis returns a CancelledError, keeping whatever
+  // types were extracted before. Later analyses are cancelled as well until
+  // ResetCancellation() is called, so a cancellation cannot be lost to an
+  // analysis that had not quite started yet.
+  void Cancel() { cancelled_->store(true); }
+  void ResetCancellation() { cancelled_->store(false); }
+
+  // Directory holding precompiled headers for the system includes that open
+  // each analyzed file. Defaults to a directory under the user's cache
+  // directory; an empty path disables precompiled headers. Each analysis
+  // checks the headers behind them again, and a translation unit whose PCH
+  // fails to load is parsed without one.
+  void SetPchCacheDirectory(const std::string& directory);
+
+  // Directory holding the types extracted from previously analyzed
+  // translation units, reused while none of their inputs change. Defaults to
+  // a directory under the user's cache directory; an empty path disables it.
+  void SetAnalysisCacheDirectory(const std::string& directory);
+
+  // Whether the types of a header included the same way by several
+  // translation units are extracted once and then reused, which is the
+  // default. The shared fragments are only held for one analysis.
+  void SetHeaderSharing(bool enabled);
+
+  // Caps how much memory the process should use while analyzing several
+  // translation units: new ones are only started while the resident set
+  // plus what a translation unit has been seen to need fits in `bytes`. Near
+  // the cap, workers fold identical types in their registries into fresh
+  // storage and hand freed memory back to the system. Both sides of the
+  // comparison are estimates from the resident set of the whole process. At
+  // least one translation unit always runs. Defaults to three quarters of
+  // physical memory; zero lifts the cap.
+  void SetMemoryBudget(uint64_t bytes) { memory_budget_ = bytes; }
+
+  // Mounts `buffers` in front of the real file system for later analyses,
+  // replacing any mounted before, so that they can be analyzed and included
+  // as if they were on disk. Relative paths are resolved against the current
+  // directory; of several buffers with the same path, the first one wins.
+  void SetSourceBuffers(const std::vector<SourceBuffer>& buffers);
+
+  // Analyzes each later batch of translation units once per target triple
+  // and combines the results into one multi-target registry, see
+  // CombineTargets. The file manager is shared between the passes, so
+  // sources and headers are read once. Empty, the default, analyzes for the
+  // target the flags select. Fails if the registry already holds types for
+  // other targets, or for more than 64.
+  absl::Status SetTargets(std::vector<std::string> targets);
+
+  // Limits later analyses to the roots `filter` selects and the types they
+  // need; an empty filter lifts the limit. Declarations from files outside
+  // the globs are skipped before any work is done on them unless roots are
+  // named as well. Headers are not shared between translation units while a
+  // filter is set, as what a header contributes then depends on the roots
+  // of the file including it. Fails on malformed globs, leaving the filter
+  // as it was.
+  absl::Status SetExtractionFilter(const ExtractionFilter& filter);
+
+  // Forgets the extracted types, along with what the file managers looked up
+  // and the shared header fragments, while keeping the on-disk caches and
+  // workers warm, so that a long-lived analyzer can serve analyses of files
+  // that changed since it last saw them.
+  void Reset();
+
+  [[nodiscard]] const TypeRegistry& type_registry() const {
+    return type_registry_;
+  }
+
+  // Timings and counters accumulated over the analyzer's lifetime. The
+  // mutable overload lets callers that serialize the results account for
+  // that too.
+  [[nodiscard]] const AnalysisMetrics& metrics() const { return metrics_; }
+  AnalysisMetrics& metrics() { return metrics_; }
+
+  // Records a Chrome trace of each later analysis, merged with clang's own
+  // -ftime-trace events. Events shorter than `granularity_us` microseconds
+  // are dropped.
+  void EnableTimeTrace(unsigned granularity_us = 500) {
+    time_trace_granularity_ = granularity_us;
+  }
+
+  // The trace of the last analysis as Chrome trace-event JSON; empty unless
+  // EnableTimeTrace was called.
+  [[nodiscard]] const std::string& time_trace() const { return time_trace_; }
+
+  // Same-name definitions that disagreed as of the last analysis.
+  [[nodiscard]] const std::vector<TypeConflict>& type_conflicts() const {
+    return type_conflicts_;
+  }
+
  private:
+  friend class ExtractionConsumer;
+
+  // Runs `analyze_unit(worker, i)` for every index of `files` on up to
+  // `num_workers` worker analyzers, then merges their registries into this
+  // one. `files` names the translation units for progress reports.
+  absl::Status AnalyzeInParallel(
+      const std::vector<std::string>& files, unsigned num_workers,
+      const std::function<absl::Status(TypeAnalyzer&, size_t)>& analyze_unit);
+  // Runs `analyze` once per entry of `targets_`, each into an empty registry,
+  // and merges the combined results into this analyzer's registry; runs it
+  // once as is when there are no targets.
+  absl::Status AnalyzeForEachTarget(
+      const std::function<absl::Status()>& analyze);
+  absl::Status AnalyzeCompileCommand(
+      const clang::tooling::CompileCommand& command);
+  // Analyzes one file with `compiler_flags_`, without folding duplicates.
+  absl::Status AnalyzeFile(const std::string& filepath);
+  [[nodiscard]] bool cancelled() const { return cancelled_->load(); }
+  // Clears the lookup tables scoped to a translation unit. They are keyed on
+  // AST nodes, which die with the compiler instance.
+  void ResetUnitTables();
+  // Analyzes one translation unit and records its metrics.
+  absl::Status RunExtraction(clang::CompilerInstance& compiler,
+                             const std::string& filepath);
+  absl::Status ExtractTranslationUnit(clang::CompilerInstance& compiler,
+                                      const std::string& filepath);
+
+  // Processes a top-level declaration of a header keyed `key` by
+  // HeaderKeyTracker, unless a fragment with the header's types is already
+  // shared, in which case the whole header is taken from it.
+  void ProcessHeaderDeclaration(uint64_t key, const clang::Decl* decl,
+                                const clang::ASTContext& context);
+  // Keeps the header keyed `key` from being shared by this translation unit.
+  void DiscardHeaderFragment(uint64_t key);
+  // Adds the ids of the types `declaration` was processed into to `roots`.
+  void CollectDeclarationRoots(const clang::Decl* declaration,
+                               std::vector<TypeId>& roots) const;
+  // Shares the fragments of the headers this translation unit extracted,
+  // when `share` is set, and merges the ones it reused into `extracted`.
+  void FinishHeaderFragments(TypeRegistry& extracted, bool share);
+
+  // Whether the extraction filter makes `declaration` a root. Namespaces and
+  // linkage specifications are not roots themselves.
+  bool IsExtractionRoot(const clang::Decl& declaration,
+                        const clang::ASTContext& context);
+  // Whether the filter's globs allow the declarations of `file`. Memoized
+  // per translation unit.
+  bool IsFileAllowed(clang::FileID file,
+                     const clang::SourceManager& source_manager);
+  // Whether the declarations of `file` can be dropped without looking at
+  // them: no root is named, and the globs don't allow the file. Those that
+  // DefinesIncompleteType are kept regardless.
+  bool SkipsFile(clang::FileID file,
+                 const clang::SourceManager& source_manager);
+  // Whether `declaration` defines a record or enum that was already stored
+  // incomplete, having been referenced before its definition. Such a
+  // definition completes the stored type even where the filter would drop it.
+  [[nodiscard]] bool DefinesIncompleteType(
+      const clang::Decl& declaration) const;
+
   // Methods for processing clang type nodes.
-  void ProcessTranslationUnit(const clang::ASTContext& context);
   void ProcessDeclaration(const clang::Decl* declaration,
                           const clang::ASTContext& context);
 
@@ -78,31 +311,93 @@ class TypeAnalyzer {
 
   TypeId IDForQualType(const clang::QualType& qual_type,
                        const clang::ASTContext& context);
+  // Returns the id of an existing node equal to `node`, or inserts it under a
+  // fresh id. Only for nodes identified purely by their references; a
+  // function's arguments are passed alongside it.
+  template <typename T>
+  TypeId InternDerivedType(
+      T node, std::span<const models::FunctionArgument> args = {});
   bool IsSymbolicReference(const clang::QualType& qual_type);
 
   [[nodiscard]] static bool IsRecordPacked(
       const clang::RecordDecl& record_decl);
   [[nodiscard]] bool IsTypeProcessed(TypeId type_id) const;
+  // Whether `type_id` was stored as a record or enum without its definition.
+  // Enums carry no such flag, so those without enumerators count as well;
+  // redoing a defined empty one is harmless.
+  [[nodiscard]] bool IsIncompleteType(TypeId type_id) const;
 
   absl::StatusOr<models::SourceLocation> SourceLocationFromDecl(
       const clang::Decl* decl, const clang::SourceManager& source_manager);
 
-  static std::string FullyQualifiedDeclName(const clang::Decl& declaration,
-                                            const clang::ASTContext& context);
+  std::string FullyQualifiedDeclName(const clang::Decl& declaration,
+                                     const clang::ASTContext& context);
+  // The qualified name of `ctx` followed by "::", or nothing at translation
+  // unit scope. Memoized per context; the reference is valid until the next
+  // call.
+  const std::string& QualifiedNamePrefix(const clang::DeclContext* ctx);
 
   static std::string NameForRecordDecl(const clang::RecordDecl& record_decl);
 
-  TypeId GetOrCreateTypeId(const clang::QualType& type,
-                           const clang::ASTContext& context);
+  // Returns the id reserved for a record, enum, typedef or function
+  // declaration, reserving one on first use. All redeclarations share an id.
+  TypeId GetOrCreateTypeId(const clang::Decl& declaration);
 
   [[nodiscard]] std::unique_ptr<clang::CompilerInstance>
   CreateCompilerInstance() const;
+  [[nodiscard]] absl::StatusOr<std::unique_ptr<clang::CompilerInstance>>
+  CreateCompilerInstance(const clang::tooling::CompileCommand& command) const;
 
   // Member variables
   std::vector<std::string> compiler_flags_;
-  std::unordered_map<TypeId, models::TypeNode> type_registry_;
-  std::unordered_map<std::string, size_t> string_to_type_id_;
-  TypeId next_type_id_ = 1;
+  TypeRegistry type_registry_;
+  std::vector<TypeConflict> type_conflicts_;
+  // Shared with the workers of AnalyzeProject.
+  std::shared_ptr<PchCache> pch_cache_;
+  std::shared_ptr<AnalysisCache> analysis_cache_;
+  std::shared_ptr<HeaderFragmentCache> header_fragments_;
+  // Kept across translation units so that the headers they share are only
+  // looked up once.
+  llvm::IntrusiveRefCntPtr<clang::FileManager> file_manager_;
+  // Overlaid on the file system of every compiler instance when set. Shared
+  // with the workers.
+  llvm::IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> source_buffers_;
+  // Workers of AnalyzeProject and AnalyzeSourceFiles, kept between analyses
+  // along with their file managers. Their registries are emptied after each
+  // merge.
+  std::vector<TypeAnalyzer> workers_;
+  // Shared with the workers, so that cancelling reaches all of them.
+  std::shared_ptr<std::atomic<bool>> cancelled_ =
+      std::make_shared<std::atomic<bool>>(false);
+  ProgressCallback progress_callback_;
+  AnalysisMetrics metrics_;
+  // Metrics of the translation unit being analyzed.
+  UnitMetrics unit_metrics_;
+  std::optional<unsigned> time_trace_granularity_;
+  uint64_t memory_budget_ = 0;
+  // Set by SetExtractionFilter. Shared with the workers.
+  std::shared_ptr<const RootFilter> root_filter_;
+  std::vector<std::string> targets_;
+  // The target of the pass AnalyzeForEachTarget is running, passed on to the
+  // compiler instances; empty to keep the flags' target.
+  std::string target_triple_;
+  std::string time_trace_;
+
+  // Lookup tables scoped to the translation unit being analyzed.
+  absl::flat_hash_map<const void*, TypeId> qual_type_ids_;
+  absl::flat_hash_map<std::vector<TypeId>, TypeId> derived_type_ids_;
+  std::unordered_map<const clang::Decl*, TypeId> decl_to_type_id_;
+  std::unordered_set<TypeId> types_in_progress_;
+  absl::flat_hash_map<const clang::DeclContext*, std::string>
+      qualified_name_prefixes_;
+  // Whether the root filter allows each file, by FileID.
+  absl::flat_hash_map<unsigned, bool> allowed_files_;
+  // Fragments this translation unit takes from `header_fragments_` with their
+  // keys, and the root types of the headers it extracts itself, by key in the
+  // order they were met.
+  std::vector<std::shared_ptr<const TypeRegistry>> reused_fragments_;
+  absl::flat_hash_set<uint64_t> reused_fragment_keys_;
+  llvm::MapVector<uint64_t, std::vector<TypeId>> new_fragments_;
 };
 
 }  // namespace typesynth
@@ -0,0 +1,859 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "type_archive.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <numeric>
+#include <ranges>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+
+#include "hashing.h"
+#include "stable_ids.h"
+
+namespace typesynth {
+
+static_assert(std::endian::native == std::endian::little,
+              "Type archives are read in place and assume a little-endian "
+              "host");
+
+namespace {
+
+using archive::LayoutRecord;
+using archive::MemberRecord;
+using archive::NameEntry;
+using archive::NodeRecord;
+
+uint64_t HashName(std::string_view name) {
+  return HashBuilder().Add(name).value();
+}
+
+// Whether `count` records of `record_size` bytes starting at `offset` lie
+// within a file of `size` bytes. Archives may come from anywhere, so this is
+// written such that no header can make it wrap around.
+bool SectionFits(uint64_t offset, uint64_t count, uint64_t record_size,
+                 uint64_t size) {
+  return offset <= size && count <= (size - offset) / record_size;
+}
+
+class ArchiveBuilder {
+ public:
+  ArchiveBuilder(const TypeRegistry& registry, bool with_index)
+      : registry_(registry),
+        string_offsets_(registry.strings().size(), kUnwritten) {
+    string_offsets_[kEmptyStringId] = 0;
+
+    // The registry iterates in id order, which is the order records are
+    // written in.
+    ids_.reserve(registry.size());
+    for (TypeId type_id : registry)
+      ids_.push_back(type_id);
+
+    index_of_.reserve(ids_.size());
+    for (uint32_t i = 0; i < ids_.size(); ++i)
+      index_of_.emplace(ids_[i], i);
+
+    nodes_.reserve(ids_.size());
+    for (TypeId type_id : ids_)
+      nodes_.push_back(Build(type_id));
+    if (!registry.targets().empty())
+      AddTargetTables();
+
+    if (with_index) {
+      IndexNames();
+      IndexStableIds();
+      IndexUsers();
+    }
+  }
+
+  void Write(llvm::raw_ostream& os) const {
+    archive::ArchiveHeader header = {};
+    std::copy(std::begin(archive::kMagic), std::end(archive::kMagic),
+              header.magic);
+    header.version = archive::kVersion;
+    header.node_count = nodes_.size();
+    header.member_count = members_.size();
+    header.nodes_offset = sizeof(header);
+    header.members_offset =
+        header.nodes_offset + nodes_.size() * sizeof(NodeRecord);
+    uint64_t offset =
+        header.members_offset + members_.size() * sizeof(MemberRecord);
+    if (!targets_.empty()) {
+      header.target_masks_offset = offset;
+      offset += target_masks_.size() * sizeof(uint64_t);
+    }
+
+    // The index sections go from the widest entries to the narrowest, so
+    // each stays aligned without padding.
+    if (!user_offsets_.empty()) {
+      header.name_count = names_.size();
+      header.names_offset = offset;
+      offset += names_.size() * sizeof(NameEntry);
+      header.stable_ids_offset = offset;
+      offset += stable_ids_.size() * sizeof(uint64_t);
+      header.by_stable_id_offset = offset;
+      offset += by_stable_id_.size() * sizeof(uint32_t);
+      header.user_offsets_offset = offset;
+      offset += user_offsets_.size() * sizeof(uint32_t);
+      header.user_count = users_.size();
+      header.users_offset = offset;
+      offset += users_.size() * sizeof(uint32_t);
+      header.bucket_count = buckets_.size();
+      header.buckets_offset = offset;
+      offset += buckets_.size() * sizeof(uint32_t);
+    }
+    if (!targets_.empty()) {
+      header.target_count = targets_.size();
+      header.layout_count = layouts_.size();
+      header.layouts_offset = offset;
+      offset += layouts_.size() * sizeof(LayoutRecord);
+      header.layout_field_count = layout_fields_.size();
+      header.layout_fields_offset = offset;
+      offset += layout_fields_.size() * sizeof(uint32_t);
+      header.targets_offset = offset;
+      offset += targets_.size() * sizeof(uint32_t);
+    }
+    header.strings_offset = offset;
+    header.strings_size = strings_.size();
+
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    WriteSection(os, nodes_);
+    WriteSection(os, members_);
+    WriteSection(os, target_masks_);
+    WriteSection(os, names_);
+    WriteSection(os, stable_ids_);
+    WriteSection(os, by_stable_id_);
+    WriteSection(os, user_offsets_);
+    WriteSection(os, users_);
+    WriteSection(os, buckets_);
+    WriteSection(os, layouts_);
+    WriteSection(os, layout_fields_);
+    WriteSection(os, targets_);
+    os.write(strings_.data(), strings_.size());
+  }
+
+ private:
+  template <typename T>
+  static void WriteSection(llvm::raw_ostream& os, const std::vector<T>& items) {
+    os.write(reinterpret_cast<const char*>(items.data()),
+             items.size() * sizeof(T));
+  }
+
+  std::string_view StringAt(uint32_t offset) const {
+    return strings_.data() + offset;
+  }
+
+  // Sorts the named declarations by name, and hashes the first entry of each
+  // name into an open-addressed table at most half full.
+  void IndexNames() {
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+      if (nodes_[i].qualified_name != 0)
+        names_.push_back({.qualified_name = nodes_[i].qualified_name,
+                          .node = i});
+    }
+    std::ranges::sort(names_, [this](const NameEntry& a, const NameEntry& b) {
+      const std::string_view a_name = StringAt(a.qualified_name);
+      const std::string_view b_name = StringAt(b.qualified_name);
+      return a_name != b_name ? a_name < b_name : a.node < b.node;
+    });
+
+    std::vector<uint32_t> firsts;
+    for (uint32_t i = 0; i < names_.size(); ++i) {
+      if (i == 0 ||
+          names_[i].qualified_name != names_[i - 1].qualified_name)
+        firsts.push_back(i);
+    }
+    buckets_.assign(std::bit_ceil(std::max<size_t>(2 * firsts.size(), 1)),
+                    archive::kNoIndex);
+    const uint64_t mask = buckets_.size() - 1;
+    for (uint32_t first : firsts) {
+      uint64_t bucket =
+          HashName(StringAt(names_[first].qualified_name)) & mask;
+      while (buckets_[bucket] != archive::kNoIndex)
+        bucket = (bucket + 1) & mask;
+      buckets_[bucket] = first;
+    }
+  }
+
+  void IndexStableIds() {
+    const StableTypeIds stable_ids(registry_);
+    stable_ids_.reserve(ids_.size());
+    for (TypeId type_id : ids_)
+      stable_ids_.push_back(stable_ids.IdOf(type_id));
+
+    by_stable_id_.resize(ids_.size());
+    std::iota(by_stable_id_.begin(), by_stable_id_.end(), 0);
+    std::ranges::sort(by_stable_id_, [this](uint32_t a, uint32_t b) {
+      return stable_ids_[a] != stable_ids_[b] ? stable_ids_[a] < stable_ids_[b]
+                                              : a < b;
+    });
+  }
+
+  // Inverts the references between records into per-record lists of users.
+  void IndexUsers() {
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+      if (nodes_[i].kind ==
+          static_cast<uint8_t>(models::NodeKind::kSymbolicReference))
+        continue;
+      registry_.ForEachReference(ids_[i], [&](TypeId ref) {
+        const uint32_t used = ResolveIndex(Index(ref));
+        if (used != archive::kNoIndex)
+          edges.emplace_back(used, i);
+      });
+    }
+    std::ranges::sort(edges);
+    const auto duplicates = std::ranges::unique(edges);
+    edges.erase(duplicates.begin(), duplicates.end());
+
+    user_offsets_.assign(nodes_.size() + 1, 0);
+    users_.reserve(edges.size());
+    for (const auto& [used, user] : edges) {
+      ++user_offsets_[used + 1];
+      users_.push_back(user);
+    }
+    std::partial_sum(user_offsets_.begin(), user_offsets_.end(),
+                     user_offsets_.begin());
+  }
+
+  // Follows symbolic references to the record they stand for.
+  uint32_t ResolveIndex(uint32_t index) const {
+    for (size_t depth = 0; depth < nodes_.size() && index < nodes_.size();
+         ++depth) {
+      if (nodes_[index].kind !=
+          static_cast<uint8_t>(models::NodeKind::kSymbolicReference))
+        return index;
+      index = nodes_[index].type;
+    }
+    return archive::kNoIndex;
+  }
+
+  uint32_t Index(TypeId type_id) const {
+    auto it = index_of_.find(type_id);
+    return it == index_of_.end() ? archive::kNoIndex : it->second;
+  }
+
+  // The registry's strings are already distinct, so each one is written the
+  // first time it is used and found by id afterwards.
+  uint32_t Intern(StringId id) {
+    uint32_t& offset = string_offsets_[id];
+    if (offset == kUnwritten) {
+      offset = strings_.size();
+      strings_.append(registry_.String(id));
+      strings_.push_back('\0');
+    }
+    return offset;
+  }
+
+  void AddMember(StringId name, uint32_t type, uint64_t value) {
+    members_.push_back(MemberRecord{
+        .name = Intern(name), .type = type, .value = value});
+  }
+
+  // Copies the target tables of a multi-target registry, by record index.
+  // The triples are not in the registry's string pool, so they are appended
+  // as they are.
+  void AddTargetTables() {
+    for (const std::string& target : registry_.targets()) {
+      targets_.push_back(strings_.size());
+      strings_.append(target);
+      strings_.push_back('\0');
+    }
+    target_masks_.reserve(ids_.size());
+    for (uint32_t i = 0; i < ids_.size(); ++i) {
+      target_masks_.push_back(registry_.TargetMask(ids_[i]));
+      for (const auto& layout : registry_.TargetLayouts(ids_[i])) {
+        layouts_.push_back(LayoutRecord{
+            .node = i,
+            .target = layout.target,
+            .size = layout.size,
+            .flags = layout.is_signed ? archive::kSigned : 0u,
+            .first_field = static_cast<uint32_t>(layout_fields_.size()),
+            .field_count =
+                static_cast<uint32_t>(layout.field_offsets_bits.size())});
+        layout_fields_.insert(layout_fields_.end(),
+                              layout.field_offsets_bits.begin(),
+                              layout.field_offsets_bits.end());
+      }
+    }
+  }
+
+  NodeRecord Build(TypeId type_id) {
+    NodeRecord record = {};
+    record.id = type_id;
+    record.kind = static_cast<uint8_t>(registry_.kind(type_id));
+    record.type = archive::kNoIndex;
+    record.first_member = members_.size();
+
+    registry_.Visit(type_id, [&]<typename T>(const T& n) {
+      if constexpr (std::is_same_v<T, models::Primitive>) {
+        record.name = Intern(n.primitive);
+        record.size = n.size_bits;
+        record.flags = n.is_signed ? archive::kSigned : 0;
+      } else if constexpr (std::is_same_v<T, models::Pointer> ||
+                           std::is_same_v<T, models::Reference> ||
+                           std::is_same_v<T, models::SymbolicReference>) {
+        record.type = Index(n.inner);
+      } else if constexpr (std::is_same_v<T, models::Function>) {
+        record.type = Index(n.ret_type);
+        record.flags = n.is_variadic ? archive::kVariadic : 0;
+        for (const auto& arg : registry_.List(n.args))
+          AddMember(arg.name, Index(arg.type), 0);
+      } else if constexpr (std::is_same_v<T, models::StructDecl> ||
+                           std::is_same_v<T, models::UnionDecl>) {
+        record.name = Intern(n.name);
+        record.qualified_name = Intern(n.qualified_name);
+        record.size = n.size_bytes;
+        record.flags = (n.is_packed ? archive::kPacked : 0) |
+                       (n.is_anonymous ? archive::kAnonymous : 0) |
+                       (n.is_complete ? archive::kComplete : 0);
+        for (const auto& field : registry_.List(n.fields)) {
+          AddMember(field.name, Index(field.type),
+                    field.offset_bits |
+                        static_cast<uint64_t>(field.bit_width) << 32);
+        }
+      } else if constexpr (std::is_same_v<T, models::EnumDecl>) {
+        record.name = Intern(n.name);
+        record.qualified_name = Intern(n.qualified_name);
+        record.type = Index(n.underlying);
+        record.size = n.size_bytes;
+        record.flags = n.is_anonymous ? archive::kAnonymous : 0;
+        for (const auto& constant : registry_.List(n.constants)) {
+          AddMember(constant.name, archive::kNoIndex,
+                    static_cast<uint64_t>(constant.value));
+        }
+      } else if constexpr (std::is_same_v<T, models::TypedefDecl>) {
+        record.name = Intern(n.name);
+        record.qualified_name = Intern(n.qualified_name);
+        record.type = Index(n.underlying);
+      } else if constexpr (std::is_same_v<T, models::FunctionDecl>) {
+        record.name = Intern(n.name);
+        record.qualified_name = Intern(n.qualified_name);
+        record.type = Index(n.type);
+        for (StringId param_name : registry_.List(n.param_names))
+          AddMember(param_name, archive::kNoIndex, 0);
+      }
+    });
+
+    record.member_count = members_.size() - record.first_member;
+    return record;
+  }
+
+  static constexpr uint32_t kUnwritten = UINT32_MAX;
+
+  const TypeRegistry& registry_;
+  std::vector<TypeId> ids_;
+  absl::flat_hash_map<TypeId, uint32_t> index_of_;
+  std::vector<NodeRecord> nodes_;
+  std::vector<MemberRecord> members_;
+  std::vector<NameEntry> names_;
+  std::vector<uint64_t> stable_ids_;
+  std::vector<uint32_t> by_stable_id_;
+  std::vector<uint32_t> user_offsets_;
+  std::vector<uint32_t> users_;
+  std::vector<uint32_t> buckets_;
+  std::vector<uint64_t> target_masks_;
+  std::vector<LayoutRecord> layouts_;
+  std::vector<uint32_t> layout_fields_;
+  std::vector<uint32_t> targets_;
+  std::string strings_ = std::string(1, '\0');
+  // Indexed by StringId.
+  std::vector<uint32_t> string_offsets_;
+};
+
+}  // namespace
+
+void WriteTypeArchive(const TypeRegistry& registry, llvm::raw_ostream& os,
+                      bool with_index) {
+  ArchiveBuilder(registry, with_index).Write(os);
+}
+
+absl::Status WriteTypeArchive(const TypeRegistry& registry,
+                              const std::string& path, bool with_index) {
+  auto error = llvm::writeToOutput(path, [&](llvm::raw_ostream& os) {
+    WriteTypeArchive(registry, os, with_index);
+    return llvm::Error::success();
+  });
+  if (error) {
+    return absl::InternalError(llvm::toString(std::move(error)));
+  }
+  return absl::OkStatus();
+}
+
+TypeArchive::TypeArchive(TypeArchive&&) noexcept = default;
+TypeArchive& TypeArchive::operator=(TypeArchive&&) noexcept = default;
+TypeArchive::~TypeArchive() = default;
+
+absl::StatusOr<TypeArchive> TypeArchive::Open(const std::string& path) {
+  // Large files are mapped rather than read.
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    return absl::NotFoundError(absl::StrCat("Failed to open ", path, ": ",
+                                            buffer.getError().message()));
+  }
+  return FromBuffer(std::move(*buffer));
+}
+
+absl::StatusOr<TypeArchive> TypeArchive::FromBuffer(
+    std::unique_ptr<llvm::MemoryBuffer> buffer) {
+  const char* data = buffer->getBufferStart();
+  const uint64_t size = buffer->getBufferSize();
+
+  archive::ArchiveHeader header;
+  if (size < sizeof(header)) {
+    return absl::DataLossError("Truncated type archive");
+  }
+  std::memcpy(&header, data, sizeof(header));
+
+  if (!std::equal(std::begin(archive::kMagic), std::end(archive::kMagic),
+                  header.magic)) {
+    return absl::DataLossError("Not a type archive");
+  }
+  if (header.version != archive::kVersion) {
+    return absl::FailedPreconditionError(absl::StrCat(
+        "Unsupported type archive version ", header.version));
+  }
+
+  // Every section has to lie within the file, and records have to be aligned
+  // to be read in place.
+  if (!SectionFits(header.nodes_offset, header.node_count, sizeof(NodeRecord),
+                   size) ||
+      !SectionFits(header.members_offset, header.member_count,
+                   sizeof(MemberRecord), size) ||
+      !SectionFits(header.strings_offset, header.strings_size, 1, size) ||
+      (header.strings_size > 0 &&
+       data[header.strings_offset + header.strings_size - 1] != '\0')) {
+    return absl::DataLossError("Corrupt type archive");
+  }
+  if (reinterpret_cast<uintptr_t>(data + header.nodes_offset) %
+              alignof(NodeRecord) != 0 ||
+      reinterpret_cast<uintptr_t>(data + header.members_offset) %
+              alignof(MemberRecord) != 0) {
+    return absl::DataLossError("Misaligned type archive");
+  }
+
+  // Records are found by binary search on their id, which needs them sorted
+  // without repeats, and id 0 stands for no type.
+  const std::span<const NodeRecord> nodes = {
+      reinterpret_cast<const NodeRecord*>(data + header.nodes_offset),
+      header.node_count};
+  TypeId previous_id = kInvalidTypeId;
+  for (const NodeRecord& record : nodes) {
+    if (record.id <= previous_id)
+      return absl::DataLossError("Corrupt type archive records");
+    previous_id = record.id;
+  }
+
+  TypeArchive type_archive;
+  // Each of the optional sections has to lie within the file and be aligned.
+  bool valid = true;
+  auto section = [&]<typename T>(uint64_t offset, uint64_t count,
+                                 std::span<const T>& out) {
+    if (!SectionFits(offset, count, sizeof(T), size) ||
+        reinterpret_cast<uintptr_t>(data + offset) % alignof(T) != 0) {
+      valid = false;
+      return;
+    }
+    out = {reinterpret_cast<const T*>(data + offset), count};
+  };
+  if (header.target_count != 0) {
+    // Target masks have a bit per target.
+    valid = header.target_count <= 64;
+    section(header.target_masks_offset, header.node_count,
+            type_archive.target_masks_);
+    section(header.layouts_offset, header.layout_count,
+            type_archive.layouts_);
+    section(header.layout_fields_offset, header.layout_field_count,
+            type_archive.layout_fields_);
+    section(header.targets_offset, header.target_count,
+            type_archive.targets_);
+    if (!valid) {
+      return absl::DataLossError("Corrupt type archive target tables");
+    }
+  }
+  if (header.user_offsets_offset != 0) {
+    section(header.names_offset, header.name_count, type_archive.names_);
+    section(header.stable_ids_offset, header.node_count,
+            type_archive.stable_ids_);
+    section(header.by_stable_id_offset, header.node_count,
+            type_archive.by_stable_id_);
+    section(header.user_offsets_offset, uint64_t{header.node_count} + 1,
+            type_archive.user_offsets_);
+    section(header.users_offset, header.user_count, type_archive.users_);
+    section(header.buckets_offset, header.bucket_count,
+            type_archive.buckets_);
+    if (!valid || !std::has_single_bit(header.bucket_count)) {
+      return absl::DataLossError("Corrupt type archive index");
+    }
+  }
+  type_archive.nodes_ = nodes;
+  type_archive.members_ = {
+      reinterpret_cast<const MemberRecord*>(data + header.members_offset),
+      header.member_count};
+  type_archive.strings_ = {data + header.strings_offset, header.strings_size};
+  if (!type_archive.HasValidIndices()) {
+    return absl::DataLossError("Corrupt type archive references");
+  }
+  type_archive.buffer_ = std::move(buffer);
+  return type_archive;
+}
+
+bool TypeArchive::HasValidIndices() const {
+  auto is_node = [this](uint32_t index) { return index < nodes_.size(); };
+  auto is_node_or_none = [this](uint32_t index) {
+    return index == archive::kNoIndex || index < nodes_.size();
+  };
+
+  for (const NodeRecord& node : nodes_) {
+    if (node.kind > static_cast<uint8_t>(models::NodeKind::kFunction) ||
+        !is_node_or_none(node.type) ||
+        uint64_t{node.first_member} + node.member_count > members_.size())
+      return false;
+  }
+  for (const MemberRecord& member : members_) {
+    if (!is_node_or_none(member.type))
+      return false;
+  }
+  for (const NameEntry& entry : names_) {
+    if (!is_node(entry.node))
+      return false;
+  }
+  if (!std::ranges::all_of(by_stable_id_, is_node) ||
+      !std::ranges::all_of(users_, is_node)) {
+    return false;
+  }
+  if (!std::ranges::all_of(buckets_, [this](uint32_t first) {
+        return first == archive::kNoIndex || first < names_.size();
+      })) {
+    return false;
+  }
+  for (const LayoutRecord& layout : layouts_) {
+    if (!is_node(layout.node) || layout.target >= targets_.size() ||
+        uint64_t{layout.first_field} + layout.field_count >
+            layout_fields_.size())
+      return false;
+  }
+  // Each record's layouts are found by binary search, and its users run from
+  // its offset to the next one's.
+  return std::ranges::is_sorted(layouts_, {}, &LayoutRecord::node) &&
+         (user_offsets_.empty() ||
+          (std::ranges::is_sorted(user_offsets_) &&
+           user_offsets_.back() <= users_.size()));
+}
+
+std::string_view TypeArchive::bytes() const {
+  return {buffer_->getBufferStart(), buffer_->getBufferSize()};
+}
+
+std::span<const archive::MemberRecord> TypeArchive::MembersOf(
+    const archive::NodeRecord& node) const {
+  if (uint64_t{node.first_member} + node.member_count > members_.size())
+    return {};
+  return members_.subspan(node.first_member, node.member_count);
+}
+
+std::string_view TypeArchive::String(uint32_t offset) const {
+  if (offset >= strings_.size())
+    return {};
+  return strings_.data() + offset;
+}
+
+std::optional<uint32_t> TypeArchive::IndexOf(TypeId type_id) const {
+  auto it = std::ranges::lower_bound(nodes_, type_id, {}, &NodeRecord::id);
+  if (it == nodes_.end() || it->id != type_id)
+    return std::nullopt;
+  return static_cast<uint32_t>(it - nodes_.begin());
+}
+
+std::span<const archive::NameEntry> TypeArchive::FindByName(
+    std::string_view qualified_name) const {
+  if (buckets_.empty())
+    return {};
+  const uint64_t mask = buckets_.size() - 1;
+  // The table is at most half full, so probing ends at an empty bucket well
+  // before it wraps around; the bound only guards against corrupt archives.
+  uint64_t bucket = HashName(qualified_name) & mask;
+  for (size_t probes = 0; probes < buckets_.size(); ++probes) {
+    const uint32_t first = buckets_[bucket];
+    if (first >= names_.size())
+      return {};
+    if (String(names_[first].qualified_name) == qualified_name) {
+      size_t last = first + 1;
+      while (last < names_.size() &&
+             names_[last].qualified_name == names_[first].qualified_name)
+        ++last;
+      return names_.subspan(first, last - first);
+    }
+    bucket = (bucket + 1) & mask;
+  }
+  return {};
+}
+
+std::span<const archive::NameEntry> TypeArchive::FindByPrefix(
+    std::string_view prefix) const {
+  auto name_of = [this](const archive::NameEntry& entry) {
+    return String(entry.qualified_name);
+  };
+  auto first = std::ranges::lower_bound(names_, prefix, {}, name_of);
+  auto last = std::ranges::upper_bound(
+      first, names_.end(), prefix,
+      [](std::string_view prefix, std::string_view name) {
+        return name.substr(0, prefix.size()) > prefix;
+      },
+      name_of);
+  return {first, last};
+}
+
+std::optional<uint64_t> TypeArchive::StableIdAt(uint32_t index) const {
+  if (index >= stable_ids_.size())
+    return std::nullopt;
+  return stable_ids_[index];
+}
+
+std::optional<uint32_t> TypeArchive::IndexOfStableId(
+    uint64_t stable_id) const {
+  auto id_of = [this](uint32_t index) { return stable_ids_[index]; };
+  auto it = std::ranges::lower_bound(by_stable_id_, stable_id, {}, id_of);
+  if (it == by_stable_id_.end() || id_of(*it) != stable_id)
+    return std::nullopt;
+  return *it;
+}
+
+std::span<const uint32_t> TypeArchive::UsersOf(uint32_t index) const {
+  if (uint64_t{index} + 1 >= user_offsets_.size())
+    return {};
+  const uint32_t first = user_offsets_[index];
+  return users_.subspan(first, user_offsets_[index + 1] - first);
+}
+
+std::vector<uint32_t> TypeArchive::Closure(
+    std::span<const uint32_t> roots) const {
+  std::vector<bool> reached(nodes_.size());
+  std::vector<uint32_t> closure;
+  std::vector<uint32_t> pending;
+  auto visit = [&](uint32_t index) {
+    if (index < nodes_.size() && !reached[index]) {
+      reached[index] = true;
+      pending.push_back(index);
+    }
+  };
+  for (uint32_t root : roots)
+    visit(root);
+  while (!pending.empty()) {
+    const uint32_t index = pending.back();
+    pending.pop_back();
+    closure.push_back(index);
+    visit(nodes_[index].type);
+    for (const MemberRecord& member : MembersOf(nodes_[index]))
+      visit(member.type);
+  }
+  std::ranges::sort(closure);
+  return closure;
+}
+
+TypeRegistry TypeArchive::ToRegistry() const {
+  return CopyToRegistry(std::views::iota(uint32_t{0},
+                                         static_cast<uint32_t>(nodes_.size())));
+}
+
+TypeRegistry TypeArchive::ToRegistry(std::span<const uint32_t> indices) const {
+  return CopyToRegistry(indices);
+}
+
+template <typename Indices>
+TypeRegistry TypeArchive::CopyToRegistry(const Indices& indices) const {
+  auto id_at = [this](uint32_t index) {
+    return index < nodes_.size() ? RegistryId(index) : kInvalidTypeId;
+  };
+
+  TypeRegistry registry;
+  if (!targets_.empty()) {
+    std::vector<std::string> targets;
+    for (uint32_t offset : targets_)
+      targets.emplace_back(String(offset));
+    registry.SetTargets(std::move(targets));
+  }
+  auto intern = [&](uint32_t offset) {
+    return registry.Intern(String(offset));
+  };
+  // Reused between nodes; the registry copies lists into its own storage.
+  std::vector<models::RecordField> fields;
+  std::vector<models::FunctionArgument> args;
+  std::vector<models::EnumConstant> constants;
+  std::vector<StringId> param_names;
+
+  for (uint32_t index : indices) {
+    if (index >= nodes_.size())
+      continue;
+    const NodeRecord& record = nodes_[index];
+    const TypeId type_id = RegistryId(index);
+    const auto members = MembersOf(record);
+    const bool is_packed = record.flags & archive::kPacked;
+    const bool is_anonymous = record.flags & archive::kAnonymous;
+    const bool is_complete = record.flags & archive::kComplete;
+
+    auto add_fields = [&] {
+      fields.clear();
+      for (const auto& member : members) {
+        fields.push_back(models::RecordField{
+            .name = intern(member.name),
+            .type = id_at(member.type),
+            .offset_bits = static_cast<uint32_t>(member.value),
+            .bit_width = static_cast<uint32_t>(member.value >> 32)});
+      }
+      return registry.AddList<models::RecordField>(fields);
+    };
+
+    switch (static_cast<models::NodeKind>(record.kind)) {
+      case models::NodeKind::kPrimitive:
+        registry.Insert(type_id,
+                        models::Primitive{
+                            .primitive = intern(record.name),
+                            .size_bits = record.size,
+                            .is_signed = static_cast<bool>(record.flags &
+                                                           archive::kSigned)});
+        break;
+      case models::NodeKind::kPointer:
+        registry.Insert(type_id, models::Pointer{.inner = id_at(record.type)});
+        break;
+      case models::NodeKind::kReference:
+        registry.Insert(type_id,
+                        models::Reference{.inner = id_at(record.type)});
+        break;
+      case models::NodeKind::kSymbolicReference:
+        registry.Insert(type_id,
+                        models::SymbolicReference{.inner = id_at(record.type)});
+        break;
+      case models::NodeKind::kFunction: {
+        args.clear();
+        for (const auto& member : members) {
+          args.push_back(models::FunctionArgument{
+              .name = intern(member.name), .type = id_at(member.type)});
+        }
+        registry.Insert(
+            type_id,
+            models::Function{
+                .ret_type = id_at(record.type),
+                .args = registry.AddList<models::FunctionArgument>(args),
+                .is_variadic =
+                    static_cast<bool>(record.flags & archive::kVariadic)});
+        break;
+      }
+      case models::NodeKind::kStructDeclaration:
+        registry.Insert(type_id,
+                        models::StructDecl{
+                            .name = intern(record.name),
+                            .qualified_name = intern(record.qualified_name),
+                            .fields = add_fields(),
+                            .size_bytes = record.size,
+                            .is_packed = is_packed,
+                            .is_anonymous = is_anonymous,
+                            .is_complete = is_complete});
+        break;
+      case models::NodeKind::kUnionDeclaration:
+        registry.Insert(type_id,
+                        models::UnionDecl{
+                            .name = intern(record.name),
+                            .qualified_name = intern(record.qualified_name),
+                            .fields = add_fields(),
+                            .size_bytes = record.size,
+                            .is_packed = is_packed,
+                            .is_anonymous = is_anonymous,
+                            .is_complete = is_complete});
+        break;
+      case models::NodeKind::kEnumDeclaration: {
+        constants.clear();
+        for (const auto& member : members) {
+          constants.push_back(models::EnumConstant{
+              .name = intern(member.name),
+              .value = static_cast<int64_t>(member.value)});
+        }
+        registry.Insert(
+            type_id,
+            models::EnumDecl{
+                .name = intern(record.name),
+                .qualified_name = intern(record.qualified_name),
+                .underlying = id_at(record.type),
+                .constants = registry.AddList<models::EnumConstant>(constants),
+                .size_bytes = record.size,
+                .is_anonymous = is_anonymous});
+        break;
+      }
+      case models::NodeKind::kTypedefDeclaration:
+        registry.Insert(type_id,
+                        models::TypedefDecl{
+                            .name = intern(record.name),
+                            .qualified_name = intern(record.qualified_name),
+                            .underlying = id_at(record.type)});
+        break;
+      case models::NodeKind::kFunctionDeclaration: {
+        param_names.clear();
+        for (const auto& member : members)
+          param_names.push_back(intern(member.name));
+        registry.Insert(
+            type_id,
+            models::FunctionDecl{
+                .name = intern(record.name),
+                .qualified_name = intern(record.qualified_name),
+                .type = id_at(record.type),
+                .param_names =
+                    registry.AddList<StringId>(param_names)});
+        break;
+      }
+    }
+
+    if (target_masks_.empty())
+      continue;
+    // Masks are only stored where they differ from the default.
+    if (target_masks_[index] != registry.TargetMask(type_id))
+      registry.SetTargetMask(type_id, target_masks_[index]);
+    for (const LayoutRecord& layout : std::ranges::equal_range(
+             layouts_, index, {}, &LayoutRecord::node)) {
+      const auto fields =
+          layout_fields_.subspan(layout.first_field, layout.field_count);
+      registry.AddTargetLayout(
+          type_id,
+          models::TargetLayout{
+              .target = layout.target,
+              .size = layout.size,
+              .is_signed = static_cast<bool>(layout.flags & archive::kSigned),
+              .field_offsets_bits = {fields.begin(), fields.end()}});
+    }
+  }
+  return registry;
+}
+
+}  // namespace typesynth
@@ -0,0 +1,286 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TYPE_ARCHIVE_H
+#define TYPE_ARCHIVE_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+#include "type_registry.h"
+
+namespace llvm {
+class MemoryBuffer;
+class raw_ostream;
+}  // namespace llvm
+
+namespace typesynth {
+
+// On-disk layout of a type archive. All integers are little-endian and all
+// offsets are relative to the start of the file:
+//
+//   ArchiveHeader
+//   NodeRecord[node_count]       sorted by type id
+//   MemberRecord[member_count]   fields, arguments, enumerators, parameters
+//   uint64_t[node_count]         target mask of each record
+//   NameEntry[name_count]        named declarations, sorted by qualified name
+//   uint64_t[node_count]         stable id of each record
+//   uint32_t[node_count]         record indices, sorted by stable id
+//   uint32_t[node_count + 1]     start of each record's users
+//   uint32_t[user_count]         record indices of the users
+//   uint32_t[bucket_count]       hash table of the first NameEntry of a name
+//   LayoutRecord[layout_count]   per-target layouts, sorted by record index
+//   uint32_t[layout_field_count] field offsets of the layouts
+//   uint32_t[target_count]       target triples, as string table offsets
+//   string table                 NUL-terminated strings; offset 0 is ""
+//
+// Nodes refer to each other by record index rather than by type id, so a
+// reader can follow references in place without any lookup structure. The
+// sections from the names to the buckets make up the index, and are empty,
+// with zero offsets, in archives written without one. The target masks,
+// layouts and triples hold the target tables of a multi-target registry, see
+// TypeRegistry::targets, and are empty for a registry of one target.
+namespace archive {
+
+inline constexpr char kMagic[4] = {'T', 'S', 'A', 'R'};
+// Version 3 added the target tables.
+inline constexpr uint32_t kVersion = 3;
+inline constexpr uint32_t kNoIndex = UINT32_MAX;
+
+enum NodeFlags : uint8_t {
+  kPacked = 1 << 0,
+  kAnonymous = 1 << 1,
+  kComplete = 1 << 2,
+  kVariadic = 1 << 3,
+  kSigned = 1 << 4,
+};
+
+struct ArchiveHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t node_count;
+  uint32_t member_count;
+  uint64_t nodes_offset;
+  uint64_t members_offset;
+  uint64_t strings_offset;
+  uint64_t strings_size;
+  uint32_t name_count;
+  uint32_t bucket_count;
+  uint64_t names_offset;
+  uint64_t stable_ids_offset;
+  uint64_t by_stable_id_offset;
+  uint64_t user_offsets_offset;
+  uint64_t users_offset;
+  uint64_t buckets_offset;
+  uint32_t user_count;
+  uint32_t reserved;
+  uint64_t target_masks_offset;
+  uint64_t layouts_offset;
+  uint64_t layout_fields_offset;
+  uint64_t targets_offset;
+  uint32_t target_count;
+  uint32_t layout_count;
+  uint32_t layout_field_count;
+  uint32_t reserved2;
+};
+
+struct NodeRecord {
+  TypeId id;
+  uint8_t kind;  // models::NodeKind
+  uint8_t flags;
+  uint16_t reserved;
+  uint32_t name;
+  uint32_t qualified_name;
+  // Pointee, return type, underlying type or prototype, by record index.
+  uint32_t type;
+  // In bytes for declarations, in bits for primitives.
+  uint32_t size;
+  uint32_t first_member;
+  uint32_t member_count;
+};
+
+struct MemberRecord {
+  uint32_t name;
+  // Record index of the member's type; kNoIndex for enumerators and
+  // parameter names.
+  uint32_t type;
+  // Fields: offset in bits, with the bit-field width in the upper half.
+  // Enumerators: the value.
+  uint64_t value;
+};
+
+// Layout of a record on a target where it differs from its NodeRecord's.
+struct LayoutRecord {
+  uint32_t node;
+  // Index into the target triples.
+  uint32_t target;
+  // As in NodeRecord.
+  uint32_t size;
+  // kSigned for primitives.
+  uint32_t flags;
+  uint32_t first_field;
+  uint32_t field_count;
+};
+
+// Entry of the name index: the qualified name of a declaration and its record
+// index.
+struct NameEntry {
+  uint32_t qualified_name;
+  uint32_t node;
+};
+
+static_assert(sizeof(ArchiveHeader) == 160);
+static_assert(sizeof(NodeRecord) == 32);
+static_assert(sizeof(MemberRecord) == 16);
+static_assert(sizeof(LayoutRecord) == 24);
+static_assert(sizeof(NameEntry) == 8);
+
+}  // namespace archive
+
+// Writes `registry` as a type archive, target tables included. The index costs
+// a sort of the names and of the references, and the stable ids, which
+// archives that are only read back whole can do without.
+void WriteTypeArchive(const TypeRegistry& registry, llvm::raw_ostream& os,
+                      bool with_index = true);
+
+// Writes `registry` as a type archive to `path`, replacing it atomically.
+absl::Status WriteTypeArchive(const TypeRegistry& registry,
+                              const std::string& path, bool with_index = true);
+
+// Read-only view of a type archive. The file is memory-mapped and every
+// accessor reads straight from the mapping; nothing is deserialized up front.
+class TypeArchive {
+ public:
+  static absl::StatusOr<TypeArchive> Open(const std::string& path);
+  static absl::StatusOr<TypeArchive> FromBuffer(
+      std::unique_ptr<llvm::MemoryBuffer> buffer);
+
+  TypeArchive(TypeArchive&&) noexcept;
+  TypeArchive& operator=(TypeArchive&&) noexcept;
+  ~TypeArchive();
+
+  // The whole archive, laid out as described in the archive namespace.
+  [[nodiscard]] std::string_view bytes() const;
+
+  [[nodiscard]] std::span<const archive::NodeRecord> nodes() const {
+    return nodes_;
+  }
+
+  // Members of `node`; empty if the record points outside the archive.
+  [[nodiscard]] std::span<const archive::MemberRecord> MembersOf(
+      const archive::NodeRecord& node) const;
+
+  // Resolves a string table offset; empty if it is out of range.
+  [[nodiscard]] std::string_view String(uint32_t offset) const;
+
+  // Finds the record index of a type id.
+  [[nodiscard]] std::optional<uint32_t> IndexOf(TypeId type_id) const;
+
+  // Whether the archive was written with an index. Without one, the lookups
+  // below find nothing.
+  [[nodiscard]] bool has_index() const { return !user_offsets_.empty(); }
+
+  // Named declarations whose qualified name is `qualified_name`, found by
+  // hash. There are several when declarations of different kinds, or
+  // conflicting definitions, share the name.
+  [[nodiscard]] std::span<const archive::NameEntry> FindByName(
+      std::string_view qualified_name) const;
+
+  // Named declarations whose qualified name starts with `prefix`, in name
+  // order. A prefix ending in "::" finds what is declared in a namespace or
+  // nested in a record.
+  [[nodiscard]] std::span<const archive::NameEntry> FindByPrefix(
+      std::string_view prefix) const;
+
+  // The StableTypeIds id of the record at `index`.
+  [[nodiscard]] std::optional<uint64_t> StableIdAt(uint32_t index) const;
+
+  // Finds the record index of a stable id.
+  [[nodiscard]] std::optional<uint32_t> IndexOfStableId(
+      uint64_t stable_id) const;
+
+  // Record indices of the records that refer to the one at `index` directly,
+  // in index order: a pointer uses its pointee, a struct its fields' types and
+  // a function declaration its prototype. References through a symbolic
+  // reference count as references to the declaration it names.
+  [[nodiscard]] std::span<const uint32_t> UsersOf(uint32_t index) const;
+
+  // Record indices of the records reachable from those at `roots`, roots
+  // included, in index order.
+  [[nodiscard]] std::vector<uint32_t> Closure(
+      std::span<const uint32_t> roots) const;
+
+  // The type id ToRegistry gives the record at `index`. Records are numbered
+  // from 1 in index order, which keeps the order of the ids they were written
+  // with but not the ids themselves, so that no archive can make the registry
+  // allocate a slot per id up to a huge one.
+  [[nodiscard]] static TypeId RegistryId(uint32_t index) { return index + 1; }
+
+  // Copies the archive's contents, target tables included, into a registry,
+  // with the ids above.
+  [[nodiscard]] TypeRegistry ToRegistry() const;
+
+  // Same, for the records at `indices` only. References to other records are
+  // left dangling, so `indices` is normally a Closure.
+  [[nodiscard]] TypeRegistry ToRegistry(
+      std::span<const uint32_t> indices) const;
+
+ private:
+  TypeArchive() = default;
+
+  // Whether every record index stored in the archive points at a record, and
+  // every index into the members, names and users lies within them, so that
+  // the accessors can follow them without checks.
+  [[nodiscard]] bool HasValidIndices() const;
+
+  template <typename Indices>
+  TypeRegistry CopyToRegistry(const Indices& indices) const;
+
+  std::unique_ptr<llvm::MemoryBuffer> buffer_;
+  std::span<const archive::NodeRecord> nodes_;
+  std::span<const archive::MemberRecord> members_;
+  std::span<const uint64_t> target_masks_;
+  std::span<const archive::LayoutRecord> layouts_;
+  std::span<const uint32_t> layout_fields_;
+  std::span<const uint32_t> targets_;
+  std::string_view strings_;
+  std::span<const archive::NameEntry> names_;
+  std::span<const uint64_t> stable_ids_;
+  std::span<const uint32_t> by_stable_id_;
+  std::span<const uint32_t> user_offsets_;
+  std::span<const uint32_t> users_;
+  std::span<const uint32_t> buckets_;
+};
+
+}  // namespace typesynth
+
+#endif  //TYPE_ARCHIVE_H
@@ -0,0 +1,146 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "type_registry.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace typesynth {
+
+uint64_t TypeRegistry::TargetMask(TypeId type_id) const {
+  if (auto it = target_masks_.find(type_id); it != target_masks_.end())
+    return it->second;
+  return targets_.size() >= 64 ? ~uint64_t{0}
+                               : (uint64_t{1} << targets_.size()) - 1;
+}
+
+void TypeRegistry::SetTargetMask(TypeId type_id, uint64_t mask) {
+  target_masks_[type_id] = mask;
+}
+
+std::span<const models::TargetLayout> TypeRegistry::TargetLayouts(
+    TypeId type_id) const {
+  if (auto it = target_layouts_.find(type_id); it != target_layouts_.end())
+    return it->second;
+  return {};
+}
+
+void TypeRegistry::AddTargetLayout(TypeId type_id,
+                                   models::TargetLayout layout) {
+  target_layouts_[type_id].push_back(std::move(layout));
+}
+
+void TypeRegistry::Merge(const TypeRegistry& other) {
+  MergeNodes(other, other);
+}
+
+void TypeRegistry::MergeReachable(const TypeRegistry& other,
+                                  std::span<const TypeId> roots) {
+  std::vector<bool> reached(other.slots_.size());
+  std::vector<TypeId> ids;
+  std::vector<TypeId> pending(roots.begin(), roots.end());
+  while (!pending.empty()) {
+    const TypeId type_id = pending.back();
+    pending.pop_back();
+    if (!other.Contains(type_id) || reached[type_id])
+      continue;
+    reached[type_id] = true;
+    ids.push_back(type_id);
+    other.ForEachReference(type_id,
+                           [&](TypeId ref) { pending.push_back(ref); });
+  }
+  // Keep the relative order of `other`'s ids.
+  std::sort(ids.begin(), ids.end());
+  MergeNodes(other, ids);
+}
+
+template <typename Ids>
+void TypeRegistry::MergeNodes(const TypeRegistry& other, const Ids& ids) {
+  if (size_ == 0)
+    targets_ = other.targets_;
+
+  // Ids are remapped lazily so that references to ids `other` reserved but
+  // never populated still receive a consistent new id.
+  std::unordered_map<TypeId, TypeId> remapped;
+  remapped.reserve(other.size());
+  auto remap = [&](TypeId old_id) -> TypeId {
+    if (old_id == kInvalidTypeId)
+      return kInvalidTypeId;
+    auto [it, inserted] = remapped.try_emplace(old_id, 0);
+    if (inserted)
+      it->second = NewId();
+    return it->second;
+  };
+
+  // Each of `other`'s strings is interned here at most once.
+  constexpr StringId kUnmapped = UINT32_MAX;
+  std::vector<StringId> string_ids(other.strings_.size(), kUnmapped);
+  auto string_id = [&](StringId old_id) {
+    StringId& new_id = string_ids[old_id];
+    if (new_id == kUnmapped)
+      new_id = Intern(other.String(old_id));
+    return new_id;
+  };
+
+  for (TypeId old_id : ids) {
+    const TypeId new_id = remap(old_id);
+    other.Visit(old_id, [&]<typename T>(const T& n) {
+      Insert(new_id, Import(other, n, string_id));
+    });
+    ForEachReferenceImpl(*this, new_id, [&](TypeId& ref) { ref = remap(ref); });
+    if (auto it = other.target_masks_.find(old_id);
+        it != other.target_masks_.end()) {
+      target_masks_[new_id] = it->second;
+    }
+    if (auto it = other.target_layouts_.find(old_id);
+        it != other.target_layouts_.end()) {
+      target_layouts_[new_id] = it->second;
+    }
+  }
+}
+
+void TypeRegistry::ReplaceTypes(
+    const std::unordered_map<TypeId, TypeId>& replacements) {
+  if (replacements.empty())
+    return;
+
+  for (const auto& [replaced, replacement] : replacements) {
+    if (Contains(replaced)) {
+      slots_[replaced].index = kEmpty;
+      --size_;
+    }
+    target_masks_.erase(replaced);
+    target_layouts_.erase(replaced);
+  }
+
+  for (TypeId type_id : *this) {
+    ForEachReferenceImpl(*this, type_id, [&](TypeId& ref) {
+      if (auto it = replacements.find(ref); it != replacements.end())
+        ref = it->second;
+    });
+  }
+}
+
+}  // namespace typesynth
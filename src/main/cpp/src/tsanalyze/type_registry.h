@@ -0,0 +1,405 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TYPE_REGISTRY_H
+#define TYPE_REGISTRY_H
+
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <llvm/Support/ErrorHandling.h>
+
+#include "models.h"
+#include "string_pool.h"
+
+namespace typesynth {
+
+// Owns the type nodes extracted from one or more translation units, along
+// with the allocator for their ids.
+//
+// Nodes are stored struct-of-arrays style: one contiguous array per kind, plus
+// a table indexed by TypeId that says which array holds a node and where. The
+// fields, arguments, enumerators and parameter names of all nodes share one
+// array per element type, and strings are interned in a pool the registry
+// owns, so each distinct name is stored once and a node never allocates on its
+// own. Replaced and removed nodes keep their storage until the registry is
+// destroyed.
+class TypeRegistry {
+ public:
+  TypeRegistry() = default;
+  TypeRegistry(TypeRegistry&&) noexcept = default;
+  TypeRegistry& operator=(TypeRegistry&&) noexcept = default;
+  // A copy's strings would point into this registry's arena; use Merge.
+  TypeRegistry(const TypeRegistry&) = delete;
+  TypeRegistry& operator=(const TypeRegistry&) = delete;
+
+  // Reserves a fresh id. The caller is expected to eventually insert a node
+  // carrying it.
+  TypeId NewId() {
+    slots_.emplace_back();
+    return static_cast<TypeId>(slots_.size() - 1);
+  }
+
+  // Stores `node` under `type_id`, replacing any node already stored there.
+  // Its strings must come from Intern, and its lists from AddList, on this
+  // registry.
+  template <typename T>
+  void Insert(TypeId type_id, const T& node);
+
+  // Copies `items` to the end of the shared array for their type. `items`
+  // must not point into this registry.
+  template <typename T>
+  [[nodiscard]] models::ListRef<T> AddList(std::span<const T> items);
+
+  template <typename T>
+  [[nodiscard]] std::span<const T> List(models::ListRef<T> list) const {
+    return std::span<const T>(Items<T>()).subspan(list.offset, list.size);
+  }
+
+  StringId Intern(std::string_view value) { return strings_.Intern(value); }
+
+  [[nodiscard]] std::string_view String(StringId id) const {
+    return strings_.Get(id);
+  }
+
+  [[nodiscard]] const StringPool& strings() const { return strings_; }
+
+  [[nodiscard]] bool Contains(TypeId type_id) const {
+    return type_id < slots_.size() && slots_[type_id].index != kEmpty;
+  }
+
+  // The kind of a node the registry contains.
+  [[nodiscard]] models::NodeKind kind(TypeId type_id) const {
+    return slots_[type_id].kind;
+  }
+
+  // Returns the node stored under `type_id` if it is a `T`.
+  template <typename T>
+  [[nodiscard]] const T* Get(TypeId type_id) const {
+    if (!Contains(type_id) || kind(type_id) != models::kKindOf<T>)
+      return nullptr;
+    return &Nodes<T>()[slots_[type_id].index];
+  }
+
+  // Invokes `fn` with the node stored under `type_id`, which must exist, as a
+  // const reference to its record type.
+  template <typename Fn>
+  decltype(auto) Visit(TypeId type_id, Fn&& fn) const {
+    return VisitImpl(*this, type_id, std::forward<Fn>(fn));
+  }
+
+  // Invokes `fn` on each type id that the node stored under `type_id` refers
+  // to, in a stable order.
+  template <typename Fn>
+  void ForEachReference(TypeId type_id, Fn&& fn) const {
+    ForEachReferenceImpl(*this, type_id, [&fn](TypeId ref) { fn(ref); });
+  }
+
+  [[nodiscard]] size_t size() const { return size_; }
+
+  // One past the largest id handed out so far. Merge hands out ids in
+  // increasing order.
+  [[nodiscard]] TypeId id_bound() const {
+    return static_cast<TypeId>(slots_.size());
+  }
+
+  // The target triples of a registry that combines the analyses of several
+  // targets, see CombineTargets; empty otherwise. Nodes then carry their
+  // layout on the first target they exist on, and the tables below tell
+  // where else they exist and how they are laid out there.
+  [[nodiscard]] const std::vector<std::string>& targets() const {
+    return targets_;
+  }
+  void SetTargets(std::vector<std::string> targets) {
+    targets_ = std::move(targets);
+  }
+
+  // Bit i is set if `type_id` exists on targets()[i]. Types exist on every
+  // target unless set otherwise.
+  [[nodiscard]] uint64_t TargetMask(TypeId type_id) const;
+  void SetTargetMask(TypeId type_id, uint64_t mask);
+
+  // Layouts of `type_id` on the targets where it differs from its node's.
+  [[nodiscard]] std::span<const models::TargetLayout> TargetLayouts(
+      TypeId type_id) const;
+  void AddTargetLayout(TypeId type_id, models::TargetLayout layout);
+
+  // Copies every node of `other` into this registry, along with its target
+  // tables. Ids of `other` are renumbered so they cannot collide with ids
+  // already handed out here. Both registries must be for the same targets,
+  // unless this one is still empty.
+  void Merge(const TypeRegistry& other);
+
+  // Like Merge, but only copies the nodes of `other` reachable from `roots`.
+  void MergeReachable(const TypeRegistry& other, std::span<const TypeId> roots);
+
+  // Removes every node keyed in `replacements` and redirects references to it
+  // towards the node it maps to.
+  void ReplaceTypes(const std::unordered_map<TypeId, TypeId>& replacements);
+
+  // Iterates over the ids of the nodes in the registry, in increasing order.
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = TypeId;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const TypeId*;
+    using reference = TypeId;
+
+    Iterator() = default;
+    Iterator(const TypeRegistry* registry, TypeId type_id)
+        : registry_(registry), type_id_(type_id) {
+      SkipEmpty();
+    }
+
+    TypeId operator*() const { return type_id_; }
+    Iterator& operator++() {
+      ++type_id_;
+      SkipEmpty();
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator previous = *this;
+      ++*this;
+      return previous;
+    }
+    bool operator==(const Iterator& other) const {
+      return type_id_ == other.type_id_;
+    }
+
+   private:
+    void SkipEmpty() {
+      while (type_id_ < registry_->slots_.size() &&
+             !registry_->Contains(type_id_)) {
+        ++type_id_;
+      }
+    }
+
+    const TypeRegistry* registry_ = nullptr;
+    TypeId type_id_ = 0;
+  };
+
+  [[nodiscard]] Iterator begin() const { return Iterator(this, 0); }
+  [[nodiscard]] Iterator end() const {
+    return Iterator(this, static_cast<TypeId>(slots_.size()));
+  }
+
+ private:
+  static constexpr uint32_t kEmpty = UINT32_MAX;
+
+  struct Slot {
+    models::NodeKind kind = models::NodeKind::kPrimitive;
+    // Position in the array for `kind`; kEmpty when no node is stored.
+    uint32_t index = kEmpty;
+  };
+
+  template <typename T>
+  std::vector<T>& Nodes() {
+    return std::get<std::vector<T>>(nodes_);
+  }
+  template <typename T>
+  const std::vector<T>& Nodes() const {
+    return std::get<std::vector<T>>(nodes_);
+  }
+  template <typename T>
+  std::vector<T>& Items() {
+    return std::get<std::vector<T>>(lists_);
+  }
+  template <typename T>
+  const std::vector<T>& Items() const {
+    return std::get<std::vector<T>>(lists_);
+  }
+
+  // Copies the nodes of `other` under `ids`, in order.
+  template <typename Ids>
+  void MergeNodes(const TypeRegistry& other, const Ids& ids);
+
+  // Returns `node`, taken from `other`, with its lists copied over and its
+  // strings translated by `string_id`.
+  template <typename T, typename StringFn>
+  T Import(const TypeRegistry& other, T node, StringFn&& string_id);
+
+  // Shared by the const and mutable visitors; `self` is a possibly-const
+  // registry.
+  template <typename Self, typename Fn>
+  static decltype(auto) VisitImpl(Self& self, TypeId type_id, Fn&& fn);
+  template <typename Self, typename Fn>
+  static void ForEachReferenceImpl(Self& self, TypeId type_id, Fn&& fn);
+
+  // Indexed by TypeId; slot 0 stands for kInvalidTypeId and stays empty.
+  std::vector<Slot> slots_ = std::vector<Slot>(1);
+  size_t size_ = 0;
+  std::tuple<std::vector<models::StructDecl>, std::vector<models::UnionDecl>,
+             std::vector<models::EnumDecl>, std::vector<models::TypedefDecl>,
+             std::vector<models::FunctionDecl>, std::vector<models::Pointer>,
+             std::vector<models::Reference>, std::vector<models::Primitive>,
+             std::vector<models::SymbolicReference>,
+             std::vector<models::Function>>
+      nodes_;
+  std::tuple<std::vector<models::RecordField>,
+             std::vector<models::FunctionArgument>,
+             std::vector<models::EnumConstant>, std::vector<StringId>>
+      lists_;
+  StringPool strings_;
+  std::vector<std::string> targets_;
+  std::unordered_map<TypeId, uint64_t> target_masks_;
+  std::unordered_map<TypeId, std::vector<models::TargetLayout>>
+      target_layouts_;
+};
+
+template <typename T>
+void TypeRegistry::Insert(TypeId type_id, const T& node) {
+  if (type_id >= slots_.size())
+    slots_.resize(type_id + 1);
+
+  Slot& slot = slots_[type_id];
+  std::vector<T>& nodes = Nodes<T>();
+  if (slot.index != kEmpty && slot.kind == models::kKindOf<T>) {
+    nodes[slot.index] = node;
+    return;
+  }
+
+  if (slot.index == kEmpty)
+    ++size_;
+  slot.kind = models::kKindOf<T>;
+  slot.index = static_cast<uint32_t>(nodes.size());
+  nodes.push_back(node);
+}
+
+template <typename T>
+models::ListRef<T> TypeRegistry::AddList(std::span<const T> items) {
+  std::vector<T>& storage = Items<T>();
+  const models::ListRef<T> list = {
+      .offset = static_cast<uint32_t>(storage.size()),
+      .size = static_cast<uint32_t>(items.size())};
+  storage.reserve(storage.size() + items.size());
+  for (const T& item : items)
+    storage.push_back(item);
+  return list;
+}
+
+template <typename T, typename StringFn>
+T TypeRegistry::Import(const TypeRegistry& other, T node,
+                       StringFn&& string_id) {
+  auto import_list = [&]<typename Item>(models::ListRef<Item> list) {
+    const models::ListRef<Item> copy = AddList(other.List(list));
+    for (Item& item :
+         std::span<Item>(Items<Item>()).subspan(copy.offset, copy.size)) {
+      if constexpr (std::is_same_v<Item, StringId>)
+        item = string_id(item);
+      else
+        item.name = string_id(item.name);
+    }
+    return copy;
+  };
+
+  if constexpr (requires { node.name; })
+    node.name = string_id(node.name);
+  if constexpr (requires { node.qualified_name; })
+    node.qualified_name = string_id(node.qualified_name);
+  if constexpr (requires { node.primitive; })
+    node.primitive = string_id(node.primitive);
+  if constexpr (requires { node.fields; })
+    node.fields = import_list(node.fields);
+  if constexpr (requires { node.args; })
+    node.args = import_list(node.args);
+  if constexpr (requires { node.constants; })
+    node.constants = import_list(node.constants);
+  if constexpr (requires { node.param_names; })
+    node.param_names = import_list(node.param_names);
+  return node;
+}
+
+template <typename Self, typename Fn>
+decltype(auto) TypeRegistry::VisitImpl(Self& self, TypeId type_id, Fn&& fn) {
+  using models::NodeKind;
+  const Slot& slot = self.slots_[type_id];
+  auto& nodes = self.nodes_;
+  switch (slot.kind) {
+    case NodeKind::kStructDeclaration:
+      return fn(std::get<std::vector<models::StructDecl>>(nodes)[slot.index]);
+    case NodeKind::kUnionDeclaration:
+      return fn(std::get<std::vector<models::UnionDecl>>(nodes)[slot.index]);
+    case NodeKind::kEnumDeclaration:
+      return fn(std::get<std::vector<models::EnumDecl>>(nodes)[slot.index]);
+    case NodeKind::kTypedefDeclaration:
+      return fn(std::get<std::vector<models::TypedefDecl>>(nodes)[slot.index]);
+    case NodeKind::kFunctionDeclaration:
+      return fn(
+          std::get<std::vector<models::FunctionDecl>>(nodes)[slot.index]);
+    case NodeKind::kPointer:
+      return fn(std::get<std::vector<models::Pointer>>(nodes)[slot.index]);
+    case NodeKind::kReference:
+      return fn(std::get<std::vector<models::Reference>>(nodes)[slot.index]);
+    case NodeKind::kPrimitive:
+      return fn(std::get<std::vector<models::Primitive>>(nodes)[slot.index]);
+    case NodeKind::kSymbolicReference:
+      return fn(
+          std::get<std::vector<models::SymbolicReference>>(nodes)[slot.index]);
+    case NodeKind::kFunction:
+      return fn(std::get<std::vector<models::Function>>(nodes)[slot.index]);
+  }
+  llvm_unreachable("Unknown node kind");
+}
+
+template <typename Self, typename Fn>
+void TypeRegistry::ForEachReferenceImpl(Self& self, TypeId type_id, Fn&& fn) {
+  auto items = [&self]<typename T>(models::ListRef<T> list) {
+    auto& storage = std::get<std::vector<T>>(self.lists_);
+    return std::span(storage.data() + list.offset, list.size);
+  };
+
+  VisitImpl(self, type_id, [&]<typename Node>(Node& n) {
+    using T = std::remove_const_t<Node>;
+    if constexpr (std::is_same_v<T, models::Pointer> ||
+                  std::is_same_v<T, models::Reference> ||
+                  std::is_same_v<T, models::SymbolicReference>) {
+      fn(n.inner);
+    } else if constexpr (std::is_same_v<T, models::Function>) {
+      fn(n.ret_type);
+      for (auto& arg : items(n.args))
+        fn(arg.type);
+    } else if constexpr (std::is_same_v<T, models::StructDecl> ||
+                         std::is_same_v<T, models::UnionDecl>) {
+      for (auto& field : items(n.fields))
+        fn(field.type);
+    } else if constexpr (std::is_same_v<T, models::EnumDecl> ||
+                         std::is_same_v<T, models::TypedefDecl>) {
+      fn(n.underlying);
+    } else if constexpr (std::is_same_v<T, models::FunctionDecl>) {
+      fn(n.type);
+    }
+  });
+}
+
+}  // namespace typesynth
+
+#endif  //TYPE_REGISTRY_H
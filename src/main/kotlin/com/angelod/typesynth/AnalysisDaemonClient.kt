@@ -0,0 +1,179 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+package com.angelod.typesynth
+
+import com.google.gson.Gson
+import com.google.gson.JsonArray
+import com.google.gson.JsonObject
+import com.google.gson.JsonParser
+import com.sun.security.auth.module.UnixSystem
+import java.io.BufferedReader
+import java.net.StandardProtocolFamily
+import java.net.UnixDomainSocketAddress
+import java.nio.channels.Channels
+import java.nio.channels.SocketChannel
+import java.nio.file.Path
+
+/**
+ * A client of the `tsanalyzed` analysis server. The server runs clang outside the Ghidra process,
+ * so a header that crashes clang cannot take Ghidra down with it, and keeps precompiled headers,
+ * caches and worker threads warm between analyses, so that repeated analyses of the same code are
+ * fast. Each call opens a connection of its own; calls may run concurrently.
+ *
+ * Clang flags are passed to the server as they are, so include paths in them should be absolute.
+ *
+ * @param socketPath The server's socket, by default where the server listens unless told otherwise.
+ */
+class AnalysisDaemonClient(private val socketPath: Path = defaultSocketPath()) {
+
+    companion object {
+        /** Where `tsanalyzed` listens by default: `$XDG_RUNTIME_DIR`, or per user in `$TMPDIR`. */
+        fun defaultSocketPath(): Path {
+            System.getenv("XDG_RUNTIME_DIR")?.takeIf { it.isNotEmpty() }?.let {
+                return Path.of(it, "typesynth.sock")
+            }
+            val temp = System.getenv("TMPDIR")?.takeIf { it.isNotEmpty() } ?: "/tmp"
+            return Path.of(temp, "typesynth-${UnixSystem().uid}.sock")
+        }
+
+        private fun strings(values: List<String>) = JsonArray().apply { values.forEach(::add) }
+
+        private fun absolute(path: String) = Path.of(path).toAbsolutePath().toString()
+    }
+
+    private val gson = Gson()
+
+    /**
+     * Analyzes the given source files on the server and returns the types they declare.
+     *
+     * @param files The paths of the source files to analyze.
+     * @param clangFlags Clang compiler flags used for every file.
+     * @param workers How many files to analyze at once, or 0 for one per core.
+     * @param targets Target triples to analyze for, as with [AnalyzerBridge.setTargets].
+     * @param deltaFrom A type archive of an earlier analysis, as written by
+     *        [AnalyzerBridge.writeArchive]; when given, only what changed since is returned, as
+     *        with [AnalyzerBridge.delta].
+     * @param roots Functions and types to limit the analysis to, as with
+     *        [AnalyzerBridge.setExtractionFilter].
+     * @param allowFiles File globs whose declarations are roots, as with
+     *        [AnalyzerBridge.setExtractionFilter].
+     * @param onProgress Called as files are started and once more when all are done.
+     * @throws IllegalStateException if the server is unreachable, crashed, or any file could not be
+     *         analyzed.
+     */
+    fun analyze(
+        files: List<String>,
+        clangFlags: List<String>,
+        workers: Int = 0,
+        targets: List<String> = emptyList(),
+        deltaFrom: String? = null,
+        roots: List<String> = emptyList(),
+        allowFiles: List<String> = emptyList(),
+        onProgress: (AnalysisProgress) -> Unit = {},
+    ): TypeAnalysisResult {
+        val request = analyzeRequest(clangFlags, workers, targets, deltaFrom, roots, allowFiles)
+        request.add("files", strings(files.map(::absolute)))
+        return checkNotNull(exchange(request, onProgress)) { "The analysis server sent no result" }
+    }
+
+    /**
+     * Analyzes every translation unit of a compilation database on the server, as
+     * [analyze] does for source files.
+     *
+     * @param compilationDatabase A `compile_commands.json` file or the directory containing one.
+     */
+    fun analyzeProject(
+        compilationDatabase: String,
+        clangFlags: List<String> = emptyList(),
+        workers: Int = 0,
+        targets: List<String> = emptyList(),
+        deltaFrom: String? = null,
+        roots: List<String> = emptyList(),
+        allowFiles: List<String> = emptyList(),
+        onProgress: (AnalysisProgress) -> Unit = {},
+    ): TypeAnalysisResult {
+        val request = analyzeRequest(clangFlags, workers, targets, deltaFrom, roots, allowFiles)
+        request.addProperty("compilationDatabase", absolute(compilationDatabase))
+        return checkNotNull(exchange(request, onProgress)) { "The analysis server sent no result" }
+    }
+
+    /** Asks the server to shut down once the analyses it is running finish. */
+    fun shutdown() {
+        exchange(JsonObject().apply { addProperty("method", "shutdown") }) {}
+    }
+
+    private fun analyzeRequest(
+        clangFlags: List<String>,
+        workers: Int,
+        targets: List<String>,
+        deltaFrom: String?,
+        roots: List<String>,
+        allowFiles: List<String>,
+    ) = JsonObject().apply {
+        addProperty("method", "analyze")
+        add("flags", strings(clangFlags))
+        addProperty("workers", workers)
+        add("targets", strings(targets))
+        add("roots", strings(roots))
+        add("allowFiles", strings(allowFiles))
+        deltaFrom?.let { addProperty("deltaFrom", absolute(it)) }
+    }
+
+    // Sends one request and reads the events answering it, up to "done".
+    private fun exchange(
+        request: JsonObject,
+        onProgress: (AnalysisProgress) -> Unit,
+    ): TypeAnalysisResult? {
+        SocketChannel.open(StandardProtocolFamily.UNIX).use { channel ->
+            channel.connect(UnixDomainSocketAddress.of(socketPath))
+            val writer = Channels.newWriter(channel, Charsets.UTF_8)
+            writer.write(request.toString())
+            writer.write("\n")
+            writer.flush()
+
+            val reader = BufferedReader(Channels.newReader(channel, Charsets.UTF_8))
+            var result: TypeAnalysisResult? = null
+            while (true) {
+                val event = JsonParser.parseString(readLine(reader)).asJsonObject
+                when (event.get("event")?.asString) {
+                    "progress" -> onProgress(gson.fromJson(event, AnalysisProgress::class.java))
+                    "result" -> result = parseResult(
+                        JsonParser.parseString(readLine(reader)).asJsonObject
+                    )
+                    "done" -> {
+                        check(event.get("code").asInt == 0) { event.get("message").asString }
+                        return result
+                    }
+                }
+            }
+        }
+    }
+
+    // A server that is gone without finishing the request is most likely one that clang crashed.
+    private fun readLine(reader: BufferedReader): String = checkNotNull(reader.readLine()) {
+        "The analysis server closed the connection before finishing the request; " +
+            "it may have crashed"
+    }
+}
@@ -24,9 +24,31 @@
 
 package com.angelod.typesynth
 
+import com.google.gson.GsonBuilder
+import com.google.gson.JsonDeserializationContext
+import com.google.gson.JsonDeserializer
+import com.google.gson.JsonElement
+import com.google.gson.JsonObject
+import com.google.gson.JsonParseException
+import com.google.gson.JsonParser
+import java.io.ByteArrayOutputStream
+import java.io.OutputStream
+import java.lang.reflect.Type
+import java.util.concurrent.CompletableFuture
+import java.util.concurrent.ForkJoinPool
+
+// Types refer to each other by their key in TypeAnalysisResult.types. Keys derive from a type's
+// kind and qualified name, or from its contents for unnamed types, so they are the same across
+// runs.
 sealed class TSType {
     abstract val name: String
 
+    // Set in multi-target results only: the indices into TypeAnalysisResult.targets of the targets
+    // the type exists on, when it is missing on some, and its layouts on the targets where they
+    // differ from the one given by the type itself.
+    val targets: List<Int>? = null
+    val layouts: List<TargetLayout>? = null
+
     data class PrimitiveType(
         override val name: String, // int, char, float, etc.
         val sizeInBits: Int,
@@ -35,7 +57,12 @@ sealed class TSType {
 
     data class PointerType(
         override val name: String,
-        val pointeeTypeName: String // Reference by name to avoid complex object recursion over JNI
+        val pointeeType: String
+    ) : TSType()
+
+    data class ReferenceType(
+        override val name: String,
+        val referencedType: String
     ) : TSType()
 
     data class StructType(
@@ -44,6 +71,12 @@ sealed class TSType {
         val sizeInBytes: Int,
     ) : TSType()
 
+    data class UnionType(
+        override val name: String,
+        val fields: List<StructField>,
+        val sizeInBytes: Int,
+    ) : TSType()
+
     data class EnumType(
         override val name: String,
         val enumerators: List<EnumConstant>,
@@ -65,8 +98,9 @@ sealed class TSType {
 
 data class StructField(
     val name: String,
-    val typeName: String, // reference type by name
-    val offsetInBits: Int
+    val type: String,
+    val offsetInBits: Int,
+    val bitWidth: Int = 0, // zero unless the field is a bit-field
 )
 
 data class EnumConstant(
@@ -74,32 +108,453 @@ data class EnumConstant(
     val value: Long
 )
 
+// Only the members that apply to the type's kind are set.
+data class TargetLayout(
+    val target: Int, // index into TypeAnalysisResult.targets
+    val sizeInBits: Int?, // primitives
+    val signed: Boolean?, // primitives
+    val sizeInBytes: Int?, // records and enums
+    val fieldOffsetsInBits: List<Int>?, // records, one per field
+)
+
+// The version of the native document TypeAnalysisResult is read from.
+internal const val ANALYSIS_JSON_VERSION = 2
+
 data class TypeAnalysisResult(
+    val version: Int,
     val mainFile: String,
     val files: List<String>,
     val clangFlags: List<String>,
+    val targets: List<String>, // the triples of a multi-target analysis, empty otherwise
     val types: Map<String, TSType>,
+    val delta: TypeDelta? = null, // set when types only holds what changed since an earlier run
+    // Set when types only holds the closure of some roots: the keys found for each root as it was
+    // asked for, where a function stands for its prototype.
+    val roots: Map<String, List<String>>? = null,
+)
+
+// Keys of the types of a TypeAnalysisResult that replace earlier versions, and of those that are
+// gone. The result's other types are new.
+data class TypeDelta(
+    val changed: List<String>,
+    val removed: List<String>,
+)
+
+data class AnalysisProgress(
+    val unitsDone: Int,
+    val unitsTotal: Int,
+    val typesExtracted: Long, // counted before identical types are folded
+    val currentFile: String, // empty once every file is done
 )
 
-class AnalyzerBridge {
+// Wall-clock time spent in each phase of the analyses, in milliseconds, summed over worker threads.
+data class PhaseTimes(
+    val analysisCache: Double,
+    val precompiledHeaders: Double,
+    val frontend: Double, // clang's own parsing and semantic analysis
+    val extraction: Double,
+    val merge: Double,
+    val deduplication: Double,
+    val serialization: Double,
+)
+
+data class UnitMetrics(
+    val file: String,
+    val cacheHit: Boolean,
+    val totalMs: Double,
+    val frontendMs: Double,
+    val extractionMs: Double,
+    val typesCreated: Long,
+    val residentBytes: Long, // of the whole process once the file's AST was complete
+)
+
+// Accumulated over the lifetime of an AnalyzerBridge session.
+data class AnalysisMetrics(
+    val phasesMs: PhaseTimes,
+    val typesCreated: Long, // counted before identical types are folded
+    val typeIdCacheHits: Long,
+    val typeIdCacheMisses: Long,
+    val typeIdCacheHitRate: Double,
+    val analysisCacheHits: Long,
+    val analysisCacheMisses: Long,
+    val headerFragmentHits: Long, // headers whose types were reused from another file
+    val headerFragmentMisses: Long,
+    val bytesEmitted: Long,
+    val peakResidentBytes: Long,
+    val units: List<UnitMetrics>,
+)
+
+// Picks the TSType subclass named by each type's "kind".
+private object TSTypeDeserializer : JsonDeserializer<TSType> {
+    private val kinds = mapOf(
+        "PrimitiveType" to TSType.PrimitiveType::class.java,
+        "PointerType" to TSType.PointerType::class.java,
+        "ReferenceType" to TSType.ReferenceType::class.java,
+        "StructType" to TSType.StructType::class.java,
+        "UnionType" to TSType.UnionType::class.java,
+        "EnumType" to TSType.EnumType::class.java,
+        "FunctionPrototype" to TSType.FunctionPrototype::class.java,
+        "TypedefType" to TSType.TypedefType::class.java,
+    )
+
+    override fun deserialize(json: JsonElement, typeOfT: Type, context: JsonDeserializationContext): TSType {
+        val kind = json.asJsonObject.get("kind")?.asString
+        val type = kinds[kind] ?: throw JsonParseException("Unknown type kind: $kind")
+        return context.deserialize(json, type)
+    }
+}
+
+private val gson = GsonBuilder()
+    .registerTypeAdapter(TSType::class.java, TSTypeDeserializer)
+    .create()
+
+// Parses the document the native side writes for a TypeAnalysisResult. Kept out of AnalyzerBridge
+// so that reading results from the analysis server does not load the native library.
+internal fun parseResult(json: JsonObject): TypeAnalysisResult {
+    val version = json.get("version")?.asInt ?: 1
+    if (version != ANALYSIS_JSON_VERSION) {
+        throw JsonParseException("Unsupported analysis result version: $version")
+    }
+    return gson.fromJson(json, TypeAnalysisResult::class.java)
+}
+
+/**
+ * A native analyzer session. Clang's file manager, the precompiled header and analysis caches,
+ * and the accumulated types stay warm across [analyzeSourceFile] calls, so analyzing a batch of
+ * related files pays the setup cost once. Source files are assumed not to change while the
+ * session is open.
+ *
+ * @param clangFlags Clang compiler flags used for every file analyzed in this session.
+ */
+class AnalyzerBridge(clangFlags: List<String>) : AutoCloseable {
 
     companion object {
         init {
             System.loadLibrary("tsAnalysis")
         }
+
+        @JvmStatic
+        private external fun jniCreateSession(clangFlags: List<String>): Long
+
+        @JvmStatic
+        private external fun jniDestroySession(handle: Long)
+
+        @JvmStatic
+        private external fun jniAnalyzeSourceFile(handle: Long, mainFile: String)
+
+        @JvmStatic
+        private external fun jniAnalyzeAsync(handle: Long, files: List<String>, listener: AsyncAnalysis)
+
+        @JvmStatic
+        private external fun jniSetSourceBuffers(handle: Long, paths: List<String>, contents: List<ByteArray>)
+
+        @JvmStatic
+        private external fun jniSetMemoryBudget(handle: Long, bytes: Long)
+
+        @JvmStatic
+        private external fun jniSetTargets(handle: Long, targets: List<String>)
+
+        @JvmStatic
+        private external fun jniSetExtractionFilter(handle: Long, roots: List<String>, fileGlobs: List<String>)
+
+        @JvmStatic
+        private external fun jniCancel(handle: Long)
+
+        @JvmStatic
+        private external fun jniWriteResult(handle: Long, output: OutputStream)
+
+        @JvmStatic
+        private external fun jniWriteDelta(
+            handle: Long,
+            previousArchive: String,
+            output: OutputStream,
+        )
+
+        @JvmStatic
+        private external fun jniWriteArchive(handle: Long, path: String)
+
+        @JvmStatic
+        private external fun jniBuildIndex(handle: Long): Long
+
+        @JvmStatic
+        private external fun jniEnableTimeTrace(handle: Long, granularityMicros: Int)
+
+        @JvmStatic
+        private external fun jniGetMetrics(handle: Long): String
+
+        @JvmStatic
+        private external fun jniGetTimeTrace(handle: Long): String
+
+        /**
+         * Analyzes a single source file in a throwaway session.
+         *
+         * @throws IllegalStateException if the file could not be analyzed.
+         */
+        fun analyzeSourceFile(mainFile: String, clangFlags: List<String>): TypeAnalysisResult =
+            AnalyzerBridge(clangFlags).use {
+                it.analyzeSourceFile(mainFile)
+                it.result()
+            }
+
+        /**
+         * Analyzes a single source file in a throwaway session, with [buffers] mounted as by
+         * [setSourceBuffers]. [mainFile] may be one of them.
+         *
+         * @throws IllegalStateException if the file could not be analyzed.
+         */
+        fun analyzeSourceBuffers(
+            mainFile: String,
+            buffers: Map<String, String>,
+            clangFlags: List<String>,
+        ): TypeAnalysisResult =
+            AnalyzerBridge(clangFlags).use {
+                it.setSourceBuffers(buffers)
+                it.analyzeSourceFile(mainFile)
+                it.result()
+            }
     }
 
-    private external fun jniAnalyzeSourceFile(mainFile: String, clangFlags: List<String>): String
+    private val handleLock = Any()
+
+    @Volatile
+    private var handle: Long = jniCreateSession(clangFlags)
 
     /**
-     * Performs analysis on the given source file and associated clang compilation flags.
+     * Analyzes the given source file, adding its types to the ones already extracted by this
+     * session. Types extracted before an error are kept.
      *
      * @param mainFile The path to the main source file to be analyzed.
-     * @param clangFlags A list of clang compiler flags used during the analysis.
-     * @return A `TypeAnalysisResult` containing the analysis details, including associated files,
-     *         clang flags, and detected types.
+     * @throws IllegalStateException if the file could not be analyzed.
+     */
+    @Synchronized
+    fun analyzeSourceFile(mainFile: String) {
+        jniAnalyzeSourceFile(checkOpen(), mainFile)
+    }
+
+    /**
+     * Mounts in-memory files in front of the real file system for every later analysis of this
+     * session, replacing any mounted before. They can be analyzed and included like files on disk,
+     * without writing them out first.
+     *
+     * @param buffers The contents of each file, keyed by its path. Relative paths are resolved
+     *        against the process's working directory.
+     */
+    @Synchronized
+    fun setSourceBuffers(buffers: Map<String, String>) {
+        jniSetSourceBuffers(
+            checkOpen(),
+            buffers.keys.toList(),
+            buffers.values.map { it.toByteArray(Charsets.UTF_8) },
+        )
+    }
+
+    /**
+     * Caps the memory the process should use during [analyzeAsync]: files are only started while
+     * the process's resident memory plus what a file has been seen to need fits, though at least
+     * one always runs. Defaults to three quarters of physical memory, which includes the JVM's
+     * heap.
+     *
+     * @param bytes The budget, or 0 for none.
+     */
+    @Synchronized
+    fun setMemoryBudget(bytes: Long) {
+        jniSetMemoryBudget(checkOpen(), bytes)
+    }
+
+    /**
+     * Analyzes each later batch of files once per target triple, and keeps a single type graph in
+     * which types identical on every target are stored once, and the layouts that differ are listed
+     * per target; see [TypeAnalysisResult.targets]. Sources and headers are read once for all
+     * targets.
+     *
+     * @param targets Up to 64 target triples, or none to analyze for the target the clang flags
+     *        select.
+     * @throws IllegalStateException if the session already holds types for other targets.
      */
-    fun analyzeSourceFile(mainFile: String, clangFlags: List<String>): TypeAnalysisResult? {
-        return null
+    @Synchronized
+    fun setTargets(targets: List<String>) {
+        jniSetTargets(checkOpen(), targets)
     }
-}
\ No newline at end of file
+
+    /**
+     * Limits later analyses to some roots and the types they refer to, directly or not, so that
+     * the result and the time taken scale with what is imported rather than with every header the
+     * sources include. Declarations in files outside [fileGlobs] are dropped before any work is
+     * done on them, unless [roots] are named as well, which can be declared anywhere.
+     *
+     * @param roots Qualified names of the functions and types to extract, such as `CreateFileW`.
+     * @param fileGlobs Patterns such as `/opt/sdk/include/mylib/*`; every declaration of a matching
+     *        file is a root. Both empty lift the limit.
+     * @throws IllegalArgumentException if a glob is malformed.
+     */
+    @Synchronized
+    fun setExtractionFilter(roots: List<String>, fileGlobs: List<String> = emptyList()) {
+        jniSetExtractionFilter(checkOpen(), roots, fileGlobs)
+    }
+
+    /**
+     * Analyzes the given source files on native worker threads, without blocking the caller. Other
+     * calls on this session fail until the returned future completes; [cancel] stops the analysis
+     * early. Types extracted before an error or cancellation are kept.
+     *
+     * @param files The paths of the source files to analyze.
+     * @param onProgress Called on a native thread as files are started and once more when all are
+     *        done. Must not call back into this session, or [close] it.
+     * @return A future that completes on a thread of the common pool when the analysis finishes,
+     *         exceptionally with an `IllegalStateException` if any file could not be analyzed, and
+     *         cancelled if [cancel] stopped it.
+     */
+    @Synchronized
+    fun analyzeAsync(files: List<String>, onProgress: (AnalysisProgress) -> Unit = {}): CompletableFuture<Unit> {
+        val analysis = AsyncAnalysis(onProgress)
+        jniAnalyzeAsync(checkOpen(), files, analysis)
+        return analysis.future
+    }
+
+    /**
+     * Stops the analysis started by [analyzeAsync] at the next safe point. Does nothing when no
+     * analysis is running.
+     */
+    fun cancel() {
+        // Not synchronized on the session, which a running analysis may hold; handleLock only
+        // keeps the handle from being freed underneath.
+        synchronized(handleLock) {
+            if (handle != 0L) {
+                jniCancel(handle)
+            }
+        }
+    }
+
+    /**
+     * Streams every type extracted so far to [output] as JSON, in the form [result] parses.
+     */
+    @Synchronized
+    fun writeResult(output: OutputStream) {
+        jniWriteResult(checkOpen(), output)
+    }
+
+    /**
+     * @return A `TypeAnalysisResult` containing the analyzed files, clang flags, and every type
+     *         extracted so far.
+     */
+    fun result(): TypeAnalysisResult {
+        val output = ByteArrayOutputStream()
+        writeResult(output)
+        return output.toByteArray().inputStream().reader(Charsets.UTF_8).use {
+            parseResult(JsonParser.parseReader(it).asJsonObject)
+        }
+    }
+
+    /**
+     * Saves every type extracted so far to a type archive, for a later session to compare against
+     * with [delta].
+     *
+     * @throws java.io.IOException if the archive could not be written.
+     */
+    @Synchronized
+    fun writeArchive(path: String) {
+        jniWriteArchive(checkOpen(), path)
+    }
+
+    /**
+     * Streams the types that were added or changed since the analysis saved to [previousArchive]
+     * to [output], along with the keys of those that changed or were removed, in the form
+     * [delta] parses.
+     *
+     * @throws java.io.IOException if the archive could not be read.
+     */
+    @Synchronized
+    fun writeDelta(previousArchive: String, output: OutputStream) {
+        jniWriteDelta(checkOpen(), previousArchive, output)
+    }
+
+    /**
+     * @return A `TypeAnalysisResult` holding only the types that were added or changed since the
+     *         analysis saved to [previousArchive] by [writeArchive], with its `delta` listing the
+     *         changed and removed ones, so that a data type manager can be updated in proportion
+     *         to what changed.
+     */
+    fun delta(previousArchive: String): TypeAnalysisResult {
+        val output = ByteArrayOutputStream()
+        writeDelta(previousArchive, output)
+        return output.toByteArray().inputStream().reader(Charsets.UTF_8).use {
+            parseResult(JsonParser.parseReader(it).asJsonObject)
+        }
+    }
+
+    /**
+     * @return An index over every type extracted so far, for looking types up by name, finding
+     *         their users and materializing the types a few roots need with [TypeIndex.closure].
+     *         Later analyses do not show up in it. Building one costs about as much as
+     *         [writeArchive]; [TypeIndex.open] reads the index of a saved archive instead.
+     */
+    @Synchronized
+    fun index(): TypeIndex = TypeIndex(jniBuildIndex(checkOpen()))
+
+    /**
+     * Records a Chrome trace of each later analysis, including clang's own `-ftime-trace` events,
+     * for [timeTrace] to return. The profiler is process-wide, so analyses of other sessions
+     * running at the same time are not traced.
+     *
+     * @param granularityMicros Events shorter than this are dropped.
+     */
+    @Synchronized
+    fun enableTimeTrace(granularityMicros: Int = 500) {
+        jniEnableTimeTrace(checkOpen(), granularityMicros)
+    }
+
+    /**
+     * @return The Chrome trace-event JSON of the last analysis, viewable in `chrome://tracing` or
+     *         Perfetto; empty unless [enableTimeTrace] was called before it.
+     */
+    @Synchronized
+    fun timeTrace(): String = jniGetTimeTrace(checkOpen())
+
+    /**
+     * @return Per-phase timings, cache statistics and per-file costs of every analysis and
+     *         [writeResult] call of this session so far.
+     */
+    @Synchronized
+    fun metrics(): AnalysisMetrics =
+        GsonBuilder().create().fromJson(jniGetMetrics(checkOpen()), AnalysisMetrics::class.java)
+
+    /**
+     * Frees the native session, first cancelling and waiting for any analysis still running.
+     */
+    @Synchronized
+    override fun close() {
+        synchronized(handleLock) {
+            if (handle != 0L) {
+                jniDestroySession(handle)
+                handle = 0L
+            }
+        }
+    }
+
+    // Receives the callbacks of one asynchronous analysis from native code.
+    private class AsyncAnalysis(private val progressListener: (AnalysisProgress) -> Unit) {
+        val future = CompletableFuture<Unit>()
+
+        fun onProgress(unitsDone: Int, unitsTotal: Int, typesExtracted: Long, currentFile: String) {
+            progressListener(AnalysisProgress(unitsDone, unitsTotal, typesExtracted, currentFile))
+        }
+
+        // Called on the analysis thread, or on the caller's if that could not be started. The
+        // future is completed from the common pool, so that its dependents never run on, and hold
+        // up, the native thread.
+        fun onFinished(error: String?, cancelled: Boolean) {
+            ForkJoinPool.commonPool().execute {
+                when {
+                    cancelled -> future.cancel(false)
+                    error != null -> future.completeExceptionally(IllegalStateException(error))
+                    else -> future.complete(Unit)
+                }
+            }
+        }
+    }
+
+    private fun checkOpen(): Long {
+        check(handle != 0L) { "Analyzer session is closed" }
+        return handle
+    }
+}
@@ -0,0 +1,199 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+package com.angelod.typesynth
+
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * The types of a [TypeIndex], read in place from the native type archive through a direct
+ * `ByteBuffer`: nothing is copied or parsed up front, and strings are only decoded when asked
+ * for. Types are numbered from 0 until [size] and refer to each other by number, so following a
+ * reference is an array access rather than a map lookup by key.
+ *
+ * Only the layouts of the first target of a multi-target analysis are given.
+ *
+ * Valid while the index it came from is open; accessors throw `IllegalStateException` after.
+ * Each accessor holds the index open while it reads, so closing it from another thread waits for
+ * the read instead of unmapping the archive under it.
+ */
+class TypeGraph internal constructor(private val index: TypeIndex, buffer: ByteBuffer) {
+
+    // In the order of the native models::NodeKind.
+    enum class Kind {
+        STRUCT,
+        UNION,
+        ENUM,
+        TYPEDEF,
+        FUNCTION_DECLARATION,
+        POINTER,
+        REFERENCE,
+        PRIMITIVE,
+        SYMBOLIC_REFERENCE, // stands for the declaration [target] gives
+        FUNCTION,
+    }
+
+    companion object {
+        const val NONE = -1 // no type, as in the [target] of a type that has none
+
+        private const val VERSION = 3
+        private const val NODE_SIZE = 32
+        private const val MEMBER_SIZE = 16
+        private const val PACKED = 1 shl 0
+        private const val ANONYMOUS = 1 shl 1
+        private const val COMPLETE = 1 shl 2
+        private const val VARIADIC = 1 shl 3
+        private const val SIGNED = 1 shl 4
+        private val kinds = Kind.values()
+    }
+
+    private val bytes = buffer.order(ByteOrder.LITTLE_ENDIAN)
+    private val nodes: Int
+    private val members: Int
+    private val strings: Int
+    private val stringsEnd: Int
+    private val stableIds: Int
+    private val byStableId: Int
+
+    /** The number of types. */
+    val size: Int
+
+    init {
+        check(bytes.getInt(4) == VERSION) { "Unsupported type archive version ${bytes.getInt(4)}" }
+        size = bytes.getInt(8)
+        nodes = bytes.getLong(16).toInt()
+        members = bytes.getLong(24).toInt()
+        strings = bytes.getLong(32).toInt()
+        stringsEnd = strings + bytes.getLong(40).toInt()
+        stableIds = bytes.getLong(64).toInt()
+        byStableId = bytes.getLong(72).toInt()
+    }
+
+    fun kind(type: Int): Kind =
+        index.reading { kinds[node(type, 4).let { bytes.get(it).toInt() and 0xff }] }
+
+    /** Empty for types without a name of their own, such as pointers. */
+    fun name(type: Int): String = index.reading { string(bytes.getInt(node(type, 8))) }
+
+    /** Empty unless the type is a declaration. */
+    fun qualifiedName(type: Int): String = index.reading { string(bytes.getInt(node(type, 12))) }
+
+    /** The type's key in a [TypeAnalysisResult]. */
+    fun key(type: Int): String =
+        index.reading { "%016x".format(bytes.getLong(checkedOffset(stableIds + 8 * type, type))) }
+
+    /**
+     * The pointee of pointers and references, the return type of prototypes, the underlying type of
+     * enums and typedefs, the prototype of function declarations and the declaration a symbolic
+     * reference stands for; [NONE] for other types.
+     */
+    fun target(type: Int): Int = index.reading { bytes.getInt(node(type, 16)) }
+
+    /** Follows symbolic references to the declaration they stand for. */
+    fun resolve(type: Int): Int {
+        var resolved = type
+        repeat(size) {
+            if (resolved == NONE || kind(resolved) != Kind.SYMBOLIC_REFERENCE) return resolved
+            resolved = target(resolved)
+        }
+        return NONE
+    }
+
+    /** In bits for primitives, in bytes for records and enums. */
+    fun sizeOf(type: Int): Int = index.reading { bytes.getInt(node(type, 20)) }
+
+    fun isSigned(type: Int): Boolean = index.reading { hasFlag(type, SIGNED) }
+    fun isPacked(type: Int): Boolean = index.reading { hasFlag(type, PACKED) }
+    fun isAnonymous(type: Int): Boolean = index.reading { hasFlag(type, ANONYMOUS) }
+    fun isComplete(type: Int): Boolean = index.reading { hasFlag(type, COMPLETE) }
+    fun isVariadic(type: Int): Boolean = index.reading { hasFlag(type, VARIADIC) }
+
+    /** The fields of records, parameters of prototypes and function declarations, and enumerators. */
+    fun memberCount(type: Int): Int = index.reading { bytes.getInt(node(type, 28)) }
+
+    fun memberName(type: Int, member: Int): String =
+        index.reading { string(bytes.getInt(member(type, member, 0))) }
+
+    /** The type of a field or prototype parameter; [NONE] for enumerators and parameter names. */
+    fun memberType(type: Int, member: Int): Int =
+        index.reading { bytes.getInt(member(type, member, 4)) }
+
+    fun fieldOffsetInBits(type: Int, field: Int): Int =
+        index.reading { bytes.getInt(member(type, field, 8)) }
+
+    /** Zero unless the field is a bit-field. */
+    fun fieldBitWidth(type: Int, field: Int): Int =
+        index.reading { bytes.getInt(member(type, field, 12)) }
+
+    fun enumeratorValue(type: Int, enumerator: Int): Long =
+        index.reading { bytes.getLong(member(type, enumerator, 8)) }
+
+    /** The type with key [key], or [NONE]. */
+    fun typeOf(key: String): Int {
+        val id = key.toULongOrNull(16)?.toLong() ?: return NONE
+        return index.reading { search(id) }
+    }
+
+    private fun search(id: Long): Int {
+        var low = 0
+        var high = size - 1
+        while (low <= high) {
+            val middle = (low + high) ushr 1
+            val type = bytes.getInt(checkedOffset(byStableId + 4 * middle, middle))
+            val compared = java.lang.Long.compareUnsigned(bytes.getLong(stableIds + 8 * type), id)
+            when {
+                compared < 0 -> low = middle + 1
+                compared > 0 -> high = middle - 1
+                else -> return type
+            }
+        }
+        return NONE
+    }
+
+    private fun hasFlag(type: Int, flag: Int): Boolean = (bytes.get(node(type, 5)).toInt() and flag) != 0
+
+    private fun checkedOffset(offset: Int, type: Int): Int {
+        if (type !in 0 until size) throw IndexOutOfBoundsException("No type $type")
+        return offset
+    }
+
+    private fun node(type: Int, field: Int): Int = checkedOffset(nodes + NODE_SIZE * type + field, type)
+
+    private fun member(type: Int, member: Int, field: Int): Int {
+        if (member !in 0 until memberCount(type)) throw IndexOutOfBoundsException("No member $member")
+        val first = bytes.getInt(node(type, 24))
+        return members + MEMBER_SIZE * (first + member) + field
+    }
+
+    // Decodes the NUL-terminated UTF-8 string at [offset] in the string table.
+    private fun string(offset: Int): String {
+        val start = strings + offset
+        var end = start
+        while (end < stringsEnd && bytes.get(end) != 0.toByte()) end++
+        val utf8 = ByteArray(end - start)
+        bytes.get(start, utf8)
+        return String(utf8, Charsets.UTF_8)
+    }
+}
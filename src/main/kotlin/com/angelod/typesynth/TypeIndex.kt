@@ -0,0 +1,182 @@
+/*
+ * Typesynth
+ *
+ * Copyright (c) 2025 Angelo DeLuca
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+package com.angelod.typesynth
+
+import com.google.gson.Gson
+import com.google.gson.JsonParser
+import com.google.gson.reflect.TypeToken
+import java.io.ByteArrayOutputStream
+import java.io.OutputStream
+import java.nio.ByteBuffer
+import java.util.concurrent.locks.ReentrantReadWriteLock
+import kotlin.concurrent.read
+import kotlin.concurrent.write
+
+// A type or function declaration found by a TypeIndex.
+data class TypeMatch(
+    val key: String, // as in TypeAnalysisResult.types, which holds no function declarations
+    val name: String, // qualified for declarations, empty for most other types
+    val kind: String, // a TSType class name, or FunctionDeclaration
+)
+
+/**
+ * Lookups by qualified name, of the types that use a type, and of the types a few roots need,
+ * over a type archive or a snapshot of a session's types, without reading every type. The archive
+ * is memory-mapped and searched in place: names through a hash table and a sorted list, users
+ * through precomputed reverse edges.
+ */
+class TypeIndex internal constructor(handle: Long) : AutoCloseable {
+
+    companion object {
+        init {
+            System.loadLibrary("tsAnalysis")
+        }
+
+        @JvmStatic
+        private external fun jniOpen(path: String): Long
+
+        @JvmStatic
+        private external fun jniClose(handle: Long)
+
+        @JvmStatic
+        private external fun jniFind(handle: Long, qualifiedName: String): String
+
+        @JvmStatic
+        private external fun jniFindByPrefix(handle: Long, prefix: String, limit: Int): String
+
+        @JvmStatic
+        private external fun jniUsersOf(handle: Long, key: String, limit: Int): String
+
+        @JvmStatic
+        private external fun jniBuffer(handle: Long): ByteBuffer
+
+        @JvmStatic
+        private external fun jniWriteClosure(
+            handle: Long,
+            rootNames: List<String>,
+            rootKeys: List<String>,
+            output: OutputStream,
+        )
+
+        private val matchList = object : TypeToken<List<TypeMatch>>() {}.type
+
+        /**
+         * Opens the index of an archive written by [AnalyzerBridge.writeArchive] or `tsanalyze
+         * --archive`.
+         *
+         * @throws java.io.IOException if the archive could not be read, or has no index.
+         */
+        fun open(archive: String): TypeIndex = TypeIndex(jniOpen(archive))
+    }
+
+    @Volatile
+    private var handle: Long = handle
+
+    // The graph reads the archive's native memory without the monitor, so close() takes this for
+    // writing before unmapping it.
+    private val mapping = ReentrantReadWriteLock()
+
+    /** Runs [read], which reads the mapped archive, with the index held open. */
+    internal fun <T> reading(read: () -> T): T = mapping.read {
+        check(handle != 0L) { "Type index is closed" }
+        read()
+    }
+
+    /**
+     * @return The declarations named [qualifiedName], such as `ns::Widget`. There are several
+     *         when declarations of different kinds, or conflicting definitions, share a name.
+     */
+    @Synchronized
+    fun find(qualifiedName: String): List<TypeMatch> = parse(jniFind(checkOpen(), qualifiedName))
+
+    /**
+     * @return Up to [limit] declarations whose qualified name starts with [prefix], in name order.
+     *         A prefix ending in `::` lists what a namespace or record declares.
+     */
+    @Synchronized
+    fun findByPrefix(prefix: String, limit: Int = 1000): List<TypeMatch> =
+        parse(jniFindByPrefix(checkOpen(), prefix, limit))
+
+    /**
+     * @return Up to [limit] of the types and function declarations that refer to the type with
+     *         key [key] directly: the pointers to it, the records with fields of it, and so on.
+     *         Empty for unknown keys.
+     */
+    @Synchronized
+    fun usersOf(key: String, limit: Int = 1000): List<TypeMatch> =
+        parse(jniUsersOf(checkOpen(), key, limit))
+
+    /**
+     * @return Every type of the index, read in place from native memory instead of through JSON,
+     *         for importers that walk many types. Valid until the index is closed; closing waits
+     *         for reads of the graph in progress.
+     */
+    @Synchronized
+    fun graph(): TypeGraph = TypeGraph(this, jniBuffer(checkOpen()))
+
+    /**
+     * Streams the types [closure] returns to [output], in the form it parses.
+     */
+    @Synchronized
+    fun writeClosure(rootNames: List<String>, rootKeys: List<String>, output: OutputStream) {
+        jniWriteClosure(checkOpen(), rootNames, rootKeys, output)
+    }
+
+    /**
+     * Materializes only the types some roots need, such as the prototype of a function being
+     * applied, rather than every type of the index.
+     *
+     * @param rootNames Qualified names of types or functions. A function stands for its prototype.
+     * @param rootKeys Keys of types, as [find] or an earlier result gives them.
+     * @return A `TypeAnalysisResult` whose `types` hold the roots and every type they refer to,
+     *         directly or not, under the same keys a full result would use, and whose `roots` map
+     *         each root to the keys it was found as; unknown roots map to none. Only the index's
+     *         types are known, so the analyzed files and flags are left empty.
+     */
+    fun closure(rootNames: List<String> = emptyList(), rootKeys: List<String> = emptyList()): TypeAnalysisResult {
+        val output = ByteArrayOutputStream()
+        writeClosure(rootNames, rootKeys, output)
+        return output.toByteArray().inputStream().reader(Charsets.UTF_8).use {
+            parseResult(JsonParser.parseReader(it).asJsonObject)
+        }
+    }
+
+    @Synchronized
+    override fun close() {
+        mapping.write {
+            if (handle != 0L) {
+                jniClose(handle)
+                handle = 0L
+            }
+        }
+    }
+
+    private fun parse(json: String): List<TypeMatch> = Gson().fromJson(json, matchList)
+
+    private fun checkOpen(): Long {
+        check(handle != 0L) { "Type index is closed" }
+        return handle
+    }
+}